@@ -1,8 +1,14 @@
 #define CBUILD_IMPLEMENTATION
 #include "cbuild.h"
 
-void build_engine() {
+void build_engine(bool release) {
 	CBuild cbuild("gcc");
+	if (release) {
+		cbuild.flags({
+			"-O2",
+			"-DENGINE_RELEASE"
+		});
+	}
 	cbuild
 		.out("bin", "libengine.a")
 		.flags({
@@ -20,15 +26,23 @@ void build_engine() {
 			"src/external/stb/stb_image.c",
 			"src/core/defines.c",
 			"src/core/trace_allocator.c",
+			"src/core/slab_allocator.c",
+			"src/core/frame_arena.c",
+			"src/core/hashmap.c",
 			"src/core/ctx.c",
 			"src/core/alloc.c",
+			"src/core/thread_pool.c",
+			"src/core/file_map.c",
 			"src/math/vec.c",
 			"src/math/mat.c",
 			"src/graphics/shader.c",
 			"src/graphics/texture.c",
 			"src/graphics/fbo.c",
 			"src/graphics/imr.c",
+			"src/graphics/isr.c",
+			"src/graphics/draw_list.c",
 			"src/ecs/ecs.c",
+			"src/ecs/system.c",
 			"src/event/event.c",
 			"src/camera/camera.c",
 			"src/window/window.c",
@@ -51,9 +65,9 @@ void build_iso(int argc, char** argv) {
 			"bin/",
 		})
 #ifdef _WIN32
-		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m"})
+		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m", "pthread"})
 #elif defined(__linux__)
-		.libs({"engine", "GL", "GLU", "m"})
+		.libs({"engine", "GL", "GLU", "m", "pthread"})
 #endif
 		.src({
 			"src/examples/iso.c",
@@ -77,9 +91,9 @@ void build_2d(int argc, char** argv) {
 			"bin/",
 		})
 #ifdef _WIN32
-		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m"})
+		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m", "pthread"})
 #elif defined(__linux__)
-		.libs({"engine", "GL", "GLU", "m"})
+		.libs({"engine", "GL", "GLU", "m", "pthread"})
 #endif
 		.src({
 			"src/examples/2d.c",
@@ -103,9 +117,9 @@ void build_light(int argc, char** argv) {
 			"bin/",
 		})
 #ifdef _WIN32
-		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m"})
+		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m", "pthread"})
 #elif defined(__linux__)
-		.libs({"engine", "GL", "GLU", "m"})
+		.libs({"engine", "GL", "GLU", "m", "pthread"})
 #endif
 		.src({
 			"src/examples/light.c",
@@ -129,9 +143,9 @@ void build_game(int argc, char** argv) {
 			"bin/",
 		})
 #ifdef _WIN32
-		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m"})
+		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m", "pthread"})
 #elif defined(__linux__)
-		.libs({"engine", "GL", "GLU", "m"})
+		.libs({"engine", "GL", "GLU", "m", "pthread"})
 #endif
 		.src({
 			"src/game/renderer.c",
@@ -143,13 +157,44 @@ void build_game(int argc, char** argv) {
 		.run(argv);
 }
 
+void build_bench(const std::string& name, char** argv) {
+	CBuild cbuild("gcc");
+	cbuild
+		.out("bin", "bench_" + name)
+		.flags({
+			"-O2"
+		})
+		.inc_paths({
+			"src/",
+			"src/external/glew/include/",
+			"src/external/glfw/include/",
+			"src/external/stb/"
+		})
+		.lib_paths({
+			"bin/",
+		})
+#ifdef _WIN32
+		.libs({"mingw32", "enigne", "glu32", "opengl32", "User32", "Gdi32", "Shell32", "m", "pthread"})
+#elif defined(__linux__)
+		.libs({"engine", "GL", "GLU", "EGL", "m", "pthread"})
+#endif
+		.src({
+			"src/bench/" + name + ".c",
+		})
+		.build()
+		.clean()
+		.run(argv);
+}
+
 void print_usage() {
 	std::cout << "[Usage]: ./cbuild [options]" << std::endl;
 	std::cout << "\tengine: Builds engine\n";
+	std::cout << "\tengine_release: Builds engine with the release allocator\n";
 	std::cout << "\tiso: Builds isometric example\n";
 	std::cout << "\t2d: Builds 2D example\n";
 	std::cout << "\tlight: Builds light example\n";
 	std::cout << "\tgame: Builds game\n";
+	std::cout << "\tbench_<name>: Builds and runs src/bench/<name>.c\n";
 }
 
 int main(int argc, char** argv) {
@@ -163,7 +208,9 @@ int main(int argc, char** argv) {
 
 	for (const std::string& arg : args) {
 		if (arg == "engine")
-			build_engine();
+			build_engine(false);
+		else if (arg == "engine_release")
+			build_engine(true);
 		else if (arg == "iso")
 			build_iso(argc, argv);
 		else if (arg == "2d")
@@ -172,6 +219,8 @@ int main(int argc, char** argv) {
 			build_light(argc, argv);
 		else if (arg == "game")
 			build_game(argc, argv);
+		else if (arg.rfind("bench_", 0) == 0)
+			build_bench(arg.substr(6), argv);
 		else
 			print_usage();
 	}
@@ -0,0 +1,88 @@
+#include "core/trace_allocator.h"
+#include "core/slab_allocator.h"
+#include "bench/bench.h"
+
+#define OP_CNT   2000000
+#define LIVE_CNT 16384
+
+/*
+ * Mixed workload that looks like the engine's hot paths: a working set of
+ * small component sized blocks with random sizes, churned by replacing a
+ * random live block on every op.
+ */
+
+static size_t random_size() {
+	// Mostly small component/entry sized blocks, sometimes array growth
+	if (bench_rand() % 16 == 0) return 512 + bench_rand() % 3584;
+	return 16 + bench_rand() % 240;
+}
+
+int main() {
+	void** live = calloc(LIVE_CNT, sizeof(void*));
+	size_t* sizes = malloc(sizeof(size_t) * OP_CNT);
+	u32* slots = malloc(sizeof(u32) * OP_CNT);
+	for (u32 i = 0; i < OP_CNT; i++) {
+		sizes[i] = random_size();
+		slots[i] = bench_rand() % LIVE_CNT;
+	}
+
+	// Tracing backend
+	{
+		Trace_Allocator* allocator = trace_allocator_new();
+		f64 start = bench_now_ns();
+		for (u32 i = 0; i < OP_CNT; i++) {
+			trace_allocator_free(allocator, live[slots[i]]);
+			live[slots[i]] = trace_allocator_alloc(allocator, sizes[i]);
+		}
+		f64 ns = bench_now_ns() - start;
+		bench_report("trace backend (free + alloc)", OP_CNT, ns);
+
+		for (u32 i = 0; i < LIVE_CNT; i++) {
+			trace_allocator_free(allocator, live[i]);
+			live[i] = NULL;
+		}
+		trace_allocator_delete(allocator);
+	}
+
+	// Slab backend, zeroed like alloc()
+	{
+		Slab_Allocator* allocator = slab_allocator_new();
+		f64 start = bench_now_ns();
+		for (u32 i = 0; i < OP_CNT; i++) {
+			slab_allocator_free(allocator, live[slots[i]]);
+			live[slots[i]] = slab_allocator_alloc(allocator, sizes[i]);
+			memset(live[slots[i]], 0, sizes[i]);
+		}
+		f64 ns = bench_now_ns() - start;
+		bench_report("slab backend (free + alloc)", OP_CNT, ns);
+
+		for (u32 i = 0; i < LIVE_CNT; i++) {
+			slab_allocator_free(allocator, live[i]);
+			live[i] = NULL;
+		}
+		slab_allocator_delete(allocator);
+	}
+
+	// Slab backend without zeroing like alloc_raw()
+	{
+		Slab_Allocator* allocator = slab_allocator_new();
+		f64 start = bench_now_ns();
+		for (u32 i = 0; i < OP_CNT; i++) {
+			slab_allocator_free(allocator, live[slots[i]]);
+			live[slots[i]] = slab_allocator_alloc(allocator, sizes[i]);
+		}
+		f64 ns = bench_now_ns() - start;
+		bench_report("slab backend raw (free + alloc)", OP_CNT, ns);
+
+		for (u32 i = 0; i < LIVE_CNT; i++) {
+			slab_allocator_free(allocator, live[i]);
+			live[i] = NULL;
+		}
+		slab_allocator_delete(allocator);
+	}
+
+	free(slots);
+	free(sizes);
+	free(live);
+	return 0;
+}
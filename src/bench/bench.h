@@ -0,0 +1,41 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "core/defines.h"
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * @brief Small helpers shared by the benchmark targets
+ */
+
+static f64 bench_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (f64) ts.tv_sec * 1e9 + (f64) ts.tv_nsec;
+}
+
+#define bench_report(name, ops, ns) \
+	printf("%-40s %12llu ops %12.2f ns/op\n", name, (u64) (ops), (ns) / (f64) (ops))
+
+// Deterministic xorshift generator so runs are comparable
+static u64 bench_rand_state = 0x9e3779b97f4a7c15ull;
+
+static u64 bench_rand() {
+	bench_rand_state ^= bench_rand_state << 13;
+	bench_rand_state ^= bench_rand_state >> 7;
+	bench_rand_state ^= bench_rand_state << 17;
+	return bench_rand_state;
+}
+
+static void bench_shuffle_u32(u32* arr, u32 len) {
+	for (u32 i = len - 1; i > 0; i--) {
+		u32 j = bench_rand() % (i + 1);
+		u32 t = arr[i];
+		arr[i] = arr[j];
+		arr[j] = t;
+	}
+}
+
+#endif // __BENCH_H__
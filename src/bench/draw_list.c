@@ -0,0 +1,158 @@
+#include "core/ctx.h"
+#include "graphics/imr.h"
+#include "graphics/draw_list.h"
+#include "graphics/fbo.h"
+#include "bench/bench.h"
+#include "bench/headless.h"
+
+#define SPRITE_CNT 100000
+#define TEX_CNT    4
+#define FRAME_CNT  10
+#define SURF_W     1280
+#define SURF_H     720
+
+extern Context* ctx;
+extern const char* v_src;
+
+// Default IMR shader drawing in grayscale
+static const char* gray_src =
+	"#version 440 core\n"
+	IMR_GLSL_DEFINES
+	"layout (location = 0) out vec4 color;\n"
+	"in vec4 o_color;\n"
+	"in vec2 o_tex_coord;\n"
+	"in float o_tex_id;\n"
+	"void main() {\n"
+	"vec4 c = IMR_TEXTURE(int(o_tex_id), o_tex_coord) * o_color;\n"
+	"color = vec4(vec3(dot(c.rgb, vec3(0.299, 0.587, 0.114))), c.a);\n"
+	"}\n";
+
+typedef struct {
+	Draw_State state;
+	Quad_Desc quad;
+} Sprite_Draw;
+
+static Sprite_Draw sprites[SPRITE_CNT];
+
+static void set_blend(Draw_Blend blend) {
+	if (blend == DRAW_BLEND_ADD) {
+		GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+	} else {
+		GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+	}
+}
+
+// What a caller of IMR has to do: end the batch every time the shader or blend mode changes
+static void imr_frame(IMR* imr, Draw_List* list, m4 mvp) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	Shader shader = imr->shader;
+	Draw_Blend blend = DRAW_BLEND_ALPHA;
+	imr_begin(imr);
+
+	for (u32 i = 0; i < SPRITE_CNT; i++) {
+		Sprite_Draw* s = &sprites[i];
+		Shader next = s->state.shader.id ? s->state.shader : imr->def_shader;
+		if (next.id != shader.id || s->state.blend != blend) {
+			imr_end(imr);
+			if (next.id != shader.id) {
+				imr_switch_shader(imr, next);
+				shader = next;
+			}
+			if (s->state.blend != blend) {
+				set_blend(s->state.blend);
+				imr->stats.state_changes++;
+				blend = s->state.blend;
+			}
+			imr_begin(imr);
+			imr_update_mvp(imr, mvp);
+		}
+		imr_push_quads(imr, &s->quad, 1);
+	}
+
+	imr_end(imr);
+	set_blend(DRAW_BLEND_ALPHA);
+	imr_switch_shader_to_default(imr);
+}
+
+static void draw_list_frame(IMR* imr, Draw_List* list, m4 mvp) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	for (u32 i = 0; i < SPRITE_CNT; i++) {
+		draw_list_push_quad(list, sprites[i].state, &sprites[i].quad);
+	}
+	draw_list_flush(list, imr, mvp);
+}
+
+#define bench_frames(name, frame, imr, list, mvp) do {               \
+	/* Warming up the driver */                                      \
+	frame(imr, list, mvp);                                           \
+	glFinish();                                                      \
+	f64 start = bench_now_ns();                                      \
+	for (u32 f = 0; f < FRAME_CNT; f++) {                            \
+		imr_reset_stats(imr);                                        \
+		frame(imr, list, mvp);                                       \
+	}                                                                \
+	glFinish();                                                      \
+	f64 ns = bench_now_ns() - start;                                 \
+	bench_report(name, FRAME_CNT, ns);                               \
+	imr_print_stats(imr);                                            \
+} while (0)
+
+int main() {
+	headless_gl_init();
+	ctx = ctx_new();
+
+	FBO fbo = unwrap(fbo_new(SURF_W, SURF_H));
+	IMR imr = unwrap(imr_new());
+	Draw_List* list = draw_list_new();
+	Shader gray = unwrap(shader_new(v_src, gray_src));
+	imr_switch_shader(&imr, gray);
+	imr_reapply_samplers(&imr);
+	imr_switch_shader_to_default(&imr);
+
+	Texture textures[TEX_CNT];
+	for (u32 i = 0; i < TEX_CNT; i++) {
+		u32 pixel = 0xff000000 | (0xff << (i % 3 * 8));
+		textures[i] = unwrap(texture_from_data(1, 1, &pixel));
+	}
+
+	// Textures, shaders and blend modes come in random order, like a scene of mixed entities
+	for (u32 i = 0; i < SPRITE_CNT; i++) {
+		sprites[i] = (Sprite_Draw) {
+			.state = {
+				.shader = bench_rand() % 2 ? gray : (Shader) { 0 },
+				.blend = bench_rand() % 2 ? DRAW_BLEND_ADD : DRAW_BLEND_ALPHA,
+			},
+			.quad = {
+				.pos = { (f32) (bench_rand() % SURF_W), (f32) (bench_rand() % SURF_H), 0 },
+				.size = { 4, 4 },
+				.tex_rect = { 0, 0, 1, 1 },
+				.tex_id = textures[bench_rand() % TEX_CNT].id,
+				.rot = rotate_z((f32) (bench_rand() % 628) / 100.0f),
+				.color = { 1, 1, 1, 0.5f }
+			}
+		};
+	}
+	printf("%u sprites, %u textures, 2 shaders, 2 blend modes\n", SPRITE_CNT, TEX_CNT);
+
+	glViewport(0, 0, SURF_W, SURF_H);
+	fbo_bind(&fbo);
+
+	// Same orientation ocamera_calc_mvp produces
+	m4 mvp = m4_transpose(ortho_projection(0, SURF_W, SURF_H, 0, -1, 1000));
+	imr_begin(&imr);
+	imr_update_mvp(&imr, mvp);
+
+	bench_frames("imr frame, submission order", imr_frame, &imr, list, mvp);
+	bench_frames("draw list frame, sorted", draw_list_frame, &imr, list, mvp);
+
+	fbo_unbind();
+	for (u32 i = 0; i < TEX_CNT; i++) {
+		texture_delete(textures[i]);
+	}
+	shader_delete(gray);
+	draw_list_delete(list);
+	imr_delete(&imr);
+	fbo_delete(&fbo);
+	ctx_delete(ctx);
+	return 0;
+}
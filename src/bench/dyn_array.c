@@ -0,0 +1,65 @@
+#include "core/ctx.h"
+#include "core/dyn_array.h"
+#include "bench/bench.h"
+
+#define APPEND_CNT 10000000
+#define REMOVE_CNT 100000
+
+extern Context* ctx;
+
+int main() {
+	ctx = ctx_new();
+
+	// Appending
+	{
+		Dyn_Array(i32) arr = NULL;
+		f64 start = bench_now_ns();
+		for (i32 i = 0; i < APPEND_CNT; i++) {
+			dyn_array_append(arr, i);
+		}
+		f64 ns = bench_now_ns() - start;
+		bench_report("dyn_array_append", APPEND_CNT, ns);
+		dyn_array_delete(arr);
+	}
+
+	// Appending into reserved storage
+	{
+		Dyn_Array(i32) arr = NULL;
+		f64 start = bench_now_ns();
+		dyn_array_reserve(arr, APPEND_CNT);
+		for (i32 i = 0; i < APPEND_CNT; i++) {
+			dyn_array_append(arr, i);
+		}
+		f64 ns = bench_now_ns() - start;
+		bench_report("dyn_array_append (reserved)", APPEND_CNT, ns);
+		dyn_array_delete(arr);
+	}
+
+	// Draining from the front, ordered vs unordered
+	{
+		Dyn_Array(i32) arr = NULL;
+		dyn_array_resize(arr, REMOVE_CNT);
+
+		i64 sum = 0;
+		f64 start = bench_now_ns();
+		while (arr->len) {
+			sum += dyn_array_pop(arr, 0);
+		}
+		f64 ns = bench_now_ns() - start;
+		bench_report("dyn_array_pop (front)", REMOVE_CNT, ns);
+
+		dyn_array_resize(arr, REMOVE_CNT);
+		start = bench_now_ns();
+		while (arr->len) {
+			sum += dyn_array_swap_remove(arr, 0);
+		}
+		ns = bench_now_ns() - start;
+		bench_report("dyn_array_swap_remove (front)", REMOVE_CNT, ns);
+
+		dyn_array_delete(arr);
+		printf("(checksum %lld)\n", sum);
+	}
+
+	ctx_delete(ctx);
+	return 0;
+}
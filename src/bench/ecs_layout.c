@@ -0,0 +1,175 @@
+#include "core/ctx.h"
+#include "ecs/ecs.h"
+#include "bench/bench.h"
+
+#define ENTITY_CNT 1000000
+#define ITER_CNT   10
+
+extern Context* ctx;
+
+typedef struct { v3 pos; } Position;
+typedef struct { v3 vel; } Velocity;
+typedef struct { v4 color; } Tint;
+typedef struct { f32 time; } Lifetime;
+
+/*
+ * Replica of the previous layout: every component is its own heap block
+ * behind a CompEntry pointer, indexed by entity.
+ */
+
+typedef struct {
+	Entity ent;
+	void* data;
+} Old_Entry;
+
+typedef struct {
+	u32 entry_cnt;
+	Entity* entries_ent;
+	Old_Entry** entries;
+} Old_Record;
+
+// Entity ids in the same order the ECS handed them out
+static Entity* ids;
+
+static Old_Record old_record_new(u32 cnt, u32 comp_size) {
+	Old_Record rec = {
+		.entry_cnt = cnt,
+		.entries_ent = malloc(sizeof(Entity) * cnt),
+		.entries = malloc(sizeof(Old_Entry*) * cnt)
+	};
+	for (u32 i = 0; i < cnt; i++) {
+		Entity e = ids[i];
+		rec.entries_ent[i] = e;
+		rec.entries[e] = malloc(sizeof(Old_Entry));
+		rec.entries[e]->ent = e;
+		rec.entries[e]->data = calloc(1, comp_size);
+	}
+	return rec;
+}
+
+static void old_record_delete(Old_Record* rec) {
+	for (u32 i = 0; i < rec->entry_cnt; i++) {
+		free(rec->entries[i]->data);
+		free(rec->entries[i]);
+	}
+	free(rec->entries);
+	free(rec->entries_ent);
+}
+
+static void bench_old(u32 comp_cnt) {
+	Old_Record pos  = old_record_new(ENTITY_CNT, sizeof(Position));
+	Old_Record vel  = old_record_new(ENTITY_CNT, sizeof(Velocity));
+	Old_Record tint = old_record_new(ENTITY_CNT, sizeof(Tint));
+	Old_Record life = old_record_new(ENTITY_CNT, sizeof(Lifetime));
+
+	f64 start = bench_now_ns();
+	for (u32 it = 0; it < ITER_CNT; it++) {
+		for (u32 i = 0; i < pos.entry_cnt; i++) {
+			Entity e = pos.entries_ent[i];
+			Position* p = pos.entries[e]->data;
+			Velocity* v = vel.entries[e]->data;
+			p->pos = v3_add(p->pos, v->vel);
+			if (comp_cnt >= 3) {
+				Tint* t = tint.entries[e]->data;
+				t->color.a *= 0.99f;
+			}
+			if (comp_cnt >= 4) {
+				Lifetime* l = life.entries[e]->data;
+				l->time += 0.016f;
+			}
+		}
+	}
+	f64 ns = bench_now_ns() - start;
+
+	char name[64];
+	sprintf(name, "old layout, %u components", comp_cnt);
+	bench_report(name, (u64) ENTITY_CNT * ITER_CNT, ns);
+
+	old_record_delete(&pos);
+	old_record_delete(&vel);
+	old_record_delete(&tint);
+	old_record_delete(&life);
+}
+
+static void bench_packed(ECS* ecs, u32 comp_cnt) {
+	CompRecord* vel  = comp_table_get_record(ecs->table, Velocity);
+	CompRecord* tint = comp_table_get_record(ecs->table, Tint);
+	CompRecord* life = comp_table_get_record(ecs->table, Lifetime);
+
+	f64 start = bench_now_ns();
+	for (u32 it = 0; it < ITER_CNT; it++) {
+		ecs_for_each_comp(ecs, Position, {
+			Velocity* v = comp_record_get_entry_hinted(vel, entity, i);
+			comp->pos = v3_add(comp->pos, v->vel);
+			if (comp_cnt >= 3) {
+				Tint* t = comp_record_get_entry_hinted(tint, entity, i);
+				t->color.a *= 0.99f;
+			}
+			if (comp_cnt >= 4) {
+				Lifetime* l = comp_record_get_entry_hinted(life, entity, i);
+				l->time += 0.016f;
+			}
+		});
+	}
+	f64 ns = bench_now_ns() - start;
+
+	char name[64];
+	sprintf(name, "packed layout, %u components", comp_cnt);
+	bench_report(name, (u64) ENTITY_CNT * ITER_CNT, ns);
+}
+
+static void bench_query(ECS* ecs) {
+	ECS_Query* q = ecs_query_new(ecs, Position, Velocity, Tint, Lifetime);
+
+	f64 start = bench_now_ns();
+	for (u32 it_cnt = 0; it_cnt < ITER_CNT; it_cnt++) {
+		ECS_Query_Iter it = ecs_query_iter(q);
+		while (ecs_query_next(&it)) {
+			Position* p = ecs_iter_column(&it, Position, 0);
+			Velocity* v = ecs_iter_column(&it, Velocity, 1);
+			Tint* t     = ecs_iter_column(&it, Tint, 2);
+			Lifetime* l = ecs_iter_column(&it, Lifetime, 3);
+			for (u32 i = 0; i < it.cnt; i++) {
+				p[i].pos = v3_add(p[i].pos, v[i].vel);
+				t[i].color.a *= 0.99f;
+				l[i].time += 0.016f;
+			}
+		}
+	}
+	f64 ns = bench_now_ns() - start;
+	bench_report("owning query, 4 components", (u64) ENTITY_CNT * ITER_CNT, ns);
+}
+
+int main() {
+	ctx = ctx_new();
+
+	ECS* ecs = ecs_new(ENTITY_CNT);
+	Entity* ents = malloc(sizeof(Entity) * ENTITY_CNT);
+	entity_new_n(ecs, ents, ENTITY_CNT);
+
+	// Entities of a long running ecs are not in slot order
+	bench_shuffle_u32(ents, ENTITY_CNT);
+
+	ids = ents;
+	for (u32 c = 2; c <= 4; c++)
+		bench_old(c);
+
+	for (u32 i = 0; i < ENTITY_CNT; i++) {
+		Entity e = ents[i];
+		entity_add_component(ecs, e, Position, { (v3) { i, 0, 0 } });
+		entity_add_component(ecs, e, Velocity, { (v3) { 1, 1, 0 } });
+		entity_add_component(ecs, e, Tint, { (v4) { 1, 1, 1, 1 } });
+		entity_add_component(ecs, e, Lifetime, { 0 });
+	}
+
+	for (u32 c = 2; c <= 4; c++)
+		bench_packed(ecs, c);
+	bench_query(ecs);
+
+	entity_delete_n(ecs, ents, ENTITY_CNT);
+	free(ents);
+	ecs_delete(ecs);
+
+	ctx_delete(ctx);
+	return 0;
+}
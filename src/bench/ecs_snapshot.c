@@ -0,0 +1,120 @@
+#include "core/ctx.h"
+#include "ecs/ecs.h"
+#include "bench/bench.h"
+
+#include <stdio.h>
+
+#define ENTITY_CNT    1000000
+#define PATH_EVERY    64
+#define PATH_LEN      8
+#define LOAD_CNT      10
+#define SNAPSHOT_PATH "bench_world.snap"
+
+extern Context* ctx;
+
+typedef struct { v3 pos; } Position;
+typedef struct { v3 vel; } Velocity;
+typedef struct { v4 color; } Tint;
+typedef struct { u32 len; v2* points; } Path;
+
+static void path_save(void* comp, ECS_Blob* blob) {
+	Path* p = comp;
+	p->points = (void*) ecs_blob_push(blob, p->points, sizeof(v2) * p->len);
+}
+
+// Points stay in the mapping, it lives as long as the ecs
+static void path_load(void* comp, const u8* blob) {
+	Path* p = comp;
+	p->points = (v2*) ecs_blob_get(blob, (u64) p->points);
+}
+
+static f64 checksum(ECS* ecs) {
+	f64 sum = 0;
+	CompRecord* pos = comp_table_get_record(ecs->table, Position);
+	CompRecord* vel = comp_table_get_record(ecs->table, Velocity);
+	CompRecord* tint = comp_table_get_record(ecs->table, Tint);
+	CompRecord* path = comp_table_get_record(ecs->table, Path);
+
+	for (u32 i = 0; i < pos->entry_cnt; i++) sum += ((Position*) pos->data)[i].pos.x;
+	for (u32 i = 0; i < vel->entry_cnt; i++) sum += ((Velocity*) vel->data)[i].vel.y;
+	for (u32 i = 0; i < tint->entry_cnt; i++) sum += ((Tint*) tint->data)[i].color.a;
+	for (u32 i = 0; i < path->entry_cnt; i++) {
+		Path* p = &((Path*) path->data)[i];
+		for (u32 j = 0; j < p->len; j++) sum += p->points[j].x;
+	}
+	return sum;
+}
+
+int main() {
+	ctx = ctx_new();
+	ecs_register_component(Position);
+	ecs_register_component(Velocity);
+	ecs_register_component(Tint);
+	ecs_register_component(Path);
+	ecs_snapshot_hook(Path, path_save, path_load);
+
+	// Level setup in code, the way the game builds its world today
+	Entity* ents = malloc(sizeof(Entity) * ENTITY_CNT);
+	f64 start = bench_now_ns();
+	ECS* ecs = ecs_new(ENTITY_CNT);
+	entity_new_n(ecs, ents, ENTITY_CNT);
+	for (u32 i = 0; i < ENTITY_CNT; i++) {
+		f32 r = (f32) (bench_rand() % 1000);
+		entity_add_component(ecs, ents[i], Position, { (v3) { r, 1000 - r, 0 } });
+		entity_add_component(ecs, ents[i], Velocity, { (v3) { 1, -1, 0 } });
+		entity_add_component(ecs, ents[i], Tint, { (v4) { r, 1, 1, 0.5f } });
+		if (i % PATH_EVERY == 0) {
+			v2* points = alloc(sizeof(v2) * PATH_LEN);
+			for (u32 j = 0; j < PATH_LEN; j++) points[j] = (v2) { r + j, r - j };
+			entity_add_component(ecs, ents[i], Path, { PATH_LEN, points });
+		}
+	}
+	f64 build_ns = bench_now_ns() - start;
+	bench_report("build world in code", ENTITY_CNT, build_ns);
+	f64 expected = checksum(ecs);
+
+	start = bench_now_ns();
+	u64 size = unwrap(ecs_snapshot_save(ecs, SNAPSHOT_PATH));
+	f64 ns = bench_now_ns() - start;
+	bench_report("save snapshot", ENTITY_CNT, ns);
+	printf("%-40s %12.2f MB %12.2f ms %8.2f GB/s\n", "", size / 1e6, ns / 1e6, size / ns);
+
+	ecs_for_each_comp(ecs, Path, { clean(comp->points); });
+	entity_delete_n(ecs, ents, ENTITY_CNT);
+	ecs_delete(ecs);
+
+	// Mapping only, pages are faulted in later by whoever touches them
+	f64 load_ns = 0;
+	for (u32 i = 0; i < LOAD_CNT; i++) {
+		start = bench_now_ns();
+		ECS* loaded = unwrap(ecs_snapshot_load(SNAPSHOT_PATH));
+		load_ns += bench_now_ns() - start;
+
+		entity_delete_n(loaded, ents, ENTITY_CNT);
+		ecs_delete(loaded);
+	}
+	bench_report("load snapshot", (u64) ENTITY_CNT * LOAD_CNT, load_ns);
+	printf("%-40s %12.2f ms/load %8.0fx faster than building\n", "", load_ns / LOAD_CNT / 1e6, build_ns / (load_ns / LOAD_CNT));
+
+	// Load followed by a pass reading every component
+	start = bench_now_ns();
+	ECS* loaded = unwrap(ecs_snapshot_load(SNAPSHOT_PATH));
+	f64 sum = checksum(loaded);
+	ns = bench_now_ns() - start;
+	bench_report("load snapshot + read every component", ENTITY_CNT, ns);
+	printf("%-40s %12.2f ms %8.2fx faster than building  checksum %s\n", "", ns / 1e6, build_ns / ns, sum == expected ? "ok" : "MISMATCH");
+
+	// Loaded world keeps working, the first add copies the record out of the mapping
+	entity_delete(loaded, ents[0]);
+	Entity e = entity_new(loaded);
+	entity_add_component(loaded, e, Position, { 0 });
+	ents[0] = e;
+
+	entity_delete_n(loaded, ents, ENTITY_CNT);
+	ecs_delete(loaded);
+	remove(SNAPSHOT_PATH);
+	free(ents);
+
+	ctx_delete(ctx);
+	return 0;
+}
@@ -0,0 +1,134 @@
+#include "core/ctx.h"
+#include "ecs/ecs.h"
+#include "bench/bench.h"
+
+#define ENTITY_CNT 1000000
+#define FILL_CNT   (ENTITY_CNT / 100 * 99)
+#define CHURN_CNT  100000
+#define BATCH_CNT  1000
+
+extern Context* ctx;
+
+typedef struct { f32 time; } Particle;
+
+// Fill levels the spawn latency is reported for
+static const u32 bands[] = { 0, ENTITY_CNT / 2, ENTITY_CNT / 10 * 9, FILL_CNT };
+#define BAND_CNT (sizeof(bands) / sizeof(bands[0]) - 1)
+
+/*
+ * Replica of the previous allocator: random slot, retry until a free one
+ */
+
+static u8* old_slots;
+
+static Entity old_entity_new() {
+	Entity id;
+	do {
+		id = bench_rand() % ENTITY_CNT;
+	} while (old_slots[id]);
+	old_slots[id] = 1;
+	return id;
+}
+
+static void bench_old(Entity* live) {
+	old_slots = calloc(ENTITY_CNT, 1);
+	char name[64];
+
+	for (u32 b = 0; b < BAND_CNT; b++) {
+		f64 start = bench_now_ns();
+		for (u32 i = bands[b]; i < bands[b + 1]; i++) {
+			live[i] = old_entity_new();
+		}
+		f64 ns = bench_now_ns() - start;
+
+		sprintf(name, "old spawn, fill %u%%-%u%%", bands[b] / (ENTITY_CNT / 100), bands[b + 1] / (ENTITY_CNT / 100));
+		bench_report(name, bands[b + 1] - bands[b], ns);
+	}
+
+	// Despawning and spawning one entity at a time at 99% fill
+	f64 start = bench_now_ns();
+	for (u32 i = 0; i < CHURN_CNT; i++) {
+		u32 j = bench_rand() % FILL_CNT;
+		old_slots[live[j]] = 0;
+		live[j] = old_entity_new();
+	}
+	f64 ns = bench_now_ns() - start;
+	bench_report("old churn at 99%", CHURN_CNT, ns);
+
+	free(old_slots);
+}
+
+static void bench_free_list(Entity* live) {
+	ECS* ecs = ecs_new(ENTITY_CNT);
+	char name[64];
+
+	for (u32 b = 0; b < BAND_CNT; b++) {
+		f64 start = bench_now_ns();
+		for (u32 i = bands[b]; i < bands[b + 1]; i++) {
+			live[i] = entity_new(ecs);
+		}
+		f64 ns = bench_now_ns() - start;
+
+		sprintf(name, "free list spawn, fill %u%%-%u%%", bands[b] / (ENTITY_CNT / 100), bands[b + 1] / (ENTITY_CNT / 100));
+		bench_report(name, bands[b + 1] - bands[b], ns);
+	}
+
+	f64 start = bench_now_ns();
+	for (u32 i = 0; i < CHURN_CNT; i++) {
+		u32 j = bench_rand() % FILL_CNT;
+		entity_delete(ecs, live[j]);
+		live[j] = entity_new(ecs);
+	}
+	f64 ns = bench_now_ns() - start;
+	bench_report("free list churn at 99%", CHURN_CNT, ns);
+
+	// Despawning and respawning the oldest particles a batch per frame
+	start = bench_now_ns();
+	for (u32 i = 0; i + BATCH_CNT <= FILL_CNT; i += BATCH_CNT) {
+		entity_delete_n(ecs, &live[i], BATCH_CNT);
+		entity_new_n(ecs, &live[i], BATCH_CNT);
+	}
+	ns = bench_now_ns() - start;
+	bench_report("free list batch churn at 99%", FILL_CNT / BATCH_CNT * BATCH_CNT, ns);
+
+	// Churn with a component per spawn, applied directly then recorded
+	ecs_register_component(Particle);
+	start = bench_now_ns();
+	for (u32 i = 0; i < FILL_CNT; i++) {
+		entity_delete(ecs, live[i]);
+		live[i] = entity_new(ecs);
+		entity_add_component(ecs, live[i], Particle, { 1.0f });
+	}
+	ns = bench_now_ns() - start;
+	bench_report("direct churn with component at 99%", FILL_CNT, ns);
+
+	start = bench_now_ns();
+	for (u32 i = 0; i + BATCH_CNT <= FILL_CNT; i += BATCH_CNT) {
+		for (u32 j = i; j < i + BATCH_CNT; j++) {
+			ecs_cmd_delete(ecs, live[j]);
+			Entity e = ecs_cmd_spawn(ecs);
+			ecs_cmd_add(ecs, e, Particle, { 1.0f });
+		}
+		ecs_flush(ecs);
+
+		// Spawned entities come out of the flush in record order
+		memcpy(&live[i], ecs_cmd_buffer(ecs)->spawned, sizeof(Entity) * BATCH_CNT);
+	}
+	ns = bench_now_ns() - start;
+	bench_report("command buffer batch churn at 99%", FILL_CNT / BATCH_CNT * BATCH_CNT, ns);
+
+	entity_delete_n(ecs, live, FILL_CNT);
+	ecs_delete(ecs);
+}
+
+int main() {
+	ctx = ctx_new();
+
+	Entity* live = malloc(sizeof(Entity) * FILL_CNT);
+	bench_old(live);
+	bench_free_list(live);
+	free(live);
+
+	ctx_delete(ctx);
+	return 0;
+}
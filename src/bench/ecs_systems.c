@@ -0,0 +1,158 @@
+#include "core/ctx.h"
+#include "ecs/ecs.h"
+#include "ecs/system.h"
+#include "math/mat.h"
+#include "bench/bench.h"
+
+#include <math.h>
+
+#define ENTITY_CNT 500000
+#define FRAME_CNT  20
+
+extern Context* ctx;
+
+typedef struct { v3 pos; } Position;
+typedef struct { v3 vel; } Velocity;
+typedef struct { v4 color; } Tint;
+typedef struct { f32 time; f32 scale; } Lifetime;
+typedef struct { f32 angle; m4 rot; } Spin;
+
+/*
+ * Four independent systems and one depending on `move`, so a frame is two
+ * waves and every system is split in chunks
+ */
+
+static void move_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	Position* p = ecs_iter_column(it, Position, 0);
+	Velocity* v = ecs_iter_column(it, Velocity, 1);
+	for (u32 i = 0; i < it->cnt; i++) {
+		p[i].pos = v3_add(p[i].pos, v[i].vel);
+	}
+}
+
+static void bounce_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	Position* p = ecs_iter_column(it, Position, 0);
+	Velocity* v = ecs_iter_column(it, Velocity, 1);
+	for (u32 i = 0; i < it->cnt; i++) {
+		if (p[i].pos.x < 0 || p[i].pos.x > 1000) v[i].vel.x = -v[i].vel.x;
+		if (p[i].pos.y < 0 || p[i].pos.y > 1000) v[i].vel.y = -v[i].vel.y;
+	}
+}
+
+static void fade_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	Tint* t = ecs_iter_column(it, Tint, 0);
+	for (u32 i = 0; i < it->cnt; i++) {
+		t[i].color.a = 0.5f + 0.5f * sinf(t[i].color.r + t[i].color.a);
+	}
+}
+
+static void age_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	Lifetime* l = ecs_iter_column(it, Lifetime, 0);
+	for (u32 i = 0; i < it->cnt; i++) {
+		l[i].time += 0.016f;
+		l[i].scale = expf(-l[i].time) * cosf(l[i].time);
+	}
+}
+
+static void spin_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	Spin* s = ecs_iter_column(it, Spin, 0);
+	for (u32 i = 0; i < it->cnt; i++) {
+		s[i].angle += 0.01f;
+		s[i].rot = rotate_z(s[i].angle);
+	}
+}
+
+static f64 checksum(ECS* ecs) {
+	f64 sum = 0;
+	ecs_for_each_comp(ecs, Position, { sum += comp->pos.x + comp->pos.y; });
+	ecs_for_each_comp(ecs, Spin, { sum += comp->rot.m[0][0]; });
+	return sum;
+}
+
+// Every row starts from the same state so the checksums must match
+static Entity* ents;
+
+static void reset_state(ECS* ecs) {
+	bench_rand_state = 0x9e3779b97f4a7c15ull;
+	for (u32 i = 0; i < ENTITY_CNT; i++) {
+		Entity e = ents[i];
+		f32 r = (f32) (bench_rand() % 1000);
+		entity_get_component(ecs, e, Position)->pos = (v3) { r, 1000 - r, 0 };
+		entity_get_component(ecs, e, Velocity)->vel = (v3) { 1, -1, 0 };
+		entity_get_component(ecs, e, Tint)->color = (v4) { r, 1, 1, 1 };
+		*entity_get_component(ecs, e, Lifetime) = (Lifetime) { 0, 1 };
+		entity_get_component(ecs, e, Spin)->angle = r;
+	}
+}
+
+static f64 bench_threads(ECS* ecs, u32 thread_cnt, f64 base_ns) {
+	reset_state(ecs);
+
+	ECS_Scheduler* sched = ecs_scheduler_new(ecs, thread_cnt);
+	ecs_system_add(sched, (ECS_System) {
+		.name = "move", .fn = move_system, .parallel = true,
+		.query = ecs_query_new(ecs, Position, Velocity), .writes = ecs_mask(Position)
+	});
+	ecs_system_add(sched, (ECS_System) {
+		.name = "fade", .fn = fade_system, .parallel = true,
+		.query = ecs_query_new(ecs, Tint), .writes = ecs_mask(Tint)
+	});
+	ecs_system_add(sched, (ECS_System) {
+		.name = "age", .fn = age_system, .parallel = true,
+		.query = ecs_query_new(ecs, Lifetime), .writes = ecs_mask(Lifetime)
+	});
+	ecs_system_add(sched, (ECS_System) {
+		.name = "spin", .fn = spin_system, .parallel = true,
+		.query = ecs_query_new(ecs, Spin), .writes = ecs_mask(Spin)
+	});
+	ecs_system_add(sched, (ECS_System) {
+		.name = "bounce", .fn = bounce_system, .parallel = true,
+		.query = ecs_query_new(ecs, Position, Velocity), .writes = ecs_mask(Velocity)
+	});
+
+	f64 start = bench_now_ns();
+	for (u32 f = 0; f < FRAME_CNT; f++) {
+		ecs_scheduler_run(sched);
+	}
+	f64 ns = bench_now_ns() - start;
+
+	char name[64];
+	sprintf(name, "%u thread(s), %u waves", thread_cnt, sched->wave_cnt);
+	bench_report(name, (u64) ENTITY_CNT * FRAME_CNT, ns);
+	printf("%-40s %12.2f ms/frame %8.2fx  checksum %.3f\n", "", ns / FRAME_CNT / 1e6, base_ns ? base_ns / ns : 1.0, checksum(ecs));
+
+	ecs_scheduler_delete(sched);
+	return ns;
+}
+
+int main() {
+	ctx = ctx_new();
+
+	ECS* ecs = ecs_new(ENTITY_CNT);
+	ents = malloc(sizeof(Entity) * ENTITY_CNT);
+	entity_new_n(ecs, ents, ENTITY_CNT);
+	for (u32 i = 0; i < ENTITY_CNT; i++) {
+		Entity e = ents[i];
+		entity_add_component(ecs, e, Position, { 0 });
+		entity_add_component(ecs, e, Velocity, { 0 });
+		entity_add_component(ecs, e, Tint, { 0 });
+		entity_add_component(ecs, e, Lifetime, { 0 });
+		entity_add_component(ecs, e, Spin, { 0 });
+	}
+
+	u32 cpu_cnt = thread_pool_cpu_cnt();
+	printf("%u entities, %u frames, %u cpus\n", ENTITY_CNT, FRAME_CNT, cpu_cnt);
+
+	f64 base_ns = 0;
+	for (u32 t = 1; t <= cpu_cnt; t++) {
+		f64 ns = bench_threads(ecs, t, base_ns);
+		if (t == 1) base_ns = ns;
+	}
+
+	entity_delete_n(ecs, ents, ENTITY_CNT);
+	free(ents);
+	ecs_delete(ecs);
+
+	ctx_delete(ctx);
+	return 0;
+}
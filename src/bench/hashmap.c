@@ -0,0 +1,66 @@
+#include "core/ctx.h"
+#include "core/hashmap.h"
+#include "bench/bench.h"
+
+extern Context* ctx;
+
+static void bench_hashmap(u32 cnt) {
+	Hashmap(u64, u64) map = NULL;
+	char name[64];
+
+	u64* keys = malloc(sizeof(u64) * cnt);
+	for (u32 i = 0; i < cnt; i++)
+		keys[i] = bench_rand();
+
+	f64 start = bench_now_ns();
+	for (u32 i = 0; i < cnt; i++) {
+		hashmap_insert(map, keys[i], i);
+	}
+	f64 ns = bench_now_ns() - start;
+	sprintf(name, "insert %u", cnt);
+	bench_report(name, cnt, ns);
+
+	// Hits in a different order than insertion
+	u64 sum = 0;
+	start = bench_now_ns();
+	for (u32 i = 0; i < cnt; i++) {
+		sum += *hashmap_find(map, keys[(u64) i * 7919 % cnt]);
+	}
+	ns = bench_now_ns() - start;
+	sprintf(name, "lookup hit %u", cnt);
+	bench_report(name, cnt, ns);
+
+	u32 misses = 0;
+	start = bench_now_ns();
+	for (u32 i = 0; i < cnt; i++) {
+		misses += !hashmap_exists(map, keys[i] ^ 0x5555555555555555ull);
+	}
+	ns = bench_now_ns() - start;
+	sprintf(name, "lookup miss %u", cnt);
+	bench_report(name, cnt, ns);
+
+	start = bench_now_ns();
+	for (u32 i = 0; i < cnt; i++) {
+		sum += hashmap_pop(map, keys[i]);
+	}
+	ns = bench_now_ns() - start;
+	sprintf(name, "erase %u", cnt);
+	bench_report(name, cnt, ns);
+
+	assert(hashmap_len(map) == 0, "Hashmap not empty after erasing every key.\n");
+	printf("(checksum %llu, misses %u)\n\n", sum, misses);
+
+	hashmap_delete(map);
+	free(keys);
+}
+
+int main() {
+	ctx = ctx_new();
+
+	bench_hashmap(1000);
+	bench_hashmap(100000);
+	bench_hashmap(10000000);
+
+	ctx_delete(ctx);
+	return 0;
+}
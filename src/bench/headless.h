@@ -0,0 +1,49 @@
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include "core/defines.h"
+#include "core/log.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/*
+ * @brief Offscreen GL 4.4 core context for benchmarks, no window or display needed
+ * @info Works with Mesa llvmpipe. Nothing is presented, render into an FBO.
+ */
+
+static void headless_gl_init() {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay display = get_display
+		? get_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+		: eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	assert(eglInitialize(display, &major, &minor), "Failed to initialize egl (0x%x).\n", eglGetError());
+
+	EGLint config_attrs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint config_cnt = 0;
+	eglChooseConfig(display, config_attrs, &config, 1, &config_cnt);
+
+	EGLint context_attrs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 4,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	eglBindAPI(EGL_OPENGL_API);
+	EGLContext context = eglCreateContext(display, config_cnt ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attrs);
+	assert(context != EGL_NO_CONTEXT, "Failed to create gl context (0x%x).\n", eglGetError());
+	assert(eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context), "Failed to make gl context current.\n");
+
+	// Glx part of glew fails without an X display, the gl part is what matters
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+	assert(err == GLEW_OK || err == GLEW_ERROR_NO_GLX_DISPLAY, "Failed to initialize glew (%d).\n", err);
+	while (glGetError());
+
+	printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+}
+
+#endif // __HEADLESS_H__
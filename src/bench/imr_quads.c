@@ -0,0 +1,110 @@
+#include "core/ctx.h"
+#include "graphics/imr.h"
+#include "bench/bench.h"
+
+#include <string.h>
+
+#define QUAD_CNT  1000000
+#define ROUND_CNT 10
+
+extern Context* ctx;
+
+static Quad_Desc quads[QUAD_CNT];
+static Vertex expected[MAX_VERT_CNT];
+static Vertex verts[MAX_VERT_CNT];
+
+/*
+ * Replica of the previous imr_push_quad_tex vertex generation: every corner
+ * goes through m4_mul_v3 and its w divide
+ */
+
+static void old_build_quad(Vertex* out, const Quad_Desc* q) {
+	v3 pos = q->pos;
+	v2 size = q->size;
+	Rect r = q->tex_rect;
+	v3 p[4] = {
+		m4_mul_v3(q->rot, (v3) { -size.x / 2, -size.y / 2, 0.0f }),
+		m4_mul_v3(q->rot, (v3) {  size.x / 2, -size.y / 2, 0.0f }),
+		m4_mul_v3(q->rot, (v3) {  size.x / 2,  size.y / 2, 0.0f }),
+		m4_mul_v3(q->rot, (v3) { -size.x / 2,  size.y / 2, 0.0f })
+	};
+	v2 uv[4] = {
+		{ r.x, r.y }, { r.x + r.w, r.y }, { r.x + r.w, r.y + r.h }, { r.x, r.y + r.h }
+	};
+	for (u32 c = 0; c < 4; c++) {
+		p[c] = v3_add(p[c], (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
+		out[c] = imr_vertex(p[c], q->color, uv[c], q->tex_id);
+	}
+}
+
+// Builds every quad a batch at a time like imr_push_quads, checking the batches against the replica
+static void bench_build(const char* name, u32 per_call) {
+	b32 match = true;
+	for (u32 first = 0; first < QUAD_CNT; first += MAX_QUAD_CNT) {
+		u32 cnt = first + MAX_QUAD_CNT < QUAD_CNT ? MAX_QUAD_CNT : QUAD_CNT - first;
+		for (u32 i = 0; i < cnt; i++) old_build_quad(&expected[i * 4], &quads[first + i]);
+		for (u32 i = 0; i < cnt; i += per_call) imr_build_quads(&verts[i * 4], &quads[first + i], per_call);
+		match &= memcmp(expected, verts, sizeof(Vertex) * 4 * cnt) == 0;
+	}
+
+	f64 start = bench_now_ns();
+	for (u32 round = 0; round < ROUND_CNT; round++) {
+		for (u32 first = 0; first < QUAD_CNT; first += MAX_QUAD_CNT) {
+			u32 cnt = first + MAX_QUAD_CNT < QUAD_CNT ? MAX_QUAD_CNT : QUAD_CNT - first;
+			for (u32 i = 0; i < cnt; i += per_call) imr_build_quads(&verts[i * 4], &quads[first + i], per_call);
+		}
+	}
+	f64 ns = bench_now_ns() - start;
+	bench_report(name, (u64) QUAD_CNT * ROUND_CNT, ns);
+	printf("%-40s %12.2f M quads/s  %s\n", "", QUAD_CNT * ROUND_CNT / ns * 1e3, match ? "matches replica" : "MISMATCH");
+}
+
+static void bench_old(const char* name) {
+	f64 start = bench_now_ns();
+	for (u32 round = 0; round < ROUND_CNT; round++) {
+		for (u32 first = 0; first < QUAD_CNT; first += MAX_QUAD_CNT) {
+			u32 cnt = first + MAX_QUAD_CNT < QUAD_CNT ? MAX_QUAD_CNT : QUAD_CNT - first;
+			for (u32 i = 0; i < cnt; i++) old_build_quad(&verts[i * 4], &quads[first + i]);
+		}
+	}
+	f64 ns = bench_now_ns() - start;
+	bench_report(name, (u64) QUAD_CNT * ROUND_CNT, ns);
+	printf("%-40s %12.2f M quads/s\n", "", QUAD_CNT * ROUND_CNT / ns * 1e3);
+}
+
+static void fill_quads(b32 perspective) {
+	bench_rand_state = 0x9e3779b97f4a7c15ull;
+	for (u32 i = 0; i < QUAD_CNT; i++) {
+		m4 rot = rotate_z((f32) (bench_rand() % 628) / 100.0f);
+		if (perspective) rot.m[0][3] = 0.001f * (f32) (bench_rand() % 10);
+		quads[i] = (Quad_Desc) {
+			.pos = { (f32) (bench_rand() % 1280), (f32) (bench_rand() % 720), 0 },
+			.size = { (f32) (1 + bench_rand() % 32), (f32) (1 + bench_rand() % 32) },
+			.tex_rect = { 0.25f, 0, 0.25f, 1 },
+			.tex_id = 1,
+			.rot = rot,
+			.color = { 1, 0.5f, 0.25f, 1 }
+		};
+	}
+}
+
+int main() {
+	ctx = ctx_new();
+#if defined(__SSE2__) && !defined(IMR_NO_SIMD)
+	printf("%u quads, %zu byte vertices, SSE\n", QUAD_CNT, sizeof(Vertex));
+#else
+	printf("%u quads, %zu byte vertices, scalar\n", QUAD_CNT, sizeof(Vertex));
+#endif
+
+	fill_quads(false);
+	bench_old("old per quad, rotations");
+	bench_build("imr_build_quads x1, rotations", 1);
+	bench_build("imr_build_quads batched, rotations", 4);
+
+	fill_quads(true);
+	bench_old("old per quad, projective");
+	bench_build("imr_build_quads batched, projective", 4);
+
+	ctx_delete(ctx);
+	return 0;
+}
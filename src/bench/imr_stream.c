@@ -0,0 +1,68 @@
+#include "core/ctx.h"
+#include "graphics/imr.h"
+#include "graphics/fbo.h"
+#include "bench/bench.h"
+#include "bench/headless.h"
+
+#define QUAD_CNT   100000
+#define FRAME_CNT  60
+#define SURF_W     1280
+#define SURF_H     720
+
+extern Context* ctx;
+
+static v3 quad_pos[QUAD_CNT];
+
+static void draw_frame(IMR* imr, v2 size) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	imr_begin(imr);
+	for (u32 i = 0; i < QUAD_CNT; i++) {
+		imr_push_quad(imr, quad_pos[i], size, rotate_z(0), (v4) { 1, 0.5f, 0.25f, 1 });
+	}
+	imr_end(imr);
+}
+
+static void bench_frames(IMR* imr, const char* name, v2 size) {
+	// Warming up the driver
+	draw_frame(imr, size);
+	glFinish();
+
+	// Frames queued back to back like a vsync-less game loop
+	f64 start = bench_now_ns();
+	for (u32 f = 0; f < FRAME_CNT; f++) {
+		draw_frame(imr, size);
+	}
+	glFinish();
+	f64 ns = bench_now_ns() - start;
+	bench_report(name, FRAME_CNT, ns);
+}
+
+int main() {
+	headless_gl_init();
+	ctx = ctx_new();
+
+	FBO fbo = unwrap(fbo_new(SURF_W, SURF_H));
+	IMR imr = unwrap(imr_new());
+	printf("%s vertex streaming, %zu byte vertices\n", imr.persistent ? "persistent mapped ring" : "glBufferSubData", sizeof(Vertex));
+
+	for (u32 i = 0; i < QUAD_CNT; i++) {
+		quad_pos[i] = (v3) { (f32) (bench_rand() % SURF_W), (f32) (bench_rand() % SURF_H), 0 };
+	}
+
+	glViewport(0, 0, SURF_W, SURF_H);
+	fbo_bind(&fbo);
+	// Same orientation ocamera_calc_mvp produces
+	m4 mvp = m4_transpose(ortho_projection(0, SURF_W, SURF_H, 0, -1, 1000));
+	imr_begin(&imr);
+	imr_update_mvp(&imr, mvp);
+
+	// Empty quads produce no fragments, leaving only the vertex streaming
+	bench_frames(&imr, "frame, 100K 4x4 quads", (v2) { 4, 4 });
+	bench_frames(&imr, "frame, 100K empty quads", (v2) { 0, 0 });
+
+	fbo_unbind();
+	imr_delete(&imr);
+	fbo_delete(&fbo);
+	ctx_delete(ctx);
+	return 0;
+}
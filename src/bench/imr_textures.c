@@ -0,0 +1,108 @@
+#include "core/ctx.h"
+#include "graphics/imr.h"
+#include "graphics/draw_list.h"
+#include "graphics/fbo.h"
+#include "bench/bench.h"
+#include "bench/headless.h"
+
+#define SPRITE_CNT 100000
+#define TEX_CNT    512
+#define FRAME_CNT  10
+#define SURF_W     1280
+#define SURF_H     720
+
+extern Context* ctx;
+
+static Quad_Desc quads[SPRITE_CNT];
+
+static void imr_frame(IMR* imr, Draw_List* list, m4 mvp) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	imr_begin(imr);
+	imr_push_quads(imr, quads, SPRITE_CNT);
+	imr_end(imr);
+}
+
+static void draw_list_frame(IMR* imr, Draw_List* list, m4 mvp) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	for (u32 i = 0; i < SPRITE_CNT; i++) {
+		draw_list_push_quad(list, (Draw_State) { 0 }, &quads[i]);
+	}
+	draw_list_flush(list, imr, mvp);
+}
+
+#define bench_frames(name, frame, imr, list, mvp) do {               \
+	/* Warming up the driver */                                      \
+	frame(imr, list, mvp);                                           \
+	glFinish();                                                      \
+	f64 start = bench_now_ns();                                      \
+	for (u32 f = 0; f < FRAME_CNT; f++) {                            \
+		imr_reset_stats(imr);                                        \
+		frame(imr, list, mvp);                                       \
+	}                                                                \
+	glFinish();                                                      \
+	f64 ns = bench_now_ns() - start;                                 \
+	bench_report(name, FRAME_CNT, ns);                               \
+	imr_print_stats(imr);                                            \
+} while (0)
+
+int main() {
+	headless_gl_init();
+	ctx = ctx_new();
+
+	FBO fbo = unwrap(fbo_new(SURF_W, SURF_H));
+	IMR imr = unwrap(imr_new());
+	Draw_List* list = draw_list_new();
+
+	Texture textures[TEX_CNT];
+	for (u32 i = 0; i < TEX_CNT; i++) {
+		u32 pixel = 0xff000000 | (u32) bench_rand();
+		textures[i] = unwrap(texture_from_data(1, 1, &pixel));
+	}
+
+	// Every sprite picks one of the textures at random
+	for (u32 i = 0; i < SPRITE_CNT; i++) {
+		quads[i] = (Quad_Desc) {
+			.pos = { (f32) (bench_rand() % SURF_W), (f32) (bench_rand() % SURF_H), 0 },
+			.size = { 4, 4 },
+			.tex_rect = { 0, 0, 1, 1 },
+			.tex_id = textures[bench_rand() % TEX_CNT].id,
+			.rot = rotate_z((f32) (bench_rand() % 628) / 100.0f),
+			.color = { 1, 1, 1, 1 }
+		};
+	}
+	printf("%u sprites, %u textures\n", SPRITE_CNT, TEX_CNT);
+
+	glViewport(0, 0, SURF_W, SURF_H);
+	fbo_bind(&fbo);
+
+	// Same orientation ocamera_calc_mvp produces
+	m4 mvp = m4_transpose(ortho_projection(0, SURF_W, SURF_H, 0, -1, 1000));
+	imr_begin(&imr);
+	imr_update_mvp(&imr, mvp);
+
+	// IMR takes bindless textures whenever the driver lists GL_ARB_bindless_texture,
+	// building with -DIMR_NO_BINDLESS measures texture units on such drivers
+	if (imr.bindless) {
+		bench_frames("imr frame, bindless textures", imr_frame, &imr, list, mvp);
+		bench_frames("draw list frame, bindless textures", draw_list_frame, &imr, list, mvp);
+		printf("  %u texture handles resident\n", imr.handles.handle_cnt);
+	} else {
+		bench_frames("imr frame, texture units", imr_frame, &imr, list, mvp);
+		bench_frames("draw list frame, texture units", draw_list_frame, &imr, list, mvp);
+#ifdef IMR_NO_BINDLESS
+		printf("bindless textures: skipped, built with IMR_NO_BINDLESS\n");
+#else
+		printf("bindless textures: skipped, GL_ARB_bindless_texture is missing\n");
+#endif
+	}
+
+	fbo_unbind();
+	for (u32 i = 0; i < TEX_CNT; i++) {
+		texture_delete(textures[i]);
+	}
+	draw_list_delete(list);
+	imr_delete(&imr);
+	fbo_delete(&fbo);
+	ctx_delete(ctx);
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include "core/ctx.h"
+#include "graphics/imr.h"
+#include "graphics/isr.h"
+#include "graphics/fbo.h"
+#include "bench/bench.h"
+#include "bench/headless.h"
+
+#define SPRITE_CNT 1000000
+#define FRAME_CNT  10
+#define SURF_W     1280
+#define SURF_H     720
+
+extern Context* ctx;
+
+typedef struct {
+	v3 pos;
+	f32 rot;
+	v4 color;
+} Particle;
+
+static Particle particles[SPRITE_CNT];
+
+// Time spent building sprites on the cpu, the rest of a frame is driver and raster work
+static f64 push_ns;
+
+static void imr_frame(IMR* imr, v2 size) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	for (u32 first = 0; first < SPRITE_CNT; first += MAX_QUAD_CNT) {
+		u32 last = first + MAX_QUAD_CNT < SPRITE_CNT ? first + MAX_QUAD_CNT : SPRITE_CNT;
+		imr_begin(imr);
+		f64 start = bench_now_ns();
+		for (u32 i = first; i < last; i++) {
+			Particle* p = &particles[i];
+			imr_push_quad_tex(imr, p->pos, size, (Rect) { 0, 0, 1, 1 }, imr->white.id, rotate_z(p->rot), p->color);
+		}
+		push_ns += bench_now_ns() - start;
+		imr_end(imr);
+	}
+}
+
+static void isr_frame(ISR* isr, v2 size) {
+	imr_clear((v4) { 0, 0, 0, 1 });
+	for (u32 first = 0; first < SPRITE_CNT; first += MAX_SPRITE_CNT) {
+		u32 last = first + MAX_SPRITE_CNT < SPRITE_CNT ? first + MAX_SPRITE_CNT : SPRITE_CNT;
+		isr_begin(isr);
+		f64 start = bench_now_ns();
+		for (u32 i = first; i < last; i++) {
+			Particle* p = &particles[i];
+			isr_push_sprite_tex(isr, p->pos, size, p->rot, (Rect) { 0, 0, 1, 1 }, isr->white.id, p->color);
+		}
+		push_ns += bench_now_ns() - start;
+		isr_end(isr);
+	}
+}
+
+#define bench_frames(name, frame, r, size) do {                      \
+	/* Warming up the driver */                                      \
+	frame(r, size);                                                  \
+	glFinish();                                                      \
+	push_ns = 0;                                                     \
+	f64 start = bench_now_ns();                                      \
+	for (u32 f = 0; f < FRAME_CNT; f++) {                            \
+		frame(r, size);                                              \
+	}                                                                \
+	glFinish();                                                      \
+	f64 ns = bench_now_ns() - start;                                 \
+	bench_report(name, FRAME_CNT, ns);                               \
+	printf("%-40s %12.2f ns/sprite built on the cpu\n", "", push_ns / FRAME_CNT / SPRITE_CNT); \
+} while (0)
+
+int main() {
+	headless_gl_init();
+	ctx = ctx_new();
+
+	FBO fbo = unwrap(fbo_new(SURF_W, SURF_H));
+	IMR imr = unwrap(imr_new());
+	ISR isr = unwrap(isr_new());
+	printf("%u sprites, %zu bytes per imr quad, %zu bytes per isr sprite\n", SPRITE_CNT, 4 * sizeof(Vertex), sizeof(Sprite));
+
+	for (u32 i = 0; i < SPRITE_CNT; i++) {
+		particles[i] = (Particle) {
+			.pos = { (f32) (bench_rand() % SURF_W), (f32) (bench_rand() % SURF_H), 0 },
+			.rot = (f32) (bench_rand() % 628) / 100.0f,
+			.color = { 1, 0.5f, 0.25f, 1 }
+		};
+	}
+
+	glViewport(0, 0, SURF_W, SURF_H);
+	fbo_bind(&fbo);
+
+	// Same orientation ocamera_calc_mvp produces
+	m4 mvp = m4_transpose(ortho_projection(0, SURF_W, SURF_H, 0, -1, 1000));
+	imr_begin(&imr);
+	imr_update_mvp(&imr, mvp);
+	isr_update_mvp(&isr, mvp);
+
+	bench_frames("imr frame, 1M 2x2 sprites", imr_frame, &imr, ((v2) { 2, 2 }));
+	bench_frames("isr frame, 1M 2x2 sprites", isr_frame, &isr, ((v2) { 2, 2 }));
+
+	// Empty sprites produce no fragments, leaving the sprite submission
+	bench_frames("imr frame, 1M empty sprites", imr_frame, &imr, ((v2) { 0, 0 }));
+	bench_frames("isr frame, 1M empty sprites", isr_frame, &isr, ((v2) { 0, 0 }));
+
+	fbo_unbind();
+	isr_delete(&isr);
+	imr_delete(&imr);
+	fbo_delete(&fbo);
+	ctx_delete(ctx);
+	return 0;
+}
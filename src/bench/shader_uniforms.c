@@ -0,0 +1,267 @@
+#include "core/ctx.h"
+#include "graphics/shader.h"
+#include "graphics/imr.h"
+#include "bench/bench.h"
+#include "bench/headless.h"
+
+#define LIGHT_CNT 100
+#define FRAME_CNT 1000
+#define SURF_W    1280
+#define SURF_H    720
+#define BINDING   1
+
+extern Context* ctx;
+extern const char* v_src;
+
+// Lights as uniform arrays, the array size has to match LIGHT_CNT
+static const char* array_src =
+	"#version 440 core\n"
+	"layout (location = 0) out vec4 color;\n"
+	"struct Light { vec2 pos; float radius; float intensity; float dir; float fov; vec4 color; };\n"
+	"uniform vec2 dim;\n"
+	"uniform Light light[100];\n"
+	"uniform int light_cnt;\n"
+	"void main() {\n"
+	"vec4 c = vec4(0);\n"
+	"for (int i = 0; i < light_cnt; i++)\n"
+	"c += light[i].color * light[i].intensity * light[i].radius * light[i].dir * light[i].fov * light[i].pos.x;\n"
+	"color = c / dim.x;\n"
+	"}\n";
+
+// Lights in a std430 buffer, same layout as Light_Data of the game renderer
+static const char* buffer_src =
+	"#version 440 core\n"
+	"layout (location = 0) out vec4 color;\n"
+	"struct Light { vec2 pos; float radius; float intensity; float dir; float fov; vec4 color; };\n"
+	"layout (std430, binding = 1) readonly buffer Lights { Light light[]; };\n"
+	"uniform vec2 dim;\n"
+	"uniform int light_cnt;\n"
+	"void main() {\n"
+	"vec4 c = vec4(0);\n"
+	"for (int i = 0; i < light_cnt; i++)\n"
+	"c += light[i].color * light[i].intensity * light[i].radius * light[i].dir * light[i].fov * light[i].pos.x;\n"
+	"color = c / dim.x;\n"
+	"}\n";
+
+typedef struct {
+	v2 pos;
+	f32 radius, intensity, dir, fov;
+	f32 pad[2];
+	v4 color;
+} Bench_Light;
+
+static Bench_Light lights[LIGHT_CNT];
+
+// Two programs read the lights, like the color and light pass of the game
+typedef struct {
+	Shader passes[2];
+	b32 moving;
+} Frame;
+
+static void move_lights(Frame* f) {
+	if (!f->moving) return;
+	for (u32 i = 0; i < LIGHT_CNT; i++) {
+		lights[i].pos.x += 1.0f;
+		lights[i].dir += 0.01f;
+	}
+}
+
+static u32 gl_calls;
+
+/*
+ * Replica of the first renderer: locations looked up by name every frame
+ */
+
+static i32 old_loc(Shader* shader, const char* name) {
+	gl_calls++;
+	return GLCall(glGetUniformLocation(shader->id, name));
+}
+
+static void old_lights(Shader* shader, b32 full) {
+	GLCall(glUseProgram(shader->id));
+	GLCall(glUniform2f(old_loc(shader, "dim"), SURF_W, SURF_H));
+	GLCall(glUniform1i(old_loc(shader, "light_cnt"), LIGHT_CNT));
+	gl_calls += 3;
+
+	// Only the lights changed since the last upload were sent
+	if (!full) return;
+	char buff[64];
+	for (u32 i = 0; i < LIGHT_CNT; i++) {
+		Bench_Light* l = &lights[i];
+		sprintf(buff, "light[%u].pos", i);
+		GLCall(glUniform2f(old_loc(shader, buff), l->pos.x, l->pos.y));
+		sprintf(buff, "light[%u].radius", i);
+		GLCall(glUniform1f(old_loc(shader, buff), l->radius));
+		sprintf(buff, "light[%u].intensity", i);
+		GLCall(glUniform1f(old_loc(shader, buff), l->intensity));
+		sprintf(buff, "light[%u].dir", i);
+		GLCall(glUniform1f(old_loc(shader, buff), l->dir));
+		sprintf(buff, "light[%u].fov", i);
+		GLCall(glUniform1f(old_loc(shader, buff), l->fov));
+		sprintf(buff, "light[%u].color", i);
+		GLCall(glUniform4f(old_loc(shader, buff), l->color.r, l->color.g, l->color.b, l->color.a));
+		gl_calls += 6;
+	}
+}
+
+static void old_frame(Frame* f) {
+	move_lights(f);
+	old_lights(&f->passes[0], f->moving);
+	old_lights(&f->passes[1], f->moving);
+}
+
+/*
+ * Uniform positions looked up once, values set through the shader setters
+ */
+
+typedef struct {
+	i32 dim, light_cnt;
+	i32 pos[LIGHT_CNT], radius[LIGHT_CNT], intensity[LIGHT_CNT];
+	i32 dir[LIGHT_CNT], fov[LIGHT_CNT], color[LIGHT_CNT];
+} Bench_Light_Uniforms;
+
+static Bench_Light_Uniforms pass_u[2];
+
+static void find_light_uniforms(Shader* shader, Bench_Light_Uniforms* u) {
+	char buff[64];
+	u->dim = shader_uniform(shader, "dim");
+	u->light_cnt = shader_uniform(shader, "light_cnt");
+	for (u32 i = 0; i < LIGHT_CNT; i++) {
+		sprintf(buff, "light[%u].pos", i);
+		u->pos[i] = shader_uniform(shader, buff);
+		sprintf(buff, "light[%u].radius", i);
+		u->radius[i] = shader_uniform(shader, buff);
+		sprintf(buff, "light[%u].intensity", i);
+		u->intensity[i] = shader_uniform(shader, buff);
+		sprintf(buff, "light[%u].dir", i);
+		u->dir[i] = shader_uniform(shader, buff);
+		sprintf(buff, "light[%u].fov", i);
+		u->fov[i] = shader_uniform(shader, buff);
+		sprintf(buff, "light[%u].color", i);
+		u->color[i] = shader_uniform(shader, buff);
+		assert(u->pos[i] != -1 && u->color[i] != -1, "Cannot find uniforms of light %u\n", i);
+	}
+}
+
+static void cached_lights(Shader* shader, Bench_Light_Uniforms* u, b32 full) {
+	GLCall(glUseProgram(shader->id));
+	gl_calls++;
+	shader_set_v2(shader, u->dim, (v2) { SURF_W, SURF_H });
+	shader_set_i32(shader, u->light_cnt, LIGHT_CNT);
+
+	// Same filter as the old path, unchanged values left in it make no GL call
+	if (!full) return;
+	for (u32 i = 0; i < LIGHT_CNT; i++) {
+		Bench_Light* l = &lights[i];
+		shader_set_v2(shader, u->pos[i], l->pos);
+		shader_set_f32(shader, u->radius[i], l->radius);
+		shader_set_f32(shader, u->intensity[i], l->intensity);
+		shader_set_f32(shader, u->dir[i], l->dir);
+		shader_set_f32(shader, u->fov[i], l->fov);
+		shader_set_v4(shader, u->color[i], l->color);
+	}
+}
+
+static void cached_frame(Frame* f) {
+	move_lights(f);
+	cached_lights(&f->passes[0], &pass_u[0], f->moving);
+	cached_lights(&f->passes[1], &pass_u[1], f->moving);
+}
+
+/*
+ * Lights in one buffer shared by both programs, changed lights sent as one range
+ */
+
+static u32 ssbo;
+static Bench_Light_Uniforms buffer_u[2];
+
+static void buffer_frame(Frame* f) {
+	move_lights(f);
+
+	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo));
+	gl_calls++;
+	if (f->moving) {
+		GLCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(lights), lights));
+		gl_calls++;
+	}
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, ssbo));
+	gl_calls++;
+
+	for (u32 p = 0; p < 2; p++) {
+		GLCall(glUseProgram(f->passes[p].id));
+		gl_calls++;
+		shader_set_v2(&f->passes[p], buffer_u[p].dim, (v2) { SURF_W, SURF_H });
+		shader_set_i32(&f->passes[p], buffer_u[p].light_cnt, LIGHT_CNT);
+	}
+}
+
+static void bench_frames(Frame* f, void (*frame)(Frame*), const char* name) {
+	frame(f);
+	gl_calls = 0;
+	u32 uploads = shader_upload_cnt();
+
+	f64 start = bench_now_ns();
+	for (u32 i = 0; i < FRAME_CNT; i++) {
+		frame(f);
+	}
+	glFinish();
+	f64 ns = bench_now_ns() - start;
+
+	bench_report(name, FRAME_CNT, ns);
+	printf("  %u gl calls per frame\n", (gl_calls + shader_upload_cnt() - uploads) / FRAME_CNT);
+}
+
+int main() {
+	headless_gl_init();
+	ctx = ctx_new();
+
+	for (u32 i = 0; i < LIGHT_CNT; i++) {
+		lights[i] = (Bench_Light) {
+			.pos = { (f32) (bench_rand() % SURF_W), (f32) (bench_rand() % SURF_H) },
+			.radius = 100, .intensity = 1, .dir = 0, .fov = 6.28f,
+			.color = { 1, 1, 1, 1 }
+		};
+	}
+	printf("%u lights read by 2 programs\n", LIGHT_CNT);
+
+	Frame array = {
+		.passes = {
+			unwrap(shader_new(v_src, array_src)),
+			unwrap(shader_new(v_src, array_src))
+		}
+	};
+	find_light_uniforms(&array.passes[0], &pass_u[0]);
+	find_light_uniforms(&array.passes[1], &pass_u[1]);
+
+	Frame buffer = {
+		.passes = {
+			unwrap(shader_new(v_src, buffer_src)),
+			unwrap(shader_new(v_src, buffer_src))
+		}
+	};
+	for (u32 p = 0; p < 2; p++) {
+		buffer_u[p].dim = shader_uniform(&buffer.passes[p], "dim");
+		buffer_u[p].light_cnt = shader_uniform(&buffer.passes[p], "light_cnt");
+	}
+	GLCall(glGenBuffers(1, &ssbo));
+	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo));
+	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(lights), lights, GL_DYNAMIC_DRAW));
+
+	array.moving = buffer.moving = false;
+	bench_frames(&array, old_frame, "lookup per frame, static lights");
+	bench_frames(&array, cached_frame, "cached uniforms, static lights");
+	bench_frames(&buffer, buffer_frame, "light buffer, static lights");
+
+	array.moving = buffer.moving = true;
+	bench_frames(&array, old_frame, "lookup per frame, every light moving");
+	bench_frames(&array, cached_frame, "cached uniforms, every light moving");
+	bench_frames(&buffer, buffer_frame, "light buffer, every light moving");
+
+	GLCall(glDeleteBuffers(1, &ssbo));
+	for (u32 p = 0; p < 2; p++) {
+		shader_delete(array.passes[p]);
+		shader_delete(buffer.passes[p]);
+	}
+	ctx_delete(ctx);
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include "core/trace_allocator.h"
+#include "bench/bench.h"
+
+#define BLOCK_CNT 1000000
+
+int main() {
+	Trace_Allocator* allocator = trace_allocator_new();
+
+	void** ptrs = malloc(sizeof(void*) * BLOCK_CNT);
+	u32* order = malloc(sizeof(u32) * BLOCK_CNT);
+	for (u32 i = 0; i < BLOCK_CNT; i++)
+		order[i] = i;
+	bench_shuffle_u32(order, BLOCK_CNT);
+
+	f64 start = bench_now_ns();
+	for (u32 i = 0; i < BLOCK_CNT; i++) {
+		ptrs[i] = trace_allocator_alloc(allocator, 16 + bench_rand() % 112);
+	}
+	f64 alloc_ns = bench_now_ns() - start;
+
+	start = bench_now_ns();
+	for (u32 i = 0; i < BLOCK_CNT; i++) {
+		trace_allocator_free(allocator, ptrs[order[i]]);
+	}
+	f64 free_ns = bench_now_ns() - start;
+
+	bench_report("trace_allocator_alloc", BLOCK_CNT, alloc_ns);
+	bench_report("trace_allocator_free (random order)", BLOCK_CNT, free_ns);
+
+	free(order);
+	free(ptrs);
+	trace_allocator_delete(allocator);
+	return 0;
+}
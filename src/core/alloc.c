@@ -3,10 +3,50 @@
 
 extern Context* ctx;
 
+void* frame_alloc(i64 size) {
+	return arena_push(ctx->frame_arena, size);
+}
+
+Frame_Arena* frame_arena() {
+	return ctx->frame_arena;
+}
+
+#ifdef ENGINE_RELEASE
+
+void* __alloc(i64 size, const char* file, i32 line) {
+	void* ptr = slab_allocator_alloc(ctx->slab_allocator, size);
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void* __alloc_raw(i64 size, const char* file, i32 line) {
+	return slab_allocator_alloc(ctx->slab_allocator, size);
+}
+
+void* __alloc_resize(void* ptr, i64 size, const char* file, i32 line) {
+	return slab_allocator_realloc(ctx->slab_allocator, ptr, size);
+}
+
+void clean(void* ptr) {
+	slab_allocator_free(ctx->slab_allocator, ptr);
+}
+
+#else
+
 void* __alloc(i64 size, const char* file, i32 line) {
 	return __trace_allocator_alloc(ctx->trace_allocator, size, file, line);
 }
 
+void* __alloc_raw(i64 size, const char* file, i32 line) {
+	return __trace_allocator_alloc(ctx->trace_allocator, size, file, line);
+}
+
+void* __alloc_resize(void* ptr, i64 size, const char* file, i32 line) {
+	return __trace_allocator_realloc(ctx->trace_allocator, ptr, size, file, line);
+}
+
 void clean(void* ptr) {
 	trace_allocator_free(ctx->trace_allocator, ptr);
 }
+
+#endif
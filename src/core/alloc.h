@@ -2,9 +2,33 @@
 #define __ALLOC_H__
 
 #include "defines.h"
+#include "frame_arena.h"
+
+/*
+ * Debug builds route alloc()/clean() through the tracing allocator which
+ * zeroes memory and reports leaks. Building the engine with -DENGINE_RELEASE
+ * switches to the slab allocator, which does neither.
+ * alloc() always returns zeroed memory, alloc_raw() only does so in debug
+ * builds and is meant for hot paths that overwrite the whole block anyway.
+ * alloc_resize() behaves like realloc(), bytes past the old size are only
+ * zeroed in debug builds.
+ */
 
 #define alloc(size) __alloc(size, __FILE__, __LINE__)
+#define alloc_raw(size) __alloc_raw(size, __FILE__, __LINE__)
+#define alloc_resize(ptr, size) __alloc_resize(ptr, size, __FILE__, __LINE__)
 void* __alloc(i64 size, const char* file, i32 line);
+void* __alloc_raw(i64 size, const char* file, i32 line);
+void* __alloc_resize(void* ptr, i64 size, const char* file, i32 line);
 void clean(void* ptr);
 
+/*
+ * Scratch memory that is valid until the end of the current frame.
+ * Never pass it to clean().
+ */
+
+#define frame_alloc_array(T, cnt) ((T*) frame_alloc(sizeof(T) * (cnt)))
+void* frame_alloc(i64 size);
+Frame_Arena* frame_arena();
+
 #endif // __ALLOC_H__
@@ -2,13 +2,24 @@
 
 Context* ctx_new() {
 	Context* ctx = (Context*) malloc(sizeof(Context));
-	ctx->events = NULL;
+	event_queue_init(&ctx->events);
+#ifdef ENGINE_RELEASE
+	ctx->trace_allocator = NULL;
+	ctx->slab_allocator = slab_allocator_new();
+#else
 	ctx->trace_allocator = trace_allocator_new();
+	ctx->slab_allocator = NULL;
+#endif
+	ctx->frame_arena = frame_arena_new(FRAME_ARENA_CAP);
 	return ctx;
 }
 
 void ctx_delete(Context* ctx) {
-	dyn_array_delete(ctx->events);
+	frame_arena_delete(ctx->frame_arena);
+#ifdef ENGINE_RELEASE
+	slab_allocator_delete(ctx->slab_allocator);
+#else
 	trace_allocator_delete(ctx->trace_allocator);
+#endif
 	free(ctx);
 }
@@ -2,12 +2,17 @@
 #define __CTX_H__
 
 #include "trace_allocator.h"
+#include "slab_allocator.h"
+#include "frame_arena.h"
 #include "dyn_array.h"
 #include "event/event.h"
 
+// Only one of the allocators is created, depending on ENGINE_RELEASE
 typedef struct {
-	Dyn_Array(Event) events;
+	Event_Queue events;
 	Trace_Allocator* trace_allocator;
+	Slab_Allocator* slab_allocator;
+	Frame_Arena* frame_arena;
 } Context;
 
 Context* ctx_new();
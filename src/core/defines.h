@@ -53,6 +53,10 @@ typedef enum {
   long double: 0,                       \
       default: 1)
 
+/* @brief Macro to turn the value of a macro into a string literal. */
+#define STRINGIFY(x) __STRINGIFY(x)
+#define __STRINGIFY(x) #x
+
 
 // Declaring all the results for basic types
 RESULT(u8, u8);
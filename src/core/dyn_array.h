@@ -8,8 +8,8 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define DYN_ARR_MEMORY_CAP 100
-#define DYN_ARR_GROW_RATE 0.5
+#define DYN_ARR_MEMORY_CAP 16
+#define DYN_ARR_GROW_FACTOR 2
 
 #define Dyn_Array(T) \
 	struct {           \
@@ -27,19 +27,39 @@
 		}                         \
 	} while (0)                 \
 
-#define dyn_array_check_cap(arr)                                     \
-	do {                                                               \
-		if ((arr)->len >= (arr)->cap) {                                  \
-			void* tmp = alloc(sizeof((arr)->dummy) * (arr)->len);       \
-			memcpy(tmp, (arr)->data, sizeof((arr)->dummy) * (arr)->len);   \
-			clean((arr)->data);                                             \
-                                                                     \
-			(arr)->cap += DYN_ARR_GROW_RATE * DYN_ARR_MEMORY_CAP;          \
-			(arr)->data = alloc(sizeof((arr)->dummy) * (arr)->cap);     \
-			memcpy((arr)->data, tmp, sizeof((arr)->dummy) * (arr)->len);   \
-			clean(tmp);                                                  \
-		}                                                                \
-	} while (0)                                                        \
+#define dyn_array_reserve(arr, n)                                                 \
+	do {                                                                            \
+		if ((arr) == NULL) {                                                          \
+			(arr) = alloc(sizeof(*(arr)));                                              \
+		}                                                                             \
+		if ((arr)->cap < (n)) {                                                       \
+			(arr)->cap = (n);                                                           \
+			(arr)->data = alloc_resize((arr)->data, sizeof((arr)->dummy) * (arr)->cap); \
+		}                                                                             \
+	} while (0)                                                                     \
+
+#define dyn_array_check_cap(arr)                                                   \
+	do {                                                                             \
+		if ((arr)->len >= (arr)->cap) {                                                \
+			int new_cap = (arr)->cap * DYN_ARR_GROW_FACTOR;                              \
+			dyn_array_reserve(arr, new_cap > DYN_ARR_MEMORY_CAP ? new_cap : DYN_ARR_MEMORY_CAP); \
+		}                                                                              \
+	} while (0)                                                                      \
+
+#define dyn_array_resize(arr, n)                                                            \
+	do {                                                                                      \
+		int new_len = (n);                                                                      \
+		dyn_array_reserve(arr, new_len);                                                        \
+		if (new_len > (arr)->len) {                                                             \
+			memset((arr)->data + (arr)->len, 0, sizeof((arr)->dummy) * (new_len - (arr)->len));   \
+		}                                                                                       \
+		(arr)->len = new_len;                                                                   \
+	} while (0)                                                                               \
+
+#define dyn_array_clear(arr)    \
+	do {                          \
+		if ((arr)) (arr)->len = 0;  \
+	} while (0)                   \
 
 #define dyn_array_len(arr)      \
 	({                            \
@@ -58,13 +78,10 @@
 #define dyn_array_append(arr, ...)                                   \
 	do {                                                               \
 		if ((arr) == NULL) {                                             \
-			(arr) = alloc(sizeof(*(arr)));                              \
-			(arr)->len = 0;                                                \
-			(arr)->cap = DYN_ARR_MEMORY_CAP;                               \
-			(arr)->data = alloc(sizeof((arr)->dummy) * (arr)->cap);     \
+			dyn_array_reserve(arr, DYN_ARR_MEMORY_CAP);                    \
 		}                                                                \
 		dyn_array_check_cap(arr);                                        \
-		(arr)->data[(arr)->len++] = (__VA_ARGS__);                                 \
+		(arr)->data[(arr)->len++] = (__VA_ARGS__);                       \
 	} while (0)                                                        \
 
 #define dyn_array_get(arr, idx)                                                                            \
@@ -83,11 +100,20 @@
 	({                                                                                                       \
 		assert(idx < (arr)->len, "Tried poping index: %d to an array of length: %d\n", idx, (arr)->len);    \
 		(arr)->dummy = dyn_array_get(arr, idx);                                                                \
-		memmove((arr)->data + idx, (arr)->data + idx + 1, sizeof((arr)->dummy) * ((arr)->len - idx));          \
+		memmove((arr)->data + idx, (arr)->data + idx + 1, sizeof((arr)->dummy) * ((arr)->len - idx - 1));      \
 		(arr)->len--;                                                                                          \
 		(arr)->dummy;                                                                                          \
 	})                                                                                                       \
 
+// Removes in O(1) by moving the last element into the hole, doesn't keep order
+#define dyn_array_swap_remove(arr, idx)                                                                    \
+	({                                                                                                       \
+		assert(idx < (arr)->len, "Tried removing index: %d to an array of length: %d\n", idx, (arr)->len);  \
+		(arr)->dummy = (arr)->data[idx];                                                                       \
+		(arr)->data[idx] = (arr)->data[--(arr)->len];                                                          \
+		(arr)->dummy;                                                                                          \
+	})                                                                                                       \
+
 #define dyn_array_exists(arr, e)           \
 	({                                       \
 		bool res = false;                      \
@@ -0,0 +1,78 @@
+#include "file_map.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+Result_File_Map file_map_open(const char* path) {
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return ERR(File_Map, "Failed to open file for mapping.");
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return ERR(File_Map, "Cannot map an empty file.");
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return ERR(File_Map, "Failed to create file mapping.");
+	}
+
+	// The view keeps the mapping alive
+	void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == NULL) {
+		return ERR(File_Map, "Failed to map file.");
+	}
+
+	return OK(File_Map, (File_Map) { data, (u64) size.QuadPart });
+}
+
+void file_map_close(File_Map* map) {
+	if (map->data) UnmapViewOfFile(map->data);
+	map->data = NULL;
+	map->size = 0;
+}
+
+#else
+
+Result_File_Map file_map_open(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return ERR(File_Map, "Failed to open file for mapping.");
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size == 0) {
+		close(fd);
+		return ERR(File_Map, "Cannot map an empty file.");
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return ERR(File_Map, "Failed to map file.");
+	}
+
+	return OK(File_Map, (File_Map) { data, (u64) st.st_size });
+}
+
+void file_map_close(File_Map* map) {
+	if (map->data) munmap(map->data, map->size);
+	map->data = NULL;
+	map->size = 0;
+}
+
+#endif
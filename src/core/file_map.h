@@ -0,0 +1,23 @@
+#ifndef __FILE_MAP_H__
+#define __FILE_MAP_H__
+
+#include "core/defines.h"
+#include "core/result.h"
+
+/*
+ * Private copy-on-write view of a whole file.
+ * Pages are read from disk the first time they are touched, writes go to
+ * private copies and never reach the file.
+ */
+
+typedef struct {
+	u8* data;
+	u64 size;
+} File_Map;
+
+RESULT(File_Map, File_Map);
+
+Result_File_Map file_map_open(const char* path);
+void file_map_close(File_Map* map);
+
+#endif // __FILE_MAP_H__
@@ -0,0 +1,100 @@
+#include "frame_arena.h"
+
+static u64 arena_align(u64 offset) {
+	return (offset + FRAME_ARENA_ALIGN - 1) & ~((u64) FRAME_ARENA_ALIGN - 1);
+}
+
+Frame_Arena* frame_arena_new(u64 cap) {
+	Frame_Arena* arena = (Frame_Arena*) calloc(1, sizeof(Frame_Arena));
+	cap = arena_align(cap);
+	arena->base = (u8*) aligned_alloc(FRAME_ARENA_ALIGN, cap);
+	arena->cap = cap;
+	arena->offset = 0;
+	arena->stats.cap = cap;
+	return arena;
+}
+
+// Frees the overflow blocks starting at or past `offset`
+static void arena_free_overflow(Frame_Arena* arena, u64 offset) {
+	while (arena->overflow && arena->overflow->start >= offset) {
+		Frame_Arena_Block* block = arena->overflow;
+		arena->overflow = block->prev;
+		free(block->data);
+		free(block);
+	}
+}
+
+void frame_arena_delete(Frame_Arena* arena) {
+	arena_free_overflow(arena, 0);
+	free(arena->base);
+	free(arena);
+}
+
+void* arena_push(Frame_Arena* arena, u64 size) {
+	u64 start = arena_align(arena->offset);
+	Frame_Arena_Block* block = arena->overflow;
+	u64 end = block ? block->start + block->cap : arena->cap;
+
+	// Out of space, chaining a block at least as big as the main one
+	if (start + size > end) {
+		block = (Frame_Arena_Block*) malloc(sizeof(Frame_Arena_Block));
+		assert(block, "Failed to allocate a frame arena overflow block.\n");
+		block->prev = arena->overflow;
+		block->start = start;
+		block->cap = arena_align(size > arena->cap ? size : arena->cap);
+		block->data = (u8*) aligned_alloc(FRAME_ARENA_ALIGN, block->cap);
+		assert(block->data, "Failed to allocate %llu bytes for a frame arena overflow block.\n", block->cap);
+		arena->overflow = block;
+		arena->stats.overflow_cnt++;
+	}
+
+	arena->offset = start + size;
+	if (arena->offset > arena->stats.frame_peak)
+		arena->stats.frame_peak = arena->offset;
+	if (arena->offset > arena->stats.high_water)
+		arena->stats.high_water = arena->offset;
+
+	return block ? block->data + (start - block->start) : arena->base + start;
+}
+
+u64 arena_mark(Frame_Arena* arena) {
+	return arena->offset;
+}
+
+void arena_reset_to(Frame_Arena* arena, u64 mark) {
+	assert(mark <= arena->offset, "Tried resetting frame arena forward to %llu from %llu.\n", mark, arena->offset);
+	arena->offset = mark;
+	arena_free_overflow(arena, mark);
+}
+
+void arena_end_frame(Frame_Arena* arena) {
+	arena_free_overflow(arena, 0);
+
+	// The frame overflowed, one block holding all of it is enough for the next
+	if (arena->stats.frame_peak > arena->cap) {
+		free(arena->base);
+		arena->cap = arena_align(arena->stats.frame_peak);
+		arena->base = (u8*) aligned_alloc(FRAME_ARENA_ALIGN, arena->cap);
+		assert(arena->base, "Failed to grow the frame arena to %llu bytes.\n", arena->cap);
+		arena->stats.cap = arena->cap;
+	}
+
+	arena->stats.last_frame_peak = arena->stats.frame_peak;
+	arena->stats.frame_peak = 0;
+	arena->stats.frame_cnt++;
+	arena->offset = 0;
+}
+
+Frame_Arena_Stats arena_stats(Frame_Arena* arena) {
+	Frame_Arena_Stats stats = arena->stats;
+	stats.used = arena->offset;
+	return stats;
+}
+
+void arena_print_stats(Frame_Arena* arena) {
+	Frame_Arena_Stats stats = arena_stats(arena);
+	log_info(
+		"Frame arena: %llu/%llu bytes used, last frame peak %llu bytes, high water %llu bytes over %llu frames, %llu overflow blocks\n",
+		stats.used, stats.cap, stats.last_frame_peak, stats.high_water, stats.frame_cnt, stats.overflow_cnt
+	);
+}
@@ -0,0 +1,63 @@
+#ifndef __FRAME_ARENA_H__
+#define __FRAME_ARENA_H__
+
+#include "core/defines.h"
+#include "core/log.h"
+
+#include <stdlib.h>
+
+/*
+ * Linear allocator for data that only lives for one frame.
+ * Pushing bumps an offset into a fixed block, nothing is freed individually.
+ * The arena owned by the context is reset by window_update() every frame,
+ * arena_mark()/arena_reset_to() can be used for nested scratch scopes.
+ *
+ * Pushes that do not fit chain an overflow block from the heap, offsets and
+ * marks keep counting across blocks. Resetting below a block frees it, and
+ * the main block grows to the frame peak at the end of a frame that
+ * overflowed, so the next frame fits in one block again.
+ */
+
+#ifndef FRAME_ARENA_CAP
+#define FRAME_ARENA_CAP (4 * 1024 * 1024)
+#endif
+#define FRAME_ARENA_ALIGN 16
+
+typedef struct {
+	u64 cap;
+	u64 used;            // Bytes in use right now
+	u64 frame_peak;      // Most bytes used at once in the current frame
+	u64 last_frame_peak; // Most bytes used at once in the previous frame
+	u64 high_water;      // Most bytes ever used at once
+	u64 frame_cnt;
+	u64 overflow_cnt;    // Overflow blocks chained so far
+} Frame_Arena_Stats;
+
+typedef struct Frame_Arena_Block Frame_Arena_Block;
+struct Frame_Arena_Block {
+	Frame_Arena_Block* prev;
+	u64 start; // Offset of the first byte
+	u64 cap;
+	u8* data;
+};
+
+typedef struct {
+	u8* base;
+	u64 cap;
+	u64 offset;
+	Frame_Arena_Block* overflow; // Block pushes go to, NULL while in the main block
+	Frame_Arena_Stats stats;
+} Frame_Arena;
+
+Frame_Arena* frame_arena_new(u64 cap);
+void frame_arena_delete(Frame_Arena* arena);
+void* arena_push(Frame_Arena* arena, u64 size);
+u64 arena_mark(Frame_Arena* arena);
+void arena_reset_to(Frame_Arena* arena, u64 mark);
+void arena_end_frame(Frame_Arena* arena);
+Frame_Arena_Stats arena_stats(Frame_Arena* arena);
+void arena_print_stats(Frame_Arena* arena);
+
+#define arena_push_array(arena, T, cnt) ((T*) arena_push(arena, sizeof(T) * (cnt)))
+
+#endif // __FRAME_ARENA_H__
@@ -0,0 +1,187 @@
+#include "hashmap.h"
+
+static u64 mix64(u64 x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ull;
+	x ^= x >> 33;
+	return x;
+}
+
+u64 hash_bytes(const void* data, u32 size) {
+	u64 v;
+	switch (size) {
+		case 8: memcpy(&v, data, 8); return mix64(v);
+		case 4: { u32 t; memcpy(&t, data, 4); return mix64(t); }
+		case 2: { u16 t; memcpy(&t, data, 2); return mix64(t); }
+		case 1: return mix64(*(const u8*) data);
+	}
+
+	// FNV-1a for everything else
+	const u8* bytes = (const u8*) data;
+	u64 hash = 0xcbf29ce484222325ull;
+	for (u32 i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return mix64(hash);
+}
+
+#define ENTRY_AT(map, slot) ((map)->entries + (u64) (slot) * (map)->entry_size)
+
+static void hashmap_alloc_slots(Hashmap_Base* map, u32 cap) {
+	// Metadata and entries live in one block, entries aligned to 16 bytes
+	u64 meta_size = (cap + 15) & ~15u;
+	map->meta = alloc_raw(meta_size + (u64) cap * map->entry_size);
+	map->entries = map->meta + meta_size;
+	map->cap = cap;
+	map->len = 0;
+	memset(map->meta, 0, cap);
+}
+
+void __hashmap_init(Hashmap_Base* map, u32 key_size, u32 entry_size) {
+	map->meta = NULL;
+	map->entries = NULL;
+	map->len = 0;
+	map->cap = 0;
+	map->key_size = key_size;
+	map->entry_size = entry_size;
+}
+
+void __hashmap_free(Hashmap_Base* map) {
+	clean(map->meta);
+	map->meta = NULL;
+	map->entries = NULL;
+	map->len = 0;
+	map->cap = 0;
+}
+
+void __hashmap_clear(Hashmap_Base* map) {
+	if (map->meta) memset(map->meta, 0, map->cap);
+	map->len = 0;
+}
+
+static void hashmap_grow(Hashmap_Base* map, u32 new_cap) {
+	u8* old_meta = map->meta;
+	u8* old_entries = map->entries;
+	u32 old_cap = map->cap;
+
+	hashmap_alloc_slots(map, new_cap);
+	for (u32 i = 0; i < old_cap; i++) {
+		if (old_meta[i]) {
+			__hashmap_insert(map, old_entries + (u64) i * map->entry_size);
+		}
+	}
+	clean(old_meta);
+}
+
+void __hashmap_reserve(Hashmap_Base* map, u32 cnt) {
+	u32 cap = map->cap ? map->cap : HASHMAP_MIN_CAP;
+	while ((u64) cnt * 8 > (u64) cap * 7) cap *= 2;
+	if (cap > map->cap) hashmap_grow(map, cap);
+}
+
+void* __hashmap_insert(Hashmap_Base* map, const void* entry) {
+	if (!map->cap || (u64) (map->len + 1) * 8 > (u64) map->cap * 7) {
+		hashmap_grow(map, map->cap ? map->cap * 2 : HASHMAP_MIN_CAP);
+	}
+
+	u8 cur[map->entry_size];
+	u8 swap[map->entry_size];
+	u8 key[map->key_size];
+	memcpy(cur, entry, map->entry_size);
+	memcpy(key, entry, map->key_size);
+
+	u32 mask = map->cap - 1;
+	u32 slot = hash_bytes(cur, map->key_size) & mask;
+	u32 dist = 1;
+	u8* placed = NULL;
+
+	while (true) {
+		u8 m = map->meta[slot];
+		u8* e = ENTRY_AT(map, slot);
+
+		if (m == 0) {
+			map->meta[slot] = dist;
+			memcpy(e, cur, map->entry_size);
+			map->len++;
+			return placed ? placed : e;
+		}
+
+		// Key already exists, only possible before the first swap
+		if (!placed && m == dist && memcmp(e, cur, map->key_size) == 0) {
+			memcpy(e, cur, map->entry_size);
+			return e;
+		}
+
+		// Robin Hood: take the slot from entries closer to their home
+		if (m < dist) {
+			memcpy(swap, e, map->entry_size);
+			memcpy(e, cur, map->entry_size);
+			memcpy(cur, swap, map->entry_size);
+			map->meta[slot] = dist;
+			dist = m;
+			if (!placed) placed = e;
+		}
+
+		slot = (slot + 1) & mask;
+		dist++;
+
+		if (dist == HASHMAP_MAX_DIST) {
+			// Pathological clustering, the entry in hand is not placed yet
+			hashmap_grow(map, map->cap * 2);
+			__hashmap_insert(map, cur);
+			return __hashmap_find(map, key);
+		}
+	}
+}
+
+static i64 hashmap_find_slot(Hashmap_Base* map, const void* key) {
+	if (!map->len) return -1;
+
+	u32 mask = map->cap - 1;
+	u32 slot = hash_bytes(key, map->key_size) & mask;
+	u32 dist = 1;
+
+	while (map->meta[slot] >= dist) {
+		if (map->meta[slot] == dist && memcmp(ENTRY_AT(map, slot), key, map->key_size) == 0) {
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+		dist++;
+	}
+	return -1;
+}
+
+void* __hashmap_find(Hashmap_Base* map, const void* key) {
+	i64 slot = hashmap_find_slot(map, key);
+	if (slot == -1) return NULL;
+	return ENTRY_AT(map, slot);
+}
+
+b32 __hashmap_erase(Hashmap_Base* map, const void* key, void* out_entry) {
+	i64 found = hashmap_find_slot(map, key);
+	if (found == -1) return false;
+
+	u32 mask = map->cap - 1;
+	u32 hole = found;
+	if (out_entry) memmove(out_entry, ENTRY_AT(map, hole), map->entry_size);
+
+	// Backward shift every entry that is not in its home slot
+	u32 next = (hole + 1) & mask;
+	while (map->meta[next] > 1) {
+		memcpy(ENTRY_AT(map, hole), ENTRY_AT(map, next), map->entry_size);
+		map->meta[hole] = map->meta[next] - 1;
+		hole = next;
+		next = (next + 1) & mask;
+	}
+	map->meta[hole] = 0;
+	map->len--;
+	return true;
+}
+
+u32 __hashmap_next(Hashmap_Base* map, u32 slot) {
+	while (slot < map->cap && !map->meta[slot]) slot++;
+	return slot;
+}
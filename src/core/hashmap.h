@@ -8,183 +8,153 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <stdbool.h>
-
-// Ignoring the incoatible-pointer-types error
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wincompatible-pointer-types"
-#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
-
-#define MAX_HMAP_SIZE 1024
-#define COMPARE(x, y, size) ({\
-	int r = 0;\
-	if (IS_POINTER(x)) {\
-		r = (memcmp((void*)x, (void*) y, size) == 0);\
-	} else {\
-		r = (x == y);\
-	}\
-	r;\
-})\
-
-
-int hash_data(char* data) {
-	int hash = 5381;
-	int c;
-	while ((c = *data++)) {
-		hash = ((hash << 5) + hash) + c;
-	}
-	return hash;
-}
-
-#define __hashmap_entry(K, V)\
-	struct {\
-		K key;\
-		V value;\
-		void* parent;\
-		void* child;\
-	}\
-
-#define Hashmap(K, V) \
-	struct {\
-		__hashmap_entry(K, V)* data[MAX_HMAP_SIZE];\
-	}*\
-
-#define hashmap_insert(map, k, v) ({\
-/* Initialization of map */\
-	if (map == NULL) {\
-		map = alloc(sizeof(*map));\
-		memset(map, 0, sizeof(*map));\
-	}\
-/* Calculating hash */\
-	__typeof__(k) tmp_k = k;\
-	int hash;\
-	if (IS_POINTER(tmp_k)) {\
-		hash = hash_data((char*) tmp_k);\
-	} else {\
-		hash = hash_data((char*) &tmp_k);\
-	}\
-	int idx = hash % MAX_HMAP_SIZE;\
-/* Starting child and parent */\
-	__typeof__(map->data[idx])* child = &map->data[idx];\
-	__typeof__(map->data[idx]) parent = NULL;\
-/* Looping over the childs until the child is NULL or the key matched */\
-	while (*child && !COMPARE((*child)->key, tmp_k, sizeof(tmp_k))) {\
-		parent = *child;\
-		child = (__typeof__(map->data[idx])*) &(*child)->child;\
-	}\
-/* If the child already exists just replace the value */\
-	if (*child != NULL) {\
-		(*child)->value = v;\
-	} else {\
-/* Creating new child */\
-		*child = alloc(sizeof(__typeof__(*map->data[idx])));\
-		(*child)->key = k;\
-		(*child)->value = v;\
-		(*child)->parent = parent;\
-		(*child)->child = NULL;\
-	}\
-})\
-
-#define hashmap_get_entry(map, k, res) ({\
-	res = true;\
-/* Calculating hash */\
-	__typeof__(k) tmp_k = k;\
-	int hash;\
-	if (IS_POINTER(tmp_k)) {\
-		hash = hash_data((char*) tmp_k);\
-	} else {\
-		hash = hash_data((char*) &tmp_k);\
-	}\
-	int idx = hash % MAX_HMAP_SIZE;\
-	__typeof__(map->data[idx])* child = &map->data[idx];\
-/* Looping over the childs until the child is NULL or the key matched */\
-	while (*child && !COMPARE((*child)->key, tmp_k, sizeof(tmp_k))) {\
-		child = (__typeof__(map->data[idx])*) &(*child)->child;\
-	}\
-	if (*child == NULL) {\
-		res = false;\
-	}\
-	(*child);\
-})
-
-#define hashmap_get(map, k) ({\
-	bool res = true;\
-	__typeof__(map->data[0]) entry = hashmap_get_entry(map, k, res);\
-	if (res == false) {\
-		printf("Cannot find\n");\
-		exit(1);\
-	}\
-	entry->value;\
-})
-
-#define hashmap_exists(map, k) ({\
-	bool exists = true;\
-	hashmap_get_entry(map, k, exists);\
-	exists;\
-})
-
-#define hashmap_pop(map, k) ({\
-	bool res = true;\
-	__typeof__(map->data[0]) entry = hashmap_get_entry(map, k, res);\
-	/* Checking if entry exists or not */\
-	if (res == false) {\
-		printf("Cannot find\n");\
-		exit(1);\
-	}\
-	__typeof__(map->data[0]) parent = entry->parent;\
-	__typeof__(map->data[0]) child = entry->child;\
-	if (parent != NULL) {\
-		parent->child = child;\
-	}\
-	else if (parent == NULL) {\
-		/* Calculating hash */\
-		__typeof__(k) tmp_k = k;\
-		int hash;\
-		if (IS_POINTER(tmp_k)) {\
-			hash = hash_data((char*) tmp_k);\
-		} else {\
-			hash = hash_data((char*) &tmp_k);\
-		}\
-		int idx = hash % MAX_HMAP_SIZE;\
-		map->data[idx] = child;\
-	}\
-	__typeof__(entry->value) value = entry->value;\
-	clean(entry);\
-	value;\
-})
-
-#define hashmap_print(map, k_fmt, v_fmt)                                                        \
-	do {                                                                                           \
-		printf("\n---HASHMAP START---\n");\
-		for (int i = 0; i < MAX_HMAP_SIZE; i++) {                                              \
-			if (map->data[i]) {                                                               \
-				printf("%d: (" k_fmt ", " v_fmt ") ", i, map->data[i]->key, map->data[i]->value);        \
-				__typeof__(map->data[i])* child = (__typeof__(map->data[i])*) &map->data[i]->child;\
-				while (*child != NULL) {\
-					printf("| (" k_fmt ", " v_fmt ") ", (*child)->key, (*child)->value);        \
-					child = (__typeof__(map->data[i])*) &(*child)->child;\
-				}\
-				printf("\n");                                                                            \
-			}                                                                                          \
-		}                                                                                            \
-		printf("---HASHMAP END---\n\n");                                                                                \
-	} while (0)
-
-
-#define hashmap_delete(map) ({\
-	for (int i = 0; i < MAX_HMAP_SIZE; i++) {\
-		if (map->data[i]) {\
-			__typeof__(map->data[i])* child = (__typeof__(map->data[i])*) &map->data[i]->child;\
-			while (*child != NULL) {\
-				__typeof__(map->data[i]) t = *child;\
-				child = (__typeof__(map->data[i])*) &(*child)->child;\
-				clean(t);\
-				t = NULL;\
-			}\
-			clean(map->data[i]);\
-			map->data[i] = NULL;\
-		}\
-	}\
-})
+#include <stddef.h>
+
+/*
+ * Open addressing hashmap with Robin Hood probing.
+ *
+ * Every slot has one metadata byte holding its probe distance + 1 (0 = empty)
+ * and the key/value pairs are stored inline right after the metadata in a
+ * single allocation. Lookups stop as soon as they meet a slot closer to its
+ * home than the probe, deletions shift the following run back so there are
+ * no tombstones. The table doubles when it gets 7/8 full.
+ *
+ * Keys are hashed and compared as `sizeof(K)` raw bytes, so pointer keys are
+ * compared by address and struct keys must not contain padding.
+ */
+
+#define HASHMAP_MIN_CAP 16
+#define HASHMAP_MAX_DIST 255
+
+typedef struct {
+	u8* meta;
+	u8* entries;
+	u32 len, cap;
+	u32 key_size, entry_size;
+} Hashmap_Base;
+
+u64 hash_bytes(const void* data, u32 size);
+
+void  __hashmap_init(Hashmap_Base* map, u32 key_size, u32 entry_size);
+void  __hashmap_free(Hashmap_Base* map);
+void  __hashmap_clear(Hashmap_Base* map);
+void  __hashmap_reserve(Hashmap_Base* map, u32 cnt);
+void* __hashmap_insert(Hashmap_Base* map, const void* entry);
+void* __hashmap_find(Hashmap_Base* map, const void* key);
+b32   __hashmap_erase(Hashmap_Base* map, const void* key, void* out_entry);
+u32   __hashmap_next(Hashmap_Base* map, u32 slot);
+
+#define __hashmap_entry(K, V) \
+	struct {                    \
+		K key;                    \
+		V value;                  \
+	}                           \
+
+#define Hashmap(K, V)               \
+	struct {                          \
+		Hashmap_Base base;              \
+		__hashmap_entry(K, V) tmp;      \
+	}*                                \
+
+#define __hashmap_init_if_null(map)                                                       \
+	do {                                                                                    \
+		if ((map) == NULL) {                                                                  \
+			(map) = alloc(sizeof(*(map)));                                                      \
+			__hashmap_init(&(map)->base, sizeof((map)->tmp.key), sizeof((map)->tmp));           \
+		}                                                                                     \
+	} while (0)                                                                             \
+
+#define __hashmap_set_tmp_key(map, k)                  \
+	do {                                                 \
+		memset(&(map)->tmp, 0, sizeof((map)->tmp));       \
+		(map)->tmp.key = (k);                              \
+	} while (0)                                          \
+
+#define hashmap_reserve(map, cnt)               \
+	do {                                          \
+		__hashmap_init_if_null(map);                \
+		__hashmap_reserve(&(map)->base, (cnt));     \
+	} while (0)                                   \
+
+#define hashmap_insert(map, k, v)                     \
+	do {                                                \
+		__hashmap_init_if_null(map);                      \
+		__hashmap_set_tmp_key(map, k);                    \
+		(map)->tmp.value = (v);                           \
+		__hashmap_insert(&(map)->base, &(map)->tmp);      \
+	} while (0)                                         \
+
+// Returns pointer to the value or NULL
+#define hashmap_find(map, k)                                                 \
+	({                                                                         \
+		__typeof__((map)->tmp.value)* res = NULL;                                \
+		if ((map)) {                                                             \
+			__hashmap_set_tmp_key(map, k);                                         \
+			__typeof__((map)->tmp)* e = __hashmap_find(&(map)->base, &(map)->tmp); \
+			if (e) res = &e->value;                                                \
+		}                                                                        \
+		res;                                                                     \
+	})                                                                         \
+
+#define hashmap_get(map, k)                                                    \
+	({                                                                           \
+		__typeof__((map)->tmp.value)* ptr = hashmap_find(map, k);                  \
+		assert(ptr, "Tried getting a key that doesn't exist in the hashmap.\n");  \
+		*ptr;                                                                      \
+	})                                                                           \
+
+#define hashmap_exists(map, k) (hashmap_find(map, k) != NULL)
+
+#define hashmap_pop(map, k)                                                               \
+	({                                                                                      \
+		assert((map), "Tried popping from an empty hashmap.\n");                              \
+		__hashmap_set_tmp_key(map, k);                                                        \
+		b32 found = __hashmap_erase(&(map)->base, &(map)->tmp, &(map)->tmp);                  \
+		assert(found, "Tried popping a key that doesn't exist in the hashmap.\n");            \
+		(map)->tmp.value;                                                                     \
+	})                                                                                      \
+
+#define hashmap_len(map) ((map) ? (map)->base.len : 0)
+
+/*
+ * Loops over every entry, `e` is declared as a pointer to the entry
+ * and exposes `e->key` and `e->value`.
+ */
+
+#define hashmap_for_each(map, e, block)                                     \
+	do {                                                                      \
+		if ((map)) {                                                            \
+			for (u32 slot = __hashmap_next(&(map)->base, 0);                      \
+			     slot < (map)->base.cap;                                          \
+			     slot = __hashmap_next(&(map)->base, slot + 1)) {                 \
+				__typeof__((map)->tmp)* e = (__typeof__((map)->tmp)*)               \
+					((map)->base.entries + (u64) slot * (map)->base.entry_size);       \
+				block                                                               \
+			}                                                                     \
+		}                                                                       \
+	} while (0)                                                               \
+
+#define hashmap_print(map, k_fmt, v_fmt)                                  \
+	do {                                                                    \
+		printf("\n---HASHMAP START---\n");                                    \
+		hashmap_for_each(map, entry, {                                        \
+			printf("(" k_fmt ", " v_fmt ")\n", entry->key, entry->value);       \
+		});                                                                   \
+		printf("---HASHMAP END---\n\n");                                      \
+	} while (0)                                                             \
+
+#define hashmap_clear(map)                     \
+	do {                                         \
+		if ((map)) __hashmap_clear(&(map)->base);  \
+	} while (0)                                  \
+
+#define hashmap_delete(map)                   \
+	do {                                        \
+		if ((map)) {                              \
+			__hashmap_free(&(map)->base);           \
+			clean((map));                           \
+			(map) = NULL;                           \
+		}                                         \
+	} while (0)                                 \
 
 #endif //  __HASHMAP_H__
@@ -0,0 +1,103 @@
+#include "slab_allocator.h"
+
+STATIC_ASSERT(SLAB_HEADER_SIZE >= sizeof(u32), "Slab header cannot hold the size class.");
+
+static u32 size_class(size_t size) {
+	if (size <= SLAB_MIN_SIZE) return 0;
+	// Index of the smallest power of two >= size, relative to SLAB_MIN_SIZE
+	return (64 - __builtin_clzll((u64) size - 1)) - __builtin_ctz(SLAB_MIN_SIZE);
+}
+
+Slab_Allocator* slab_allocator_new() {
+	Slab_Allocator* allocator = (Slab_Allocator*) calloc(1, sizeof(Slab_Allocator));
+	return allocator;
+}
+
+void slab_allocator_delete(Slab_Allocator* allocator) {
+	Slab_Page* page = allocator->pages;
+	while (page) {
+		Slab_Page* next = page->next;
+		free(page);
+		page = next;
+	}
+	free(allocator);
+}
+
+static void slab_refill(Slab_Allocator* allocator, u32 class) {
+	size_t block_size = SLAB_HEADER_SIZE + (SLAB_MIN_SIZE << class);
+
+	Slab_Page* page = (Slab_Page*) malloc(SLAB_PAGE_SIZE);
+	page->next = allocator->pages;
+	allocator->pages = page;
+	allocator->page_cnt++;
+
+	// Carving the page into blocks, first block starts after the page link
+	u8* start = (u8*) page + SLAB_HEADER_SIZE;
+	u8* end = (u8*) page + SLAB_PAGE_SIZE;
+	Slab_Free_Block* head = allocator->free_lists[class];
+	for (u8* block = start; block + block_size <= end; block += block_size) {
+		Slab_Free_Block* b = (Slab_Free_Block*) block;
+		b->next = head;
+		head = b;
+	}
+	allocator->free_lists[class] = head;
+}
+
+void* slab_allocator_alloc(Slab_Allocator* allocator, size_t size) {
+	if (size > SLAB_MAX_SIZE) {
+		u8* block = (u8*) malloc(SLAB_HEADER_SIZE + size);
+		*(u32*) block = SLAB_LARGE_CLASS;
+		return block + SLAB_HEADER_SIZE;
+	}
+
+	u32 class = size_class(size);
+	if (!allocator->free_lists[class]) {
+		slab_refill(allocator, class);
+	}
+
+	Slab_Free_Block* block = allocator->free_lists[class];
+	allocator->free_lists[class] = block->next;
+
+	*(u32*) block = class;
+	return (u8*) block + SLAB_HEADER_SIZE;
+}
+
+void* slab_allocator_realloc(Slab_Allocator* allocator, void* ptr, size_t size) {
+	if (!ptr) return slab_allocator_alloc(allocator, size);
+
+	u8* block = (u8*) ptr - SLAB_HEADER_SIZE;
+	u32 class = *(u32*) block;
+
+	if (class == SLAB_LARGE_CLASS && size > SLAB_MAX_SIZE) {
+		block = (u8*) realloc(block, SLAB_HEADER_SIZE + size);
+		return block + SLAB_HEADER_SIZE;
+	}
+
+	// Still fits in the same block
+	if (class != SLAB_LARGE_CLASS && size_class(size) == class) {
+		return ptr;
+	}
+
+	// Moving between classes. The old size of a large block isn't stored,
+	// but a large block only shrinks into a class here so `size` bounds it.
+	size_t old_size = class == SLAB_LARGE_CLASS ? size : (size_t) SLAB_MIN_SIZE << class;
+	void* new_ptr = slab_allocator_alloc(allocator, size);
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+	slab_allocator_free(allocator, ptr);
+	return new_ptr;
+}
+
+void slab_allocator_free(Slab_Allocator* allocator, void* ptr) {
+	if (!ptr) return;
+
+	u8* block = (u8*) ptr - SLAB_HEADER_SIZE;
+	u32 class = *(u32*) block;
+	if (class == SLAB_LARGE_CLASS) {
+		free(block);
+		return;
+	}
+
+	Slab_Free_Block* b = (Slab_Free_Block*) block;
+	b->next = allocator->free_lists[class];
+	allocator->free_lists[class] = b;
+}
@@ -0,0 +1,45 @@
+#ifndef __SLAB_ALLOCATOR_H__
+#define __SLAB_ALLOCATOR_H__
+
+#include "core/defines.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Size-class slab allocator used as the release backend of alloc()/clean().
+ * Small requests are rounded up to a power of two class and served from a
+ * per-class free list, refilled by carving pages into equally sized blocks.
+ * Every block is preceded by a header holding its class so clean() doesn't
+ * need a size. Requests bigger than the largest class go straight to malloc.
+ * Memory is not zeroed.
+ */
+
+#define SLAB_MIN_SIZE    16
+#define SLAB_CLASS_CNT   9     // 16, 32, ..., 4096
+#define SLAB_MAX_SIZE    (SLAB_MIN_SIZE << (SLAB_CLASS_CNT - 1))
+#define SLAB_PAGE_SIZE   (64 * 1024)
+#define SLAB_HEADER_SIZE 16
+#define SLAB_LARGE_CLASS SLAB_CLASS_CNT
+
+typedef struct Slab_Free_Block {
+	struct Slab_Free_Block* next;
+} Slab_Free_Block;
+
+typedef struct Slab_Page {
+	struct Slab_Page* next;
+} Slab_Page;
+
+typedef struct {
+	Slab_Free_Block* free_lists[SLAB_CLASS_CNT];
+	Slab_Page* pages;
+	u32 page_cnt;
+} Slab_Allocator;
+
+Slab_Allocator* slab_allocator_new();
+void slab_allocator_delete(Slab_Allocator* allocator);
+void* slab_allocator_alloc(Slab_Allocator* allocator, size_t size);
+void* slab_allocator_realloc(Slab_Allocator* allocator, void* ptr, size_t size);
+void slab_allocator_free(Slab_Allocator* allocator, void* ptr);
+
+#endif // __SLAB_ALLOCATOR_H__
@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static __thread u32 thread_idx = 0;
+
+// Takes tasks of the given job until there is none left
+static void thread_pool_work(Thread_Pool* pool, u32 job_id, Thread_Pool_Fn fn, void* arg, u32 task_cnt) {
+	u32 done = 0;
+	u64 next = __atomic_load_n(&pool->next_task, __ATOMIC_ACQUIRE);
+	for (;;) {
+		// Stale threads must not take tasks of a newer job
+		if ((u32) (next >> 32) != job_id || (u32) next >= task_cnt) break;
+		if (!__atomic_compare_exchange_n(&pool->next_task, &next, next + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			continue;
+
+		fn(arg, (u32) next);
+		done++;
+		next = __atomic_load_n(&pool->next_task, __ATOMIC_ACQUIRE);
+	}
+
+	// The job can't finish while a thread holds unreported tasks
+	if (done) {
+		pthread_mutex_lock(&pool->lock);
+		pool->done_cnt += done;
+		if (pool->done_cnt == pool->task_cnt)
+			pthread_cond_broadcast(&pool->done_cond);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static void* thread_pool_worker(void* data) {
+	Thread_Pool* pool = data;
+	u32 seen = 0;
+	thread_idx = __atomic_add_fetch(&pool->started_cnt, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->quit && pool->job_id == seen)
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+		if (pool->quit) break;
+
+		seen = pool->job_id;
+		Thread_Pool_Fn fn = pool->fn;
+		void* arg = pool->arg;
+		u32 task_cnt = pool->task_cnt;
+
+		pthread_mutex_unlock(&pool->lock);
+		thread_pool_work(pool, seen, fn, arg, task_cnt);
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+Thread_Pool* thread_pool_new(u32 worker_cnt) {
+	assert(worker_cnt < THREAD_POOL_MAX_THREAD_CNT, "Thread pool can have at most %d workers, got %u.\n", THREAD_POOL_MAX_THREAD_CNT - 1, worker_cnt);
+
+	Thread_Pool* pool = (Thread_Pool*) calloc(1, sizeof(Thread_Pool));
+	pool->worker_cnt = worker_cnt;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	pool->threads = (pthread_t*) calloc(worker_cnt ? worker_cnt : 1, sizeof(pthread_t));
+	for (u32 i = 0; i < worker_cnt; i++) {
+		int err = pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool);
+		assert(err == 0, "Failed to create worker thread %u (error %d).\n", i, err);
+	}
+	return pool;
+}
+
+void thread_pool_delete(Thread_Pool* pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (u32 i = 0; i < pool->worker_cnt; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+void thread_pool_run(Thread_Pool* pool, Thread_Pool_Fn fn, void* arg, u32 task_cnt) {
+	if (task_cnt == 0) return;
+
+	pthread_mutex_lock(&pool->lock);
+	u32 job_id = ++pool->job_id;
+	pool->fn = fn;
+	pool->arg = arg;
+	pool->task_cnt = task_cnt;
+	pool->done_cnt = 0;
+	__atomic_store_n(&pool->next_task, (u64) job_id << 32, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	thread_pool_work(pool, job_id, fn, arg, task_cnt);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->done_cnt < pool->task_cnt)
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+u32 thread_pool_cpu_cnt() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long cnt = sysconf(_SC_NPROCESSORS_ONLN);
+	return cnt > 0 ? (u32) cnt : 1;
+#endif
+}
+
+u32 thread_pool_thread_idx() {
+	return thread_idx;
+}
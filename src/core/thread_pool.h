@@ -0,0 +1,54 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include "core/defines.h"
+#include "core/log.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+/*
+ * Fixed set of worker threads running one job at a time.
+ * A job is `task_cnt` calls of `fn(arg, task)`, handed out to whichever
+ * thread asks first. Workers are numbered from 1, the caller is thread 0,
+ * which lets tasks pick per thread data with thread_pool_thread_idx(). The thread starting the job works on it too and
+ * returns once every task is done, so a pool with 0 workers runs serially.
+ *
+ * alloc()/clean() and the frame arena are not thread safe, tasks must not
+ * use them.
+ */
+
+typedef void (*Thread_Pool_Fn)(void* arg, u32 task);
+
+typedef struct {
+	pthread_t* threads;
+	u32 worker_cnt;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+
+	// Current job, `next_task` holds the job id in the high 32 bits and the
+	// next task index in the low 32 bits
+	Thread_Pool_Fn fn;
+	void* arg;
+	u32 task_cnt;
+	u32 done_cnt;
+	u32 job_id;
+	u64 next_task;
+	b32 quit;
+	u32 started_cnt;
+} Thread_Pool;
+
+// Most threads a pool can have including the caller
+#define THREAD_POOL_MAX_THREAD_CNT 64
+
+Thread_Pool* thread_pool_new(u32 worker_cnt);
+void thread_pool_delete(Thread_Pool* pool);
+void thread_pool_run(Thread_Pool* pool, Thread_Pool_Fn fn, void* arg, u32 task_cnt);
+u32 thread_pool_cpu_cnt();
+
+// Index of the calling thread in its pool, 0 for threads outside any pool
+u32 thread_pool_thread_idx();
+
+#endif // __THREAD_POOL_H__
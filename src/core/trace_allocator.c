@@ -4,6 +4,12 @@ void print_traceable_memory_block(Traceable_Memory_Block* block) {
 	printf("%p at %s:%d of %zu bytes\n", block->ptr, block->file, block->line, block->size);
 }
 
+static u32 hash_ptr(void* ptr, u32 cap) {
+	// Fibonacci hashing, low bits of a pointer are mostly alignment zeros
+	u64 h = ((u64) ptr >> 4) * 11400714819323198485ull;
+	return (u32) (h >> 40) & (cap - 1);
+}
+
 Trace_Allocator* trace_allocator_new() {
 	Trace_Allocator* allocator = (Trace_Allocator*) calloc(1, sizeof(Trace_Allocator));
 
@@ -23,31 +29,33 @@ void trace_allocator_delete(Trace_Allocator* allocator) {
 	free(allocator);
 }
 
+static void insert_block(Traceable_Memory_Block* blocks, u32 cap, Traceable_Memory_Block mem) {
+	u32 idx = hash_ptr(mem.ptr, cap);
+	while (blocks[idx].ptr) {
+		idx = (idx + 1) & (cap - 1);
+	}
+	blocks[idx] = mem;
+}
+
 void handle_blocks_overflow(Trace_Allocator* allocator) {
-	if (allocator->blocks_cnt < allocator->blocks_cap) return;
+	if (allocator->blocks_cnt + 1 <= allocator->blocks_cap * TRACE_ALLOCATOR_MAX_LOAD) return;
 
-	Traceable_Memory_Block* tmp_blocks = (Traceable_Memory_Block*) calloc(
-		TRACE_ALLOCATOR_MEMORY_CAP,
+	u32 new_cap = allocator->blocks_cap * 2;
+	Traceable_Memory_Block* new_blocks = (Traceable_Memory_Block*) calloc(
+		new_cap,
 		sizeof(Traceable_Memory_Block)
 	);
-	memcpy(
-		tmp_blocks, allocator->blocks,
-		sizeof(Traceable_Memory_Block) * allocator->blocks_cnt
-	);
-
-	free(allocator->blocks);
 
-	allocator->blocks_cap += TRACE_ALLOCATOR_GROW_RATE * TRACE_ALLOCATOR_MEMORY_CAP;
-	allocator->blocks = (Traceable_Memory_Block*) calloc(
-		allocator->blocks_cap,
-		sizeof(Traceable_Memory_Block)
-	);
-	memcpy(
-		allocator->blocks, tmp_blocks,
-		sizeof(Traceable_Memory_Block) * allocator->blocks_cnt
-	);
+	// Rehashing all the live blocks into the bigger table
+	for (u32 i = 0; i < allocator->blocks_cap; i++) {
+		if (allocator->blocks[i].ptr) {
+			insert_block(new_blocks, new_cap, allocator->blocks[i]);
+		}
+	}
 
-	free(tmp_blocks);
+	free(allocator->blocks);
+	allocator->blocks = new_blocks;
+	allocator->blocks_cap = new_cap;
 }
 
 void* __trace_allocator_alloc(Trace_Allocator* allocator, size_t size, const char* file, i32 line) {
@@ -62,23 +70,72 @@ void* __trace_allocator_alloc(Trace_Allocator* allocator, size_t size, const cha
 	};
 	memset(ptr, 0, size);
 
-	allocator->blocks[allocator->blocks_cnt++] = mem;
+	insert_block(allocator->blocks, allocator->blocks_cap, mem);
+	allocator->blocks_cnt++;
 	return ptr;
 }
 
-void trace_allocator_free(Trace_Allocator* allocator, void* ptr) {
-	for (u32 i = 0; allocator->blocks_cnt; i++) {
-		if (allocator->blocks[i].ptr == ptr) {
-			memmove(
-				&allocator->blocks[i], &allocator->blocks[i+1],
-				(allocator->blocks_cnt - i - 1) * sizeof(Traceable_Memory_Block)
-			);
-			allocator->blocks_cnt--;
-
-			free(ptr);
-			break;
+static i64 find_block(Trace_Allocator* allocator, void* ptr) {
+	u32 mask = allocator->blocks_cap - 1;
+	u32 idx = hash_ptr(ptr, allocator->blocks_cap);
+	while (allocator->blocks[idx].ptr != ptr) {
+		if (!allocator->blocks[idx].ptr) return -1;
+		idx = (idx + 1) & mask;
+	}
+	return idx;
+}
+
+static void remove_block(Trace_Allocator* allocator, u32 idx) {
+	u32 mask = allocator->blocks_cap - 1;
+
+	// Backward shift deletion: pull up every following block that would
+	// otherwise become unreachable from its home slot.
+	u32 hole = idx;
+	u32 next = (hole + 1) & mask;
+	while (allocator->blocks[next].ptr) {
+		u32 home = hash_ptr(allocator->blocks[next].ptr, allocator->blocks_cap);
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			allocator->blocks[hole] = allocator->blocks[next];
+			hole = next;
 		}
+		next = (next + 1) & mask;
+	}
+	allocator->blocks[hole] = (Traceable_Memory_Block) { 0 };
+	allocator->blocks_cnt--;
+}
+
+void* __trace_allocator_realloc(Trace_Allocator* allocator, void* ptr, size_t size, const char* file, i32 line) {
+	if (!ptr) return __trace_allocator_alloc(allocator, size, file, line);
+
+	i64 idx = find_block(allocator, ptr);
+	assert(idx != -1, "Tried reallocating untracked memory %p at %s:%d\n", ptr, file, line);
+
+	Traceable_Memory_Block mem = allocator->blocks[idx];
+	remove_block(allocator, idx);
+
+	void* new_ptr = realloc(ptr, size);
+	if (size > mem.size) {
+		memset((u8*) new_ptr + mem.size, 0, size - mem.size);
 	}
+
+	mem.ptr  = new_ptr;
+	mem.size = size;
+	mem.file = file;
+	mem.line = line;
+	insert_block(allocator->blocks, allocator->blocks_cap, mem);
+	allocator->blocks_cnt++;
+	return new_ptr;
+}
+
+void trace_allocator_free(Trace_Allocator* allocator, void* ptr) {
+	if (!ptr) return;
+
+	// Pointer is not tracked by this allocator
+	i64 idx = find_block(allocator, ptr);
+	if (idx == -1) return;
+
+	remove_block(allocator, idx);
+	free(ptr);
 }
 
 void trace_allocator_alert(Trace_Allocator* allocator) {
@@ -86,11 +143,12 @@ void trace_allocator_alert(Trace_Allocator* allocator) {
 
 	printf("\n---------Unfreed memories---------\n");
 	size_t total = 0;
-	for (u32 i = 0; i < allocator->blocks_cnt; i++) {
+	for (u32 i = 0; i < allocator->blocks_cap; i++) {
+		if (!allocator->blocks[i].ptr) continue;
 		print_traceable_memory_block(&allocator->blocks[i]);
 		total += allocator->blocks[i].size;
 	}
-	printf("\nTotal unfreed memories count = %d\n", allocator->blocks_cnt);
-	printf("Total unfreed memories = %d bytes\n", total);
+	printf("\nTotal unfreed memories count = %u\n", allocator->blocks_cnt);
+	printf("Total unfreed memories = %zu bytes\n", total);
 	printf("---------Unfreed memories---------\n\n");
 }
@@ -15,8 +15,15 @@ typedef struct {
 
 void print_traceable_memory_block(Traceable_Memory_Block* block);
 
+/*
+ * Blocks are stored in an open-addressed table keyed by the pointer.
+ * Empty slots have `ptr == NULL`, collisions are resolved with linear probing
+ * and deletions use backward shifting so there are no tombstones.
+ * The capacity is always a power of two.
+ */
+
 #define TRACE_ALLOCATOR_MEMORY_CAP 1024
-#define TRACE_ALLOCATOR_GROW_RATE 0.5
+#define TRACE_ALLOCATOR_MAX_LOAD   0.75
 typedef struct {
 	Traceable_Memory_Block* blocks;
 	u32 blocks_cnt;
@@ -28,6 +35,8 @@ void trace_allocator_delete(Trace_Allocator* allocator);
 
 #define trace_allocator_alloc(allocator, size) __trace_allocator_alloc(allocator, size, __FILE__, __LINE__)
 void* __trace_allocator_alloc(Trace_Allocator* allocator, size_t size, const char* file, i32 line);
+#define trace_allocator_realloc(allocator, ptr, size) __trace_allocator_realloc(allocator, ptr, size, __FILE__, __LINE__)
+void* __trace_allocator_realloc(Trace_Allocator* allocator, void* ptr, size_t size, const char* file, i32 line);
 void trace_allocator_free(Trace_Allocator* allocator, void* ptr);
 void trace_allocator_alert(Trace_Allocator* allocator);
 
@@ -1,22 +1,5 @@
 #include "ecs.h"
-
-
-/* =======================
- * Component Entry
- * ======================= */
-
-
-CompEntry* comp_entry_new(Entity ent, void* data) {
-	CompEntry* entry = alloc(sizeof(CompEntry));
-	entry->ent = ent;
-	entry->data = data;
-	return entry;
-}
-
-void comp_entry_delete(CompEntry* entry) {
-	clean(entry->data);
-	clean(entry);
-}
+#include <pthread.h>
 
 
 /* =======================
@@ -25,67 +8,162 @@ void comp_entry_delete(CompEntry* entry) {
 
 
 
-CompRecord* comp_record_new(char* name, u32 max_entry_cnt) {
+CompRecord* comp_record_new(char* name, u32 comp_size, u32 max_entry_cnt) {
 	CompRecord* rec = alloc(sizeof(CompRecord));
 
 	// Initializing variables
-	rec->entries_ent = alloc(sizeof(Entity) * max_entry_cnt);
-	rec->entries = alloc(sizeof(CompEntry) * max_entry_cnt);
+	rec->comp_size = comp_size;
 	rec->entry_cnt = 0;
+	rec->entry_cap = 0;
 	rec->max_entry_cnt = max_entry_cnt;
+	rec->entries_ent = NULL;
+	rec->data = NULL;
+	rec->added_ticks = NULL;
+	rec->changed_ticks = NULL;
+	rec->moved_tick = 0;
+	rec->mapped = 0;
 
-	rec->name = alloc(strlen(name));
+	// Every entity starts without the component
+	rec->sparse = alloc_raw(sizeof(u32) * max_entry_cnt);
+	memset(rec->sparse, 0xff, sizeof(u32) * max_entry_cnt);
+
+	rec->name = alloc(strlen(name) + 1);
 	strcpy(rec->name, name);
 
 	return rec;
 }
 
 void comp_record_delete(CompRecord* rec) {
-	for (u32 i = 0; i < rec->max_entry_cnt; i++) {
-		CompEntry* entry = rec->entries[i];
-		if (entry) comp_entry_delete(entry);
-	}
 	clean(rec->name);
-	clean(rec->entries_ent);
-	clean(rec->entries);
+
+	// Arrays borrowed from a snapshot go away with the mapping
+	if (!(rec->mapped & COMP_RECORD_MAPPED_PACKED)) {
+		clean(rec->entries_ent);
+		clean(rec->data);
+		clean(rec->added_ticks);
+		clean(rec->changed_ticks);
+	}
+	if (!(rec->mapped & COMP_RECORD_MAPPED_SPARSE)) {
+		clean(rec->sparse);
+	}
 	clean(rec);
 }
 
 b32 comp_record_search(CompRecord* rec, Entity ent) {
-	assert(ent < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", ent, rec->max_entry_cnt);
+	u32 slot = entity_index(ent);
+	assert(slot < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", slot, rec->max_entry_cnt);
+	u32 idx = rec->sparse[slot];
+	return idx != COMP_RECORD_INVALID && rec->entries_ent[idx] == ent;
+}
 
-	CompEntry* entry = rec->entries[ent];
-	if (entry) return true;
-	return false;
+static void* comp_record_unmap(void* src, u64 used, u64 size) {
+	void* dst = alloc_raw(size);
+	memcpy(dst, src, used);
+	return dst;
+}
+
+// Makes room for `cnt` entries, growing at least geometrically
+static void comp_record_reserve(CompRecord* rec, u32 cnt) {
+	if (cnt <= rec->entry_cap) return;
+
+	u32 cap = rec->entry_cap * 2 > cnt ? rec->entry_cap * 2 : cnt;
+	if (cap < COMP_RECORD_MIN_CAP) cap = COMP_RECORD_MIN_CAP;
+	if (cap > rec->max_entry_cnt) cap = rec->max_entry_cnt;
+
+	if (rec->mapped & COMP_RECORD_MAPPED_PACKED) {
+		// Packed arrays of a loaded snapshot move to the allocator on first growth
+		rec->entries_ent = comp_record_unmap(rec->entries_ent, sizeof(Entity) * rec->entry_cnt, sizeof(Entity) * cap);
+		rec->data = comp_record_unmap(rec->data, (u64) rec->comp_size * rec->entry_cnt, (u64) rec->comp_size * cap);
+		rec->added_ticks = comp_record_unmap(rec->added_ticks, sizeof(u32) * rec->entry_cnt, sizeof(u32) * cap);
+		rec->changed_ticks = comp_record_unmap(rec->changed_ticks, sizeof(u32) * rec->entry_cnt, sizeof(u32) * cap);
+		rec->mapped &= ~COMP_RECORD_MAPPED_PACKED;
+	} else {
+		rec->entries_ent = alloc_resize(rec->entries_ent, sizeof(Entity) * cap);
+		rec->data = alloc_resize(rec->data, (u64) rec->comp_size * cap);
+		rec->added_ticks = alloc_resize(rec->added_ticks, sizeof(u32) * cap);
+		rec->changed_ticks = alloc_resize(rec->changed_ticks, sizeof(u32) * cap);
+	}
+	rec->entry_cap = cap;
 }
 
-CompEntry* comp_record_add_entry(CompRecord* rec, Entity ent, void* data) {
-	assert(ent < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", ent, rec->max_entry_cnt);
+void* comp_record_add_entry(CompRecord* rec, Entity ent, void* data) {
+	u32 slot = entity_index(ent);
+	assert(slot < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", slot, rec->max_entry_cnt);
 	assert(rec->entry_cnt < rec->max_entry_cnt, "Component record is full. Cannot add entry to entity `%d`.\n", ent);
+	assert(rec->sparse[slot] == COMP_RECORD_INVALID, "Entity `%d` already has component `%s`.\n", ent, rec->name);
 
-	CompEntry* entry = comp_entry_new(ent, data);
-	rec->entries[ent] = entry;
-	rec->entries_ent[rec->entry_cnt++] = ent;
+	if (rec->entry_cnt == rec->entry_cap) {
+		comp_record_reserve(rec, rec->entry_cnt + 1);
+	}
 
-	return entry;
+	u32 idx = rec->entry_cnt++;
+	rec->sparse[slot] = idx;
+	rec->entries_ent[idx] = ent;
+	rec->added_ticks[idx] = 0;
+	rec->changed_ticks[idx] = 0;
+
+	void* comp = comp_record_at(rec, idx);
+	memcpy(comp, data, rec->comp_size);
+	return comp;
 }
 
-CompEntry* comp_record_get_entry(CompRecord* rec, Entity ent) {
-	assert(ent < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", ent, rec->max_entry_cnt);
+void* comp_record_get_entry(CompRecord* rec, Entity ent) {
+	u32 slot = entity_index(ent);
+	assert(slot < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", slot, rec->max_entry_cnt);
 
-	CompEntry* entry = rec->entries[ent];
-	if (entry) return entry;
-	return NULL;
+	// Stale handles find the slot taken by a newer entity
+	u32 idx = rec->sparse[slot];
+	if (idx == COMP_RECORD_INVALID || rec->entries_ent[idx] != ent) return NULL;
+	return comp_record_at(rec, idx);
 }
 
 void comp_record_remove_entry(CompRecord* rec, Entity ent) {
-	assert(ent < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", ent, rec->max_entry_cnt);
+	u32 slot = entity_index(ent);
+	assert(slot < rec->max_entry_cnt, "Tried to access entity of slot `%d` in record of max slot `%d`.\n", slot, rec->max_entry_cnt);
 
-	CompEntry* entry = rec->entries[ent];
-	comp_entry_delete(entry);
+	u32 idx = rec->sparse[slot];
+	assert(idx != COMP_RECORD_INVALID && rec->entries_ent[idx] == ent, "Entity `%d` doesnt have component `%s`.\n", ent, rec->name);
 
-	rec->entries[ent] = NULL;
-	rec->entry_cnt--;
+	// Moving the last component into the hole to keep the arrays packed
+	u32 last = --rec->entry_cnt;
+	if (idx != last) {
+		Entity moved = rec->entries_ent[last];
+		rec->entries_ent[idx] = moved;
+		rec->added_ticks[idx] = rec->added_ticks[last];
+		rec->changed_ticks[idx] = rec->changed_ticks[last];
+		memcpy(comp_record_at(rec, idx), comp_record_at(rec, last), rec->comp_size);
+		rec->sparse[entity_index(moved)] = idx;
+	}
+	rec->sparse[slot] = COMP_RECORD_INVALID;
+}
+
+// Swaps two packed entries, used by queries to keep their entities in front
+static void comp_record_swap(CompRecord* rec, u32 a, u32 b) {
+	if (a == b) return;
+
+	Entity ea = rec->entries_ent[a];
+	Entity eb = rec->entries_ent[b];
+	rec->entries_ent[a] = eb;
+	rec->entries_ent[b] = ea;
+	rec->sparse[entity_index(ea)] = b;
+	rec->sparse[entity_index(eb)] = a;
+
+	u32 t = rec->added_ticks[a];
+	rec->added_ticks[a] = rec->added_ticks[b];
+	rec->added_ticks[b] = t;
+	t = rec->changed_ticks[a];
+	rec->changed_ticks[a] = rec->changed_ticks[b];
+	rec->changed_ticks[b] = t;
+
+	u8* pa = comp_record_at(rec, a);
+	u8* pb = comp_record_at(rec, b);
+	u8 tmp[64];
+	for (u32 off = 0; off < rec->comp_size; off += sizeof(tmp)) {
+		u32 n = rec->comp_size - off < sizeof(tmp) ? rec->comp_size - off : sizeof(tmp);
+		memcpy(tmp, pa + off, n);
+		memcpy(pa + off, pb + off, n);
+		memcpy(pb + off, tmp, n);
+	}
 }
 
 
@@ -94,46 +172,77 @@ void comp_record_remove_entry(CompRecord* rec, Entity ent) {
  * ======================= */
 
 
-CompTable* comp_table_new(u32 max_record_cnt) {
-	CompTable* table = alloc(sizeof(CompTable));
-	table->record_cnt = 0;
-	table->max_record_cnt = max_record_cnt;
-	table->records = alloc(sizeof(CompRecord) * max_record_cnt);
-	return table;
+// Component types registered so far, shared by every ecs
+static struct {
+	char* name;
+	u32   size;
+} comp_registry[ECS_MAX_COMP_TYPES];
+static u32 comp_registry_cnt = 0;
+
+// Writers take the lock, entries are filled before the count is published so readers need none
+static pthread_mutex_t comp_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline u32 comp_registry_len() {
+	return __atomic_load_n(&comp_registry_cnt, __ATOMIC_ACQUIRE);
 }
 
-void comp_table_delete(CompTable* table) {
-	for (u32 i = 0; i < table->record_cnt; i++) {
-		CompRecord* rec = table->records[i];
-		comp_record_delete(rec);
+CompID __comp_id_register(char* name, u32 size) {
+	// Only hit once per call site, the id is cached by `comp_id`
+	pthread_mutex_lock(&comp_registry_lock);
+	u32 cnt = comp_registry_cnt;
+	for (CompID id = 0; id < cnt; id++) {
+		if (strcmp(name, comp_registry[id].name) == 0) {
+			pthread_mutex_unlock(&comp_registry_lock);
+			assert(comp_registry[id].size == size, "Component `%s` was registered with size %u, got %u.\n", name, comp_registry[id].size, size);
+			return id;
+		}
 	}
-	clean(table->records);
-	clean(table);
+
+	assert(cnt < ECS_MAX_COMP_TYPES, "Component registry is full. Cant register `%s`.\n", name);
+	CompID id = cnt;
+	comp_registry[id].name = name;
+	comp_registry[id].size = size;
+	__atomic_store_n(&comp_registry_cnt, cnt + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&comp_registry_lock);
+	return id;
 }
 
-b32 __comp_table_search(CompTable* table, char* name) {
-	for (u32 i = 0; i < table->record_cnt; i++) {
-		CompRecord* rec = table->records[i];
-		if (strcmp(name, rec->name) == 0) {
-			return true;
-		}
+char* comp_id_name(CompID id) {
+	assert(id < comp_registry_len(), "Component id `%u` is not registered.\n", id);
+	return comp_registry[id].name;
+}
+
+CompID comp_id_find(const char* name) {
+	u32 cnt = comp_registry_len();
+	for (CompID id = 0; id < cnt; id++) {
+		if (strcmp(name, comp_registry[id].name) == 0) return id;
 	}
-	return false;
+	return COMP_ID_INVALID;
 }
 
-void __comp_table_add_record(CompTable* table, char* name) {
-	assert(table->record_cnt < table->max_record_cnt, "Component table is full. Cant create new record `%s`.\n", name);
-	table->records[table->record_cnt++] = comp_record_new(name, table->max_record_cnt);
+CompTable* comp_table_new(u32 max_entity_cnt) {
+	CompTable* table = alloc(sizeof(CompTable));
+	table->record_cnt = 0;
+	table->max_entity_cnt = max_entity_cnt;
+	return table;
 }
 
-CompRecord* __comp_table_get_record(CompTable* table, char* name) {
-	for (u32 i = 0; i < table->record_cnt; i++) {
-		CompRecord* rec = table->records[i];
-		if (strcmp(name, rec->name) == 0) {
-			return rec;
-		}
+void comp_table_delete(CompTable* table) {
+	for (CompID id = 0, cnt = comp_registry_len(); id < cnt; id++) {
+		CompRecord* rec = table->records[id];
+		if (rec) comp_record_delete(rec);
 	}
-	return NULL;
+	clean(table);
+}
+
+CompRecord* __comp_table_add_record(CompTable* table, CompID id) {
+	assert(table->records[id] == NULL, "Component `%s` already has a record.\n", comp_id_name(id));
+
+	// Records are sized by entity count so any entity can hold the component
+	CompRecord* rec = comp_record_new(comp_id_name(id), comp_registry[id].size, table->max_entity_cnt);
+	table->records[id] = rec;
+	table->record_cnt++;
+	return rec;
 }
 
 
@@ -143,13 +252,24 @@ CompRecord* __comp_table_get_record(CompTable* table, char* name) {
 
 
 ECS* ecs_new(u32 max_entity_cnt) {
+	assert(max_entity_cnt <= ENTITY_MAX_CNT, "Ecs can hold at most `%u` entities, got `%u`.\n", ENTITY_MAX_CNT, max_entity_cnt);
+
 	ECS* ecs = alloc(sizeof(ECS));
 	ecs->entity_cnt = 0;
 	ecs->max_entity_cnt = max_entity_cnt;
+	ecs->tick = 1;
 
 	// allocating entity slots
 	ecs->slots = alloc(sizeof(EntitySlotState) * max_entity_cnt);
 	memset(ecs->slots, FREE, sizeof(EntitySlotState) * max_entity_cnt);
+	ecs->generations = alloc(sizeof(u16) * max_entity_cnt);
+
+	// Free list is a stack, filled in reverse so slot 0 is handed out first
+	ecs->free_list = alloc_raw(sizeof(u32) * max_entity_cnt);
+	for (u32 i = 0; i < max_entity_cnt; i++) {
+		ecs->free_list[i] = max_entity_cnt - 1 - i;
+	}
+	ecs->free_cnt = max_entity_cnt;
 
 	// Creating table
 	ecs->table = comp_table_new(max_entity_cnt);
@@ -163,80 +283,814 @@ void ecs_delete(ECS* ecs) {
 		printf("Not all the entities are deleted.\n");
 	}
 
+	for (u32 i = 0; i < ecs->query_cnt; i++) {
+		ECS_Query* q = ecs->queries[i];
+		clean(q->ents);
+		clean(q->sparse);
+		clean(q);
+	}
+
+	for (u32 i = 0; i < THREAD_POOL_MAX_THREAD_CNT; i++) {
+		ECS_Cmd_Buffer* buf = ecs->cmd_buffers[i];
+		if (!buf) continue;
+		free(buf->data);
+		free(buf->spawned);
+		free(buf);
+	}
+	clean(ecs->cmd_sort);
+
 	comp_table_delete(ecs->table);
-	clean(ecs->slots);
+
+	// Slots of a loaded ecs live in the snapshot
+	if (ecs->snapshot.data) {
+		file_map_close(&ecs->snapshot);
+	} else {
+		clean(ecs->free_list);
+		clean(ecs->generations);
+		clean(ecs->slots);
+	}
 	clean(ecs);
 }
 
 
+/* =======================
+ * Query
+ * ======================= */
+
+
+static b32 query_matches(ECS_Query* q, Entity ent) {
+	u32 slot = entity_index(ent);
+	for (u32 k = 0; k < q->comp_cnt; k++) {
+		if (q->recs[k]->sparse[slot] == COMP_RECORD_INVALID) return false;
+	}
+	return true;
+}
+
+static b32 query_contains(ECS_Query* q, Entity ent) {
+	u32 slot = entity_index(ent);
+	if (q->owning) {
+		u32 idx = q->recs[0]->sparse[slot];
+		return idx != COMP_RECORD_INVALID && idx < q->len;
+	}
+	return q->sparse[slot] != COMP_RECORD_INVALID;
+}
+
+static void query_insert(ECS_Query* q, Entity ent) {
+	u32 slot = entity_index(ent);
+
+	if (q->owning) {
+		// Moving the entity to the end of the matched block of every record
+		for (u32 k = 0; k < q->comp_cnt; k++) {
+			CompRecord* rec = q->recs[k];
+			comp_record_swap(rec, rec->sparse[slot], q->len);
+			rec->moved_tick = q->ecs->tick;
+		}
+		q->len++;
+		return;
+	}
+
+	if (q->len == q->ents_cap) {
+		q->ents_cap = q->ents_cap ? q->ents_cap * 2 : COMP_RECORD_MIN_CAP;
+		q->ents = alloc_resize(q->ents, sizeof(Entity) * q->ents_cap);
+	}
+	q->sparse[slot] = q->len;
+	q->ents[q->len++] = ent;
+}
+
+static void query_remove(ECS_Query* q, Entity ent) {
+	u32 slot = entity_index(ent);
+	q->len--;
+
+	if (q->owning) {
+		// Moving the entity just past the matched block of every record
+		for (u32 k = 0; k < q->comp_cnt; k++) {
+			CompRecord* rec = q->recs[k];
+			comp_record_swap(rec, rec->sparse[slot], q->len);
+			rec->moved_tick = q->ecs->tick;
+		}
+		return;
+	}
+
+	u32 idx = q->sparse[slot];
+	Entity moved = q->ents[q->len];
+	q->ents[idx] = moved;
+	q->sparse[entity_index(moved)] = idx;
+	q->sparse[slot] = COMP_RECORD_INVALID;
+}
+
+// Called after `id` is added to `ent`
+static void queries_on_add(ECS* ecs, CompID id, Entity ent) {
+	for (u32 i = 0; i < ecs->query_cnt; i++) {
+		ECS_Query* q = ecs->queries[i];
+		if ((q->mask >> id & 1) && query_matches(q, ent)) {
+			query_insert(q, ent);
+		}
+	}
+}
+
+// Called before `id` is removed from `ent`
+static void queries_on_remove(ECS* ecs, CompID id, Entity ent) {
+	for (u32 i = 0; i < ecs->query_cnt; i++) {
+		ECS_Query* q = ecs->queries[i];
+		if ((q->mask >> id & 1) && query_contains(q, ent)) {
+			query_remove(q, ent);
+		}
+	}
+}
+
+ECS_Query* __ecs_query_new(ECS* ecs, CompID* comps, u32 comp_cnt) {
+	assert(comp_cnt > 0 && comp_cnt <= ECS_QUERY_MAX_COMP, "Query needs 1 to %d components, got %u.\n", ECS_QUERY_MAX_COMP, comp_cnt);
+
+	// Reusing the query if it was already created
+	for (u32 i = 0; i < ecs->query_cnt; i++) {
+		ECS_Query* q = ecs->queries[i];
+		if (q->comp_cnt == comp_cnt && memcmp(q->comps, comps, sizeof(CompID) * comp_cnt) == 0) {
+			return q;
+		}
+	}
+	assert(ecs->query_cnt < ECS_MAX_QUERY_CNT, "Query limit reached. Cant create new query.\n");
+
+	ECS_Query* q = alloc(sizeof(ECS_Query));
+	q->ecs = ecs;
+	q->comp_cnt = comp_cnt;
+	for (u32 k = 0; k < comp_cnt; k++) {
+		CompID id = comps[k];
+		assert(!(q->mask >> id & 1), "Component `%s` is repeated in the query.\n", comp_id_name(id));
+
+		CompRecord* rec = __comp_table_get_record(ecs->table, id);
+		if (!rec) rec = __comp_table_add_record(ecs->table, id);
+
+		q->comps[k] = id;
+		q->recs[k] = rec;
+		q->mask |= 1ull << id;
+	}
+
+	// Taking ownership of the records if no other query has them
+	q->owning = (ecs->owned_mask & q->mask) == 0;
+	if (q->owning) {
+		ecs->owned_mask |= q->mask;
+	} else {
+		q->sparse = alloc_raw(sizeof(u32) * ecs->max_entity_cnt);
+		memset(q->sparse, 0xff, sizeof(u32) * ecs->max_entity_cnt);
+	}
+
+	// Matching the existing entities by walking the smallest record. Owning
+	// inserts only swap with already visited entries so the walk stays valid.
+	CompRecord* smallest = q->recs[0];
+	for (u32 k = 1; k < comp_cnt; k++) {
+		if (q->recs[k]->entry_cnt < smallest->entry_cnt) smallest = q->recs[k];
+	}
+	for (u32 i = 0; i < smallest->entry_cnt; i++) {
+		Entity ent = smallest->entries_ent[i];
+		if (query_matches(q, ent)) query_insert(q, ent);
+	}
+
+	ecs->queries[ecs->query_cnt++] = q;
+	return q;
+}
+
+ECS_Query_Iter ecs_query_chunk(ECS_Query* q, u32 start, u32 cnt) {
+	assert(start + cnt <= q->len, "Query range %u..%u is out of %u entities.\n", start, start + cnt, q->len);
+
+	ECS_Query_Iter it = { .query = q, .start = start, .cnt = cnt };
+	if (q->owning) {
+		it.entities = q->recs[0]->entries_ent + start;
+		for (u32 k = 0; k < q->comp_cnt; k++) {
+			it.cols[k] = comp_record_at(q->recs[k], start);
+		}
+	} else {
+		it.entities = q->ents + start;
+	}
+	return it;
+}
+
+ECS_Query_Iter ecs_filter_iter(ECS_Filter* filter) {
+	ECS* ecs = filter->query->ecs;
+
+	ECS_Query_Iter it = ecs_query_iter(filter->query);
+	it.filter = filter;
+	it.since = filter->last_tick;
+
+	// Changes made from now on get a newer tick than the one stored
+	filter->last_tick = ecs->tick++;
+	return it;
+}
+
+static b32 filter_passes(ECS_Query_Iter* it, u32 pos) {
+	ECS_Query* q = it->query;
+	ECS_Filter* f = it->filter;
+
+	for (u32 k = 0; k < q->comp_cnt; k++) {
+		u64 bit = 1ull << q->comps[k];
+		if (!((f->changed | f->added) & bit)) continue;
+
+		CompRecord* rec = q->recs[k];
+		u32 idx = q->owning ? pos : rec->sparse[entity_index(q->ents[pos])];
+		if ((f->changed & bit) && rec->changed_ticks[idx] > it->since) return true;
+		if ((f->added & bit) && rec->added_ticks[idx] > it->since) return true;
+	}
+	return false;
+}
+
+b32 ecs_query_next(ECS_Query_Iter* it) {
+	ECS_Query* q = it->query;
+	u32 start = it->start + it->cnt;
+
+	if (it->filter) {
+		// Chunk is the next run of passing entities
+		while (start < q->len && !filter_passes(it, start)) start++;
+		if (start >= q->len) return false;
+
+		u32 end = start + 1;
+		while (end < q->len && end - start < ECS_QUERY_CHUNK_SIZE && filter_passes(it, end)) end++;
+
+		ECS_Filter* filter = it->filter;
+		u32 since = it->since;
+		*it = ecs_query_chunk(q, start, end - start);
+		it->filter = filter;
+		it->since = since;
+		return true;
+	}
+
+	if (start >= q->len) return false;
+
+	u32 cnt = q->len - start < ECS_QUERY_CHUNK_SIZE ? q->len - start : ECS_QUERY_CHUNK_SIZE;
+	*it = ecs_query_chunk(q, start, cnt);
+	return true;
+}
+
+
 /* =======================
  * Entity Commands
  * ======================= */
 
 
 Entity entity_new(ECS* ecs) {
-	assert(ecs->entity_cnt < ecs->max_entity_cnt, "Entity slots are full.\n");
+	assert(ecs->free_cnt, "Entity slots are full.\n");
 	ecs->entity_cnt++;
 
-	// Generating random entity id
-	Entity id = rand_range(0, ecs->max_entity_cnt);
-	do {
-		id = rand_range(0, ecs->max_entity_cnt);
-	} while (ecs->slots[id] != FREE);
+	// Taking the most recently freed slot
+	u32 idx = ecs->free_list[--ecs->free_cnt];
 
 	// Making the slot occupied
-	ecs->slots[id] = OCCUPIED;
-	return id;
+	ecs->slots[idx] = OCCUPIED;
+	return entity_make(idx, ecs->generations[idx]);
+}
+
+void entity_new_n(ECS* ecs, Entity* ents, u32 cnt) {
+	assert(cnt <= ecs->free_cnt, "Not enough free entity slots to create `%u` entities.\n", cnt);
+	ecs->entity_cnt += cnt;
+
+	for (u32 i = 0; i < cnt; i++) {
+		u32 idx = ecs->free_list[--ecs->free_cnt];
+		ecs->slots[idx] = OCCUPIED;
+		ents[i] = entity_make(idx, ecs->generations[idx]);
+	}
 }
 
 void entity_delete(ECS* ecs, Entity ent) {
-	assert(ecs->slots[ent] == OCCUPIED, "Entity `%d` doesnt exists.\n", ent);
+	assert(entity_alive(ecs, ent), "Entity `%d` doesnt exists.\n", ent);
+	u32 idx = entity_index(ent);
 
 	// Searching for components that entity has
-	for (u32 i = 0; i < ecs->table->record_cnt; i++) {
-		CompRecord* rec = ecs->table->records[i];
-		if (comp_record_search(rec, ent)) {
+	for (CompID id = 0, cnt = comp_registry_len(); id < cnt; id++) {
+		CompRecord* rec = ecs->table->records[id];
+		if (rec && rec->sparse[idx] != COMP_RECORD_INVALID) {
+			queries_on_remove(ecs, id, ent);
 			comp_record_remove_entry(rec, ent);
+			rec->moved_tick = ecs->tick;
 		}
 	}
 
-	// Reseting the slot
-	ecs->slots[ent] = FREE;
+	// Reseting the slot, bumping the generation invalidates old handles
+	ecs->slots[idx] = FREE;
+	ecs->generations[idx] = (ecs->generations[idx] + 1) % ENTITY_GEN_MASK;
+	ecs->free_list[ecs->free_cnt++] = idx;
 	ecs->entity_cnt--;
 }
 
-void* __entity_add_component(ECS* ecs, Entity ent, char* name, void* data) {
-	assert(ecs->slots[ent] == OCCUPIED, "Entity `%d` doesnt exists.\n", ent);
+void entity_delete_n(ECS* ecs, Entity* ents, u32 cnt) {
+	for (u32 i = 0; i < cnt; i++) {
+		entity_delete(ecs, ents[i]);
+	}
+}
 
-	if (!__comp_table_search(ecs->table, name)) {
-		__comp_table_add_record(ecs->table, name);
+void* __entity_add_component(ECS* ecs, Entity ent, CompID id, void* data) {
+	assert(entity_alive(ecs, ent), "Entity `%d` doesnt exists.\n", ent);
+
+	CompRecord* rec = __comp_table_get_record(ecs->table, id);
+	if (!rec) {
+		rec = __comp_table_add_record(ecs->table, id);
 	}
 
-	CompRecord* rec  = __comp_table_get_record(ecs->table, name);
-	CompEntry* entry = comp_record_add_entry(rec, ent, data);
+	comp_record_add_entry(rec, ent, data);
+	queries_on_add(ecs, id, ent);
 
-	assert(entry, "Failed to add component `%s` in entity `%d`.\n", name, ent);
-	return entry->data;
+	// Queries may have moved the component
+	u32 idx = rec->sparse[entity_index(ent)];
+	rec->added_ticks[idx] = ecs->tick;
+	rec->changed_ticks[idx] = ecs->tick;
+	return comp_record_at(rec, idx);
 }
 
-void* __entity_get_component(ECS* ecs, Entity ent, char* name) {
-	assert(__comp_table_search(ecs->table, name), "Component `%s` is not in component table.\n", name);
-
-	CompRecord* rec = __comp_table_get_record(ecs->table, name);
-	assert(comp_record_search(rec, ent), "Entity `%d` doesnt have component `%s`.\n", ent, name);
+void* __entity_get_component(ECS* ecs, Entity ent, CompID id) {
+	assert(entity_alive(ecs, ent), "Entity `%d` doesnt exists.\n", ent);
+	CompRecord* rec = __comp_table_get_record(ecs->table, id);
+	assert(rec, "Component `%s` is not in component table.\n", comp_id_name(id));
 
-	CompEntry* entry = comp_record_get_entry(rec, ent);
-	assert(entry, "Entity `%d` doesnt have component `%s`\n", ent, name);
+	void* comp = comp_record_get_entry(rec, ent);
+	assert(comp, "Entity `%d` doesnt have component `%s`.\n", ent, rec->name);
 
-	return entry->data;
+	rec->changed_ticks[rec->sparse[entity_index(ent)]] = ecs->tick;
+	return comp;
 }
 
-void __entity_remove_component(ECS* ecs, Entity ent, char* name) {
-	assert(__comp_table_search(ecs->table, name), "Component `%s` is not in table.\n", name);
+const void* __entity_read_component(ECS* ecs, Entity ent, CompID id) {
+	assert(entity_alive(ecs, ent), "Entity `%d` doesnt exists.\n", ent);
+	CompRecord* rec = __comp_table_get_record(ecs->table, id);
+	assert(rec, "Component `%s` is not in component table.\n", comp_id_name(id));
 
-	CompRecord* rec = __comp_table_get_record(ecs->table, name);
-	assert(comp_record_search(rec, ent), "Entity `%d` doesnt have component `%s`.\n", ent, name);
+	void* comp = comp_record_get_entry(rec, ent);
+	assert(comp, "Entity `%d` doesnt have component `%s`.\n", ent, rec->name);
+	return comp;
+}
+
+void __entity_remove_component(ECS* ecs, Entity ent, CompID id) {
+	assert(entity_alive(ecs, ent), "Entity `%d` doesnt exists.\n", ent);
+	CompRecord* rec = __comp_table_get_record(ecs->table, id);
+	assert(rec, "Component `%s` is not in table.\n", comp_id_name(id));
+	assert(comp_record_search(rec, ent), "Entity `%d` doesnt have component `%s`.\n", ent, rec->name);
 
+	queries_on_remove(ecs, id, ent);
 	comp_record_remove_entry(rec, ent);
+	rec->moved_tick = ecs->tick;
+}
+
+
+/* =======================
+ * Entity Command Buffers
+ * ======================= */
+
+
+// Commands are kept 16 byte aligned so the component data after them is too
+#define ECS_CMD_ALIGN 16
+#define ecs_cmd_stride(size) ((sizeof(ECS_Cmd) + (size) + ECS_CMD_ALIGN - 1) & ~((u64) ECS_CMD_ALIGN - 1))
+
+ECS_Cmd_Buffer* ecs_cmd_buffer(ECS* ecs) {
+	u32 idx = thread_pool_thread_idx();
+	ECS_Cmd_Buffer* buf = ecs->cmd_buffers[idx];
+	if (!buf) {
+		// Only this thread touches its slot
+		buf = calloc(1, sizeof(ECS_Cmd_Buffer));
+		ecs->cmd_buffers[idx] = buf;
+	}
+	return buf;
+}
+
+static ECS_Cmd* cmd_push(ECS* ecs, ECS_Cmd_Type type, Entity ent, CompID id, u32 size) {
+	ECS_Cmd_Buffer* buf = ecs_cmd_buffer(ecs);
+	u64 stride = ecs_cmd_stride(size);
+	if (buf->len + stride > buf->cap) {
+		buf->cap = buf->cap * 2 > buf->len + stride ? buf->cap * 2 : buf->len + stride + 4096;
+		buf->data = realloc(buf->data, buf->cap);
+		assert(buf->data, "Failed to grow command buffer to %llu bytes.\n", buf->cap);
+	}
+
+	ECS_Cmd* cmd = (ECS_Cmd*) (buf->data + buf->len);
+	cmd->type = type;
+	cmd->comp = id;
+	cmd->ent = ent;
+	cmd->size = size;
+	buf->len += stride;
+	return cmd;
+}
+
+Entity ecs_cmd_spawn(ECS* ecs) {
+	ECS_Cmd_Buffer* buf = ecs_cmd_buffer(ecs);
+	assert(buf->spawn_cnt < ENTITY_INDEX_MASK, "Too many spawns recorded before a flush.\n");
+	return entity_make(buf->spawn_cnt++, ENTITY_GEN_MASK);
+}
+
+void __ecs_cmd_add(ECS* ecs, Entity ent, CompID id, void* data, u32 size) {
+	ECS_Cmd* cmd = cmd_push(ecs, ECS_CMD_ADD, ent, id, size);
+	memcpy(cmd + 1, data, size);
+}
+
+void __ecs_cmd_remove(ECS* ecs, Entity ent, CompID id) {
+	cmd_push(ecs, ECS_CMD_REMOVE, ent, id, 0);
+}
+
+void ecs_cmd_delete(ECS* ecs, Entity ent) {
+	cmd_push(ecs, ECS_CMD_DELETE, ent, COMP_ID_INVALID, 0);
+}
+
+// Placeholder handles of `ecs_cmd_spawn`
+#define ecs_cmd_is_placeholder(ent) (entity_generation(ent) == ENTITY_GEN_MASK && (ent) != ENTITY_INVALID)
+
+// Walks every command of a buffer
+#define ecs_cmd_buffer_for_each(buf, cmd, block)\
+	for (u64 __off = 0; __off < (buf)->len; __off += ecs_cmd_stride(((ECS_Cmd*) ((buf)->data + __off))->size)) {\
+		ECS_Cmd* cmd = (ECS_Cmd*) ((buf)->data + __off);\
+		block;\
+	}\
+
+/*
+ * Sort key of a command: deletes of existing entities first so the spawns
+ * reuse the slots they free, then adds and removes by component and deletes
+ * of spawned entities last. Adds and removes of a component share a key so
+ * the stable sort keeps them in record order.
+ */
+
+#define ECS_CMD_KEY_COMP        1
+#define ECS_CMD_KEY_LATE_DELETE (ECS_CMD_KEY_COMP + ECS_MAX_COMP_TYPES)
+#define ECS_CMD_KEY_CNT         (ECS_CMD_KEY_LATE_DELETE + 1)
+
+static u32 cmd_key(ECS_Cmd* cmd) {
+	switch (cmd->type) {
+		case ECS_CMD_ADD:
+		case ECS_CMD_REMOVE: return ECS_CMD_KEY_COMP + cmd->comp;
+		default:             return ecs_cmd_is_placeholder(cmd->ent) ? ECS_CMD_KEY_LATE_DELETE : 0;
+	}
 }
 
+static void cmd_apply(ECS* ecs, ECS_Cmd* cmd) {
+	if (!entity_alive(ecs, cmd->ent)) return;
+
+	switch (cmd->type) {
+		case ECS_CMD_ADD: {
+			CompRecord* rec = ecs->table->records[cmd->comp];
+			assert(rec->comp_size == cmd->size, "Component `%s` has size %u, command has %u.\n", rec->name, rec->comp_size, cmd->size);
+			void* comp = comp_record_get_entry(rec, cmd->ent);
+			if (comp) {
+				memcpy(comp, cmd + 1, cmd->size);
+				rec->changed_ticks[rec->sparse[entity_index(cmd->ent)]] = ecs->tick;
+			} else {
+				__entity_add_component(ecs, cmd->ent, cmd->comp, cmd + 1);
+			}
+			break;
+		}
+
+		case ECS_CMD_REMOVE: {
+			CompRecord* rec = __comp_table_get_record(ecs->table, cmd->comp);
+			if (rec && comp_record_search(rec, cmd->ent))
+				__entity_remove_component(ecs, cmd->ent, cmd->comp);
+			break;
+		}
+
+		case ECS_CMD_DELETE:
+			entity_delete(ecs, cmd->ent);
+			break;
+	}
+}
+
+void ecs_flush(ECS* ecs) {
+	u32 counts[ECS_CMD_KEY_CNT] = {0};
+	u32 add_counts[ECS_MAX_COMP_TYPES] = {0};
+	u32 cmd_cnt = 0;
+
+	for (u32 b = 0; b < THREAD_POOL_MAX_THREAD_CNT; b++) {
+		ECS_Cmd_Buffer* buf = ecs->cmd_buffers[b];
+		if (!buf) continue;
+		ecs_cmd_buffer_for_each(buf, cmd, {
+			counts[cmd_key(cmd)]++;
+			if (cmd->type == ECS_CMD_ADD) add_counts[cmd->comp]++;
+			cmd_cnt++;
+		});
+	}
+
+	if (cmd_cnt > ecs->cmd_sort_cap) {
+		ecs->cmd_sort_cap = cmd_cnt;
+		ecs->cmd_sort = alloc_resize(ecs->cmd_sort, sizeof(void*) * cmd_cnt);
+	}
+
+	// Counting sort, keeping the record order of every thread
+	u32 starts[ECS_CMD_KEY_CNT];
+	u32 sum = 0;
+	for (u32 k = 0; k < ECS_CMD_KEY_CNT; k++) {
+		starts[k] = sum;
+		sum += counts[k];
+	}
+	u32 early_delete_cnt = counts[0];
+	for (u32 b = 0; b < THREAD_POOL_MAX_THREAD_CNT; b++) {
+		ECS_Cmd_Buffer* buf = ecs->cmd_buffers[b];
+		if (!buf) continue;
+		ecs_cmd_buffer_for_each(buf, cmd, {
+			ecs->cmd_sort[starts[cmd_key(cmd)]++] = cmd;
+		});
+	}
+
+	u32 i = 0;
+	for (; i < early_delete_cnt; i++) {
+		cmd_apply(ecs, ecs->cmd_sort[i]);
+	}
+
+	// Creating the spawned entities and resolving placeholders
+	for (u32 b = 0; b < THREAD_POOL_MAX_THREAD_CNT; b++) {
+		ECS_Cmd_Buffer* buf = ecs->cmd_buffers[b];
+		if (!buf || !buf->spawn_cnt) continue;
+
+		if (buf->spawn_cnt > buf->spawned_cap) {
+			buf->spawned_cap = buf->spawn_cnt;
+			buf->spawned = realloc(buf->spawned, sizeof(Entity) * buf->spawned_cap);
+		}
+		entity_new_n(ecs, buf->spawned, buf->spawn_cnt);
+
+		ecs_cmd_buffer_for_each(buf, cmd, {
+			if (ecs_cmd_is_placeholder(cmd->ent)) {
+				u32 idx = entity_index(cmd->ent);
+				assert(idx < buf->spawn_cnt, "Placeholder entity `%u` was not spawned by this thread.\n", idx);
+				cmd->ent = buf->spawned[idx];
+			}
+		});
+	}
+
+	// Growing every record once for its whole group of adds
+	for (CompID id = 0, cnt = comp_registry_len(); id < cnt; id++) {
+		if (!add_counts[id]) continue;
+		CompRecord* rec = __comp_table_get_record(ecs->table, id);
+		if (!rec) rec = __comp_table_add_record(ecs->table, id);
+		comp_record_reserve(rec, rec->entry_cnt + add_counts[id]);
+	}
+
+	for (; i < cmd_cnt; i++) {
+		cmd_apply(ecs, ecs->cmd_sort[i]);
+	}
+
+	for (u32 b = 0; b < THREAD_POOL_MAX_THREAD_CNT; b++) {
+		ECS_Cmd_Buffer* buf = ecs->cmd_buffers[b];
+		if (!buf) continue;
+		buf->len = 0;
+		buf->spawn_cnt = 0;
+	}
+}
+
+
+/* =======================
+ * World Snapshots
+ * ======================= */
+
+
+static struct {
+	ECS_Save_Fn save;
+	ECS_Load_Fn load;
+} snapshot_hooks[ECS_MAX_COMP_TYPES];
+
+void __ecs_snapshot_hook(CompID id, ECS_Save_Fn save, ECS_Load_Fn load) {
+	assert(id < comp_registry_len(), "Component id `%u` is not registered.\n", id);
+	assert(save && load, "Component `%s` needs both snapshot hooks.\n", comp_id_name(id));
+	snapshot_hooks[id].save = save;
+	snapshot_hooks[id].load = load;
+}
+
+u64 ecs_blob_push(ECS_Blob* blob, const void* data, u64 size) {
+	u64 off = (blob->len + 7) & ~7ull;
+	if (off + size > blob->cap) {
+		u64 cap = blob->cap ? blob->cap * 2 : 4096;
+		while (cap < off + size) cap *= 2;
+		blob->data = alloc_resize(blob->data, cap);
+		blob->cap = cap;
+	}
+
+	memset(blob->data + blob->len, 0, off - blob->len);
+	memcpy(blob->data + off, data, size);
+	blob->len = off + size;
+
+	// Refs are offsets + 1 so a NULL pointer is never a valid ref
+	return off + 1;
+}
+
+static u64 snapshot_align(u64 off) {
+	return (off + ECS_SNAPSHOT_ALIGN - 1) & ~(u64) (ECS_SNAPSHOT_ALIGN - 1);
+}
+
+// Writes `data` at `off`, zero padding from the current position
+static b32 snapshot_write(FILE* file, u64* pos, u64 off, const void* data, u64 size) {
+	static const u8 zeros[ECS_SNAPSHOT_ALIGN];
+	if (off - *pos && fwrite(zeros, 1, off - *pos, file) != off - *pos) return false;
+	if (size && fwrite(data, 1, size, file) != size) return false;
+	*pos = off + size;
+	return true;
+}
+
+Result_u64 ecs_snapshot_save(ECS* ecs, const char* path) {
+	for (u32 i = 0; i < THREAD_POOL_MAX_THREAD_CNT; i++) {
+		ECS_Cmd_Buffer* buf = ecs->cmd_buffers[i];
+		assert(!buf || (buf->len == 0 && buf->spawn_cnt == 0), "Commands have to be flushed before saving a snapshot.\n");
+	}
+
+	u32 max = ecs->max_entity_cnt;
+	ECS_Snapshot_Header header = {
+		.magic = ECS_SNAPSHOT_MAGIC,
+		.version = ECS_SNAPSHOT_VERSION,
+		.max_entity_cnt = max,
+		.entity_cnt = ecs->entity_cnt,
+		.free_cnt = ecs->free_cnt,
+		.tick = ecs->tick,
+	};
+
+	// Laying out every section up front so the file is written front to back
+	CompRecord* recs[ECS_MAX_COMP_TYPES];
+	CompID ids[ECS_MAX_COMP_TYPES];
+	ECS_Snapshot_Comp comps[ECS_MAX_COMP_TYPES] = { 0 };
+	for (CompID id = 0, cnt = comp_registry_len(); id < cnt; id++) {
+		CompRecord* rec = ecs->table->records[id];
+		if (!rec) continue;
+		assert(strlen(rec->name) < ECS_SNAPSHOT_NAME_LEN, "Component name `%s` is too long for a snapshot.\n", rec->name);
+
+		ECS_Snapshot_Comp* c = &comps[header.comp_cnt];
+		strcpy(c->name, rec->name);
+		c->comp_size = rec->comp_size;
+		c->entry_cnt = rec->entry_cnt;
+		c->hooked = snapshot_hooks[id].save != NULL;
+		ids[header.comp_cnt] = id;
+		recs[header.comp_cnt++] = rec;
+	}
+
+	u64 off = sizeof(ECS_Snapshot_Header) + sizeof(ECS_Snapshot_Comp) * header.comp_cnt;
+	header.slots_off = snapshot_align(off);
+	header.generations_off = snapshot_align(header.slots_off + sizeof(EntitySlotState) * max);
+	header.free_list_off = snapshot_align(header.generations_off + sizeof(u16) * max);
+	off = header.free_list_off + sizeof(u32) * max;
+
+	for (u32 i = 0; i < header.comp_cnt; i++) {
+		ECS_Snapshot_Comp* c = &comps[i];
+		c->entries_off = snapshot_align(off);
+		c->data_off = snapshot_align(c->entries_off + sizeof(Entity) * c->entry_cnt);
+		c->added_off = snapshot_align(c->data_off + (u64) c->comp_size * c->entry_cnt);
+		c->changed_off = snapshot_align(c->added_off + sizeof(u32) * c->entry_cnt);
+		c->sparse_off = snapshot_align(c->changed_off + sizeof(u32) * c->entry_cnt);
+		off = c->sparse_off + sizeof(u32) * max;
+	}
+	header.blob_off = snapshot_align(off);
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		return ERR(u64, "Failed to open snapshot file for writing.");
+	}
+
+	// Header is written again once the blob size is known
+	u64 pos = 0;
+	b32 ok = snapshot_write(file, &pos, 0, &header, sizeof(header));
+	ok = ok && snapshot_write(file, &pos, pos, comps, sizeof(ECS_Snapshot_Comp) * header.comp_cnt);
+	ok = ok && snapshot_write(file, &pos, header.slots_off, ecs->slots, sizeof(EntitySlotState) * max);
+	ok = ok && snapshot_write(file, &pos, header.generations_off, ecs->generations, sizeof(u16) * max);
+	ok = ok && snapshot_write(file, &pos, header.free_list_off, ecs->free_list, sizeof(u32) * max);
+
+	ECS_Blob blob = { 0 };
+	u8* chunk = NULL;
+	for (u32 i = 0; ok && i < header.comp_cnt; i++) {
+		ECS_Snapshot_Comp* c = &comps[i];
+		CompRecord* rec = recs[i];
+		ok = ok && snapshot_write(file, &pos, c->entries_off, rec->entries_ent, sizeof(Entity) * c->entry_cnt);
+
+		if (!c->hooked) {
+			ok = ok && snapshot_write(file, &pos, c->data_off, rec->data, (u64) c->comp_size * c->entry_cnt);
+		} else {
+			// Hooks rewrite copies, the live components keep their pointers
+			ECS_Save_Fn save = snapshot_hooks[ids[i]].save;
+			if (!chunk) chunk = alloc_raw((u64) ECS_QUERY_CHUNK_SIZE * rec->comp_size);
+			else chunk = alloc_resize(chunk, (u64) ECS_QUERY_CHUNK_SIZE * rec->comp_size);
+
+			u64 chunk_off = c->data_off;
+			for (u32 start = 0; ok && start < c->entry_cnt; start += ECS_QUERY_CHUNK_SIZE) {
+				u32 cnt = c->entry_cnt - start < ECS_QUERY_CHUNK_SIZE ? c->entry_cnt - start : ECS_QUERY_CHUNK_SIZE;
+				memcpy(chunk, comp_record_at(rec, start), (u64) cnt * rec->comp_size);
+				for (u32 j = 0; j < cnt; j++) {
+					save(chunk + (u64) j * rec->comp_size, &blob);
+				}
+				ok = ok && snapshot_write(file, &pos, chunk_off, chunk, (u64) cnt * rec->comp_size);
+				chunk_off += (u64) cnt * rec->comp_size;
+			}
+		}
+
+		ok = ok && snapshot_write(file, &pos, c->added_off, rec->added_ticks, sizeof(u32) * c->entry_cnt);
+		ok = ok && snapshot_write(file, &pos, c->changed_off, rec->changed_ticks, sizeof(u32) * c->entry_cnt);
+		ok = ok && snapshot_write(file, &pos, c->sparse_off, rec->sparse, sizeof(u32) * max);
+	}
+
+	header.blob_size = blob.len;
+	header.file_size = header.blob_off + blob.len;
+	ok = ok && snapshot_write(file, &pos, header.blob_off, blob.data, blob.len);
+	ok = ok && fseek(file, 0, SEEK_SET) == 0;
+	ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+
+	if (chunk) clean(chunk);
+	if (blob.data) clean(blob.data);
+
+	if (!ok) {
+		return ERR(u64, "Failed to write snapshot file.");
+	}
+	return OK(u64, header.file_size);
+}
+
+static b32 snapshot_fits(File_Map* map, u64 off, u64 size) {
+	return off % 8 == 0 && off <= map->size && size <= map->size - off;
+}
+
+// Checks the whole file before anything is built, fills the id of every component
+static const char* snapshot_validate(File_Map* map, CompID* ids) {
+	if (map->size < sizeof(ECS_Snapshot_Header)) return "Snapshot file is too small.";
+
+	ECS_Snapshot_Header* header = (ECS_Snapshot_Header*) map->data;
+	if (header->magic != ECS_SNAPSHOT_MAGIC) return "File is not an ecs snapshot.";
+	if (header->version != ECS_SNAPSHOT_VERSION) return "Snapshot version is not supported.";
+	if (header->file_size != map->size) return "Snapshot file is truncated.";
+	if (header->max_entity_cnt > ENTITY_MAX_CNT) return "Snapshot has too many entity slots.";
+	if (header->free_cnt > header->max_entity_cnt || header->entity_cnt != header->max_entity_cnt - header->free_cnt)
+		return "Snapshot entity counts are inconsistent.";
+	if (header->comp_cnt > ECS_MAX_COMP_TYPES) return "Snapshot has too many components.";
+
+	u64 max = header->max_entity_cnt;
+	if (!snapshot_fits(map, sizeof(ECS_Snapshot_Header), sizeof(ECS_Snapshot_Comp) * header->comp_cnt) ||
+		!snapshot_fits(map, header->slots_off, sizeof(EntitySlotState) * max) ||
+		!snapshot_fits(map, header->generations_off, sizeof(u16) * max) ||
+		!snapshot_fits(map, header->free_list_off, sizeof(u32) * max) ||
+		!snapshot_fits(map, header->blob_off, header->blob_size))
+		return "Snapshot section is out of the file.";
+
+	ECS_Snapshot_Comp* comps = (ECS_Snapshot_Comp*) (header + 1);
+	u64 seen = 0;
+	for (u32 i = 0; i < header->comp_cnt; i++) {
+		ECS_Snapshot_Comp* c = &comps[i];
+		if (memchr(c->name, 0, ECS_SNAPSHOT_NAME_LEN) == NULL) return "Snapshot component name is corrupted.";
+
+		CompID id = comp_id_find(c->name);
+		if (id == COMP_ID_INVALID) return "Snapshot component is not registered.";
+		if (comp_registry[id].size != c->comp_size) return "Snapshot component size doesnt match the registered one.";
+		if (seen & (1ull << id)) return "Snapshot has a component twice.";
+		if (c->hooked && !snapshot_hooks[id].load) return "Snapshot component needs a load hook.";
+		if (c->entry_cnt > max) return "Snapshot component has too many entries.";
+
+		if (!snapshot_fits(map, c->entries_off, sizeof(Entity) * c->entry_cnt) ||
+			!snapshot_fits(map, c->data_off, (u64) c->comp_size * c->entry_cnt) ||
+			!snapshot_fits(map, c->added_off, sizeof(u32) * c->entry_cnt) ||
+			!snapshot_fits(map, c->changed_off, sizeof(u32) * c->entry_cnt) ||
+			!snapshot_fits(map, c->sparse_off, sizeof(u32) * max))
+			return "Snapshot section is out of the file.";
+
+		seen |= 1ull << id;
+		ids[i] = id;
+	}
+	return NULL;
+}
+
+Result_ECS ecs_snapshot_load(const char* path) {
+	Result_File_Map r_map = file_map_open(path);
+	if (r_map.status == ERROR) {
+		return ERR(ECS, unwrap_err(r_map));
+	}
+	File_Map map = unwrap(r_map);
+
+	CompID ids[ECS_MAX_COMP_TYPES];
+	const char* err = snapshot_validate(&map, ids);
+	if (err) {
+		file_map_close(&map);
+		return ERR(ECS, err);
+	}
+
+	ECS_Snapshot_Header* header = (ECS_Snapshot_Header*) map.data;
+	ECS* ecs = alloc(sizeof(ECS));
+	ecs->entity_cnt = header->entity_cnt;
+	ecs->max_entity_cnt = header->max_entity_cnt;
+	ecs->tick = header->tick;
+	ecs->snapshot = map;
+
+	// Slots and records point into the mapping, pages are copied only when written
+	ecs->slots = (EntitySlotState*) (map.data + header->slots_off);
+	ecs->generations = (u16*) (map.data + header->generations_off);
+	ecs->free_list = (u32*) (map.data + header->free_list_off);
+	ecs->free_cnt = header->free_cnt;
+	ecs->table = comp_table_new(header->max_entity_cnt);
+
+	ECS_Snapshot_Comp* comps = (ECS_Snapshot_Comp*) (header + 1);
+	for (u32 i = 0; i < header->comp_cnt; i++) {
+		ECS_Snapshot_Comp* c = &comps[i];
+
+		CompRecord* rec = alloc(sizeof(CompRecord));
+		rec->name = alloc(strlen(c->name) + 1);
+		strcpy(rec->name, c->name);
+		rec->comp_size = c->comp_size;
+		rec->entry_cnt = c->entry_cnt;
+		rec->entry_cap = c->entry_cnt;
+		rec->max_entry_cnt = header->max_entity_cnt;
+		rec->entries_ent = (Entity*) (map.data + c->entries_off);
+		rec->data = map.data + c->data_off;
+		rec->added_ticks = (u32*) (map.data + c->added_off);
+		rec->changed_ticks = (u32*) (map.data + c->changed_off);
+		rec->sparse = (u32*) (map.data + c->sparse_off);
+		rec->mapped = COMP_RECORD_MAPPED_PACKED | COMP_RECORD_MAPPED_SPARSE;
+
+		ecs->table->records[ids[i]] = rec;
+		ecs->table->record_cnt++;
+
+		if (c->hooked) {
+			ECS_Load_Fn load = snapshot_hooks[ids[i]].load;
+			for (u32 j = 0; j < rec->entry_cnt; j++) {
+				load(comp_record_at(rec, j), map.data + header->blob_off);
+			}
+		}
+	}
+
+	return OK(ECS, ecs);
+}
@@ -5,18 +5,25 @@
 
 #include "core/defines.h"
 #include "core/alloc.h"
+#include "core/result.h"
+#include "core/file_map.h"
+#include "core/thread_pool.h"
 #include "math/utils.h"
 #include "math/vec.h"
 
 /*
  * Table structure
- * 
+ *
+ * Every component type has a record which stores its components packed in
+ * one contiguous array (sparse set). `sparse` maps an entity index to the
+ * index of its component in the packed arrays, `entries_ent` maps back.
+ *
+ * Component types are registered once with an integer id (`comp_id`), the
+ * table is indexed by that id and the name is only kept for debugging.
+ *
  * comp_table = {
- *                    CompEntry
- *                         |
- *                        \/
- *	"component_1": { [ent1, comp1], [ent2, comp2], [ent3, comp3] ... }   <== comp_record
- *	"component_2": { [ent1, comp1], [ent2, comp2], [ent3, comp3] ... }
+ *	"component_1": { sparse: [ent -> idx], entries_ent: [ent3, ent1 ...], data: [comp, comp ...] }   <== comp_record
+ *	"component_2": { sparse: [ent -> idx], entries_ent: [ent2, ent3 ...], data: [comp, comp ...] }
  * }
  */
 
@@ -36,76 +43,90 @@ typedef enum {
 
 /*
  * @brief Iso Entity type definition
+ * @info Low `ENTITY_INDEX_BITS` bits are the slot index, the rest is the
+ *       generation of the slot. Deleting an entity bumps the generation of
+ *       its slot so old handles to it can be detected. Generation
+ *       `ENTITY_GEN_MASK` is never used by slots, it marks the placeholder
+ *       handles returned by `ecs_cmd_spawn`.
  */
 
 typedef u32 Entity;
 
-
-/* =======================
- * Component Entry
- * ======================= */
+#define ENTITY_INDEX_BITS 22
+#define ENTITY_GEN_BITS   10
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GEN_MASK   ((1u << ENTITY_GEN_BITS) - 1)
+#define ENTITY_MAX_CNT    ENTITY_INDEX_MASK
+#define ENTITY_INVALID    0xffffffff
 
 
 /*
- * @brief Component struct that stores entity id and component data
- * @mem ent  = Entity id
- * @mem data = Component data
+ * @brief Macros to pack and unpack entity handles
  */
 
-typedef struct {
-	Entity ent;
-	void* data;
-} CompEntry;
-
+#define entity_index(ent)           ((u32) (ent) & ENTITY_INDEX_MASK)
+#define entity_generation(ent)      ((u32) (ent) >> ENTITY_INDEX_BITS)
+#define entity_make(index, gen)     ((Entity) (((u32) (gen) << ENTITY_INDEX_BITS) | (u32) (index)))
 
-/*
- * @brief Function to create component entry
- * @param ent  = entity
- * @param data = Component data
- * @return Returns pointer to CompEntry struct
- */
 
-CompEntry* comp_entry_new(Entity ent, void* data);
+/* =======================
+ * Component Record
+ * ======================= */
 
 
 /*
- * @brief Function to delete CompEntry
- * @param entry = Pointer to CompEntry struct
+ * @brief Index stored in the sparse array for entities without the component
  */
 
-void comp_entry_delete(CompEntry* entry);
+#define COMP_RECORD_INVALID 0xffffffff
+#define COMP_RECORD_MIN_CAP 16
 
-
-/* =======================
- * Component Record
- * ======================= */
+// Arrays of a record pointing into a mapped snapshot instead of the allocator
+#define COMP_RECORD_MAPPED_PACKED 1
+#define COMP_RECORD_MAPPED_SPARSE 2
 
 
 /*
- * @brief Struct that holds a multiple entries of a single component type
+ * @brief Struct that holds every component of a single type packed together
  * @mem name          = Name of the component
+ * @mem comp_size     = Size of a single component in bytes
  * @mem entry_cnt     = No of entry created
+ * @mem entry_cap     = Capacity of the packed arrays
  * @mem max_entry_cnt = Max amount of entry that can be created
- * @mem entries       = Array of CompEntry
+ * @mem entries_ent   = Packed array of entities owning each component
+ * @mem data          = Packed array of components
+ * @mem sparse        = Entity index to packed index lookup
+ * @mem added_ticks   = Packed array of the ecs tick each component was added at
+ * @mem changed_ticks = Packed array of the ecs tick each component was last mutably accessed at
+ * @mem moved_tick    = Ecs tick entries were last removed or moved at
+ * @mem mapped        = COMP_RECORD_MAPPED_* flags of the arrays borrowed from a snapshot
  */
 
 typedef struct {
 	char* name;
+	u32   comp_size;
 	u32   entry_cnt;
+	u32   entry_cap;
 	u32   max_entry_cnt;
 	Entity* entries_ent;
-	CompEntry** entries;
+	u8*     data;
+	u32*    sparse;
+	u32*    added_ticks;
+	u32*    changed_ticks;
+	u32     moved_tick;
+	u32     mapped;
 } CompRecord;
 
 
 /*
  * @brief Function to create a new comp_record
  * @param name          = Name of the record
+ * @param comp_size     = Size of the component in bytes
  * @param max_entry_cnt = Max amount of entry to support
  * @return Returns pointer to comp_record struct
  */
 
-CompRecord* comp_record_new(char* name, u32 max_entry_cnt);
+CompRecord* comp_record_new(char* name, u32 comp_size, u32 max_entry_cnt);
 
 
 /*
@@ -130,27 +151,56 @@ b32 comp_record_search(CompRecord* rec, Entity ent);
  * @brief Function to add a new entry in the component record
  * @param rec  = Pointer to comp_record
  * @param ent  = entity
- * @param data = Component data
- * @return Returns pointer to CompEntry struct
+ * @param data = Component data, `comp_size` bytes are copied from it
+ * @return Returns pointer to the stored component
  */
 
-CompEntry* comp_record_add_entry(CompRecord* rec, Entity ent, void* data);
+void* comp_record_add_entry(CompRecord* rec, Entity ent, void* data);
 
 
 /*
  * @brief Function to get the entry from record according to the entity id
  * @param rec = Pointer to the comp_record struct
  * @param ent = entity
- * @return Returns pointer to CompEntry struct
+ * @return Returns pointer to the component or NULL if the entity doesn't have it
  */
 
-CompEntry* comp_record_get_entry(CompRecord* rec, Entity ent);
+void* comp_record_get_entry(CompRecord* rec, Entity ent);
+
+
+/*
+ * @brief Function to get the entry guessing its packed index first
+ * @param rec  = Pointer to the comp_record struct
+ * @param ent  = entity
+ * @param hint = Packed index where the entity is expected to be
+ * @return Returns pointer to the component or NULL if the entity doesn't have it
+ * @info Records filled in the same order keep their entities at the same
+ *       packed index, so iterating one record and passing the loop index as
+ *       the hint reads the other records linearly and skips the sparse lookup.
+ */
+
+static inline void* comp_record_get_entry_hinted(CompRecord* rec, Entity ent, u32 hint) {
+	if (hint < rec->entry_cnt && rec->entries_ent[hint] == ent)
+		return rec->data + (u64) hint * rec->comp_size;
+	return comp_record_get_entry(rec, ent);
+}
+
+
+/*
+ * @brief Macro to get the component stored at a packed index
+ * @param rec = Pointer to the comp_record struct
+ * @param idx = Packed index
+ */
+
+#define comp_record_at(rec, idx) ((void*) ((rec)->data + (u64) (idx) * (rec)->comp_size))
 
 
 /*
  * @brief Function to remove entry from the record
  * @param rec = Pointer to the comp_record
  * @param ent = entity
+ * @info The last packed component is moved into the hole, so the packed
+ *       arrays only ever hold live entries and removal is O(1)
  */
 
 void comp_record_remove_entry(CompRecord* rec, Entity ent);
@@ -161,27 +211,95 @@ void comp_record_remove_entry(CompRecord* rec, Entity ent);
  * ======================= */
 
 
+/*
+ * @brief Integer id of a component type, used to index the component table
+ */
+
+typedef u32 CompID;
+
+#define COMP_ID_INVALID     0xffffffff
+#define ECS_MAX_COMP_TYPES  64
+
+
+/*
+ * @brief Function to register a component type and get its id
+ * @param name = Name of the component
+ * @param size = Size of the component in bytes
+ * @return Returns the id of the component, same name always gives the same id
+ * @info Registry is global and shared by every ecs. Registration takes a lock,
+ *       so a component can be met for the first time on several threads at once.
+ */
+
+CompID __comp_id_register(char* name, u32 size);
+
+
+/*
+ * @brief Function to get the name of a registered component
+ * @param id = Id of the component
+ * @return Returns the name the component was registered with
+ */
+
+char* comp_id_name(CompID id);
+
+
+/*
+ * @brief Function to look up a registered component by name
+ * @param name = Name of the component
+ * @return Returns the id of the component, COMP_ID_INVALID if not registered
+ */
+
+CompID comp_id_find(const char* name);
+
+
+/*
+ * @brief Macro to get the id of a component type
+ * @param comp = Component structure
+ * @info Every call site caches the id in a static, so only the first call
+ *       goes through the registry. The cache is read and written atomically,
+ *       threads racing on the first call all get the same id.
+ */
+
+#define comp_id(comp)                                                       \
+	({                                                                        \
+		static CompID __comp_id = COMP_ID_INVALID;                              \
+		CompID __id = __atomic_load_n(&__comp_id, __ATOMIC_ACQUIRE);            \
+		if (__id == COMP_ID_INVALID) {                                          \
+			__id = __comp_id_register(#comp, sizeof(comp));                       \
+			__atomic_store_n(&__comp_id, __id, __ATOMIC_RELEASE);                 \
+		}                                                                       \
+		__id;                                                                   \
+	})                                                                        \
+
+
+/*
+ * @brief Macro to register a component type up front
+ * @param comp = Component structure
+ */
+
+#define ecs_register_component(comp) ((void) comp_id(comp))
+
+
 /*
  * @brief Structure to hold multiple component records
  * @mem record_cnt     = Total amount of records created
- * @mem max_record_cnt = Max amount of record that can be created
- * @mem records        = Array of comp_record
+ * @mem max_entity_cnt = Max amount of entity each record can hold
+ * @mem records        = Records indexed by component id, NULL if not created
  */
 
 typedef struct {
 	u32 record_cnt;
-	u32 max_record_cnt;
-	CompRecord** records;
+	u32 max_entity_cnt;
+	CompRecord* records[ECS_MAX_COMP_TYPES];
 } CompTable;
 
 
 /*
  * @brief Function to create new comp_table
- * @param max_record_cnt = Maximum amount of record to be created
+ * @param max_entity_cnt = Maximum amount of entity each record can hold
  * @return Returns pointer to comp_table struct
  */
 
-CompTable* comp_table_new(u32 max_record_cnt);
+CompTable* comp_table_new(u32 max_entity_cnt);
 
 
 /*
@@ -195,33 +313,38 @@ void comp_table_delete(CompTable* table);
 /*
  * @brief Function to search for component in comp_table
  * @param table = Pointer to the comp_table
- * @param name  = Name of the component to be searched
+ * @param id    = Id of the component to be searched
  * @return Returns True if found else False
  */
 
-b32 __comp_table_search(CompTable* table, char* name);
-#define comp_table_search(table, comp) __comp_table_search(table, #comp)
+static inline b32 __comp_table_search(CompTable* table, CompID id) {
+	return table->records[id] != NULL;
+}
+#define comp_table_search(table, comp) __comp_table_search(table, comp_id(comp))
 
 
 /*
  * @brief Function to add new component record to the table
  * @param table = Pointer to the comp_table
- * @param name  = Name of the component to be added
+ * @param id    = Id of the component to be added
+ * @return Returns pointer to the new record
  */
 
-void __comp_table_add_record(CompTable* table, char* name);
-#define comp_table_add_record(table, comp) __comp_table_add_record(table, #comp)
+CompRecord* __comp_table_add_record(CompTable* table, CompID id);
+#define comp_table_add_record(table, comp) __comp_table_add_record(table, comp_id(comp))
 
 
 /*
  * @brief Function to get the component record from the table
  * @param table = Pointer to the comp_table
- * @param name  = Name of the component to get
+ * @param id    = Id of the component to get
  * @return Returns pointer to comp_record if found else NULL is returned
  */
 
-CompRecord* __comp_table_get_record(CompTable* table, char* name);
-#define comp_table_get_record(table, comp) __comp_table_get_record(table, #comp)
+static inline CompRecord* __comp_table_get_record(CompTable* table, CompID id) {
+	return table->records[id];
+}
+#define comp_table_get_record(table, comp) __comp_table_get_record(table, comp_id(comp))
 
 
 /* =======================
@@ -229,19 +352,47 @@ CompRecord* __comp_table_get_record(CompTable* table, char* name);
  * ======================= */
 
 
+#define ECS_MAX_QUERY_CNT 32
+
+typedef struct ECS_Query ECS_Query;
+typedef struct ECS_Cmd_Buffer ECS_Cmd_Buffer;
+
+
 /*
  * @brief Structure that holds entire component in the system
  * @mem entity_cnt     = No of entity created
  * @mem max_entity_cnt = Max no of entity that can be created
  * @mem slots          = Slots for entity (EntitySlotState)
+ * @mem generations    = Current generation of every slot
+ * @mem free_list      = Stack of free slot indices
+ * @mem free_cnt       = No of indices in the free_list
  * @mem table          = Pointer to the comp_table
+ * @mem query_cnt      = No of queries created
+ * @mem queries        = Queries kept up to date on component add/remove
+ * @mem owned_mask     = Components whose record is owned by a query
+ * @mem cmd_buffers    = Command buffer of every thread, created on first use
+ * @mem cmd_sort       = Scratch used to sort the commands when flushing
+ * @mem cmd_sort_cap   = Capacity of `cmd_sort`
+ * @mem tick           = Change tick stamped on added and mutably accessed components
+ * @mem snapshot       = Snapshot the ecs was loaded from, slots and records point into it
  */
 
 typedef struct {
 	u32 entity_cnt;
 	u32 max_entity_cnt;
 	EntitySlotState* slots;
+	u16* generations;
+	u32* free_list;
+	u32  free_cnt;
 	CompTable* table;
+	u32 query_cnt;
+	ECS_Query* queries[ECS_MAX_QUERY_CNT];
+	u64 owned_mask;
+	ECS_Cmd_Buffer* cmd_buffers[THREAD_POOL_MAX_THREAD_CNT];
+	void** cmd_sort;
+	u32 cmd_sort_cap;
+	u32 tick;
+	File_Map snapshot;
 } ECS;
 
 
@@ -266,17 +417,22 @@ void ecs_delete(ECS* ecs);
  * @param ecs       = Pointer to ecs struct
  * @param component = Component to loop through
  * @param block     = Block of code to be executed
- * @info Makes variables (entity, entry, comp) visible to be used in block
+ * @info Makes variables (entity, comp, i) visible to be used in block, `i` is the packed index
+ * @info Every visited component is marked changed
+ * @info The block may delete `entity` or remove its component: the entry
+ *       swapped into the hole is visited next. Removing any other entity
+ *       inside the block is not safe.
  */
 
 #define ecs_for_each_comp(ecs, component, block)\
 	do {\
 		CompRecord* cr = comp_table_get_record(ecs->table, component);\
 		if (cr != NULL) {\
-			for (int i = 0; i < cr->entry_cnt; i++) {\
-				Entity entity = cr->entries_ent[i];\
-				CompEntry* entry = comp_record_get_entry(cr, entity);\
-				component* comp = entry->data;\
+			Entity __cur = ENTITY_INVALID;\
+			for (u32 i = 0; i < cr->entry_cnt; i += (cr->entries_ent[i] == __cur)) {\
+				Entity entity = __cur = cr->entries_ent[i];\
+				component* comp = &((component*) cr->data)[i];\
+				cr->changed_ticks[i] = ecs->tick;\
 				block;\
 			}\
 		}\
@@ -284,6 +440,314 @@ void ecs_delete(ECS* ecs);
 
 
 
+/* =======================
+ * Query
+ * ======================= */
+
+
+/*
+ * Query caches the entities that have every one of its components.
+ *
+ * The first query using a record owns it: matched entities are kept packed
+ * at the front, in the same order, of every record it owns, so a chunk of
+ * the query is a plain slice of each column. A query overlapping an owned
+ * record keeps its own list of matched entities instead and reaches the
+ * components through the sparse arrays.
+ *
+ * Both are updated when components are added or removed, so no matching is
+ * done while iterating. Adding/removing components or deleting entities
+ * while iterating a query is not safe.
+ */
+
+#define ECS_QUERY_MAX_COMP   8
+#define ECS_QUERY_CHUNK_SIZE 1024
+
+
+/*
+ * @brief Structure of a query
+ * @mem ecs      = Ecs the query belongs to
+ * @mem comp_cnt = No of components in the query
+ * @mem comps    = Ids of the components, in the order they were given
+ * @mem recs     = Record of every component
+ * @mem mask     = Bit set of the component ids
+ * @mem owning   = True if the query owns its records
+ * @mem len      = No of matched entities
+ * @mem ents     = Matched entities (only if not owning)
+ * @mem ents_cap = Capacity of `ents`
+ * @mem sparse   = Entity index to position in `ents` (only if not owning)
+ */
+
+struct ECS_Query {
+	ECS* ecs;
+	u32 comp_cnt;
+	CompID comps[ECS_QUERY_MAX_COMP];
+	CompRecord* recs[ECS_QUERY_MAX_COMP];
+	u64 mask;
+	b32 owning;
+	u32 len;
+	Entity* ents;
+	u32 ents_cap;
+	u32* sparse;
+};
+
+
+/*
+ * @brief Internal function to create a query, use `ecs_query_new`
+ * @param ecs      = Pointer to ecs
+ * @param comps    = Ids of the components
+ * @param comp_cnt = No of components
+ * @return Returns pointer to the query, same components give the same query
+ * @info Queries are deleted with the ecs
+ */
+
+ECS_Query* __ecs_query_new(ECS* ecs, CompID* comps, u32 comp_cnt);
+
+
+// Helpers to turn the component list into a list of ids
+#define __ECS_NARGS(...) __ECS_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1)
+#define __ECS_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define __ECS_IDS_1(c)      comp_id(c)
+#define __ECS_IDS_2(c, ...) comp_id(c), __ECS_IDS_1(__VA_ARGS__)
+#define __ECS_IDS_3(c, ...) comp_id(c), __ECS_IDS_2(__VA_ARGS__)
+#define __ECS_IDS_4(c, ...) comp_id(c), __ECS_IDS_3(__VA_ARGS__)
+#define __ECS_IDS_5(c, ...) comp_id(c), __ECS_IDS_4(__VA_ARGS__)
+#define __ECS_IDS_6(c, ...) comp_id(c), __ECS_IDS_5(__VA_ARGS__)
+#define __ECS_IDS_7(c, ...) comp_id(c), __ECS_IDS_6(__VA_ARGS__)
+#define __ECS_IDS_8(c, ...) comp_id(c), __ECS_IDS_7(__VA_ARGS__)
+#define __ECS_IDS_(n, ...)  __ECS_IDS_##n(__VA_ARGS__)
+#define __ECS_IDS(n, ...)   __ECS_IDS_(n, __VA_ARGS__)
+
+
+/*
+ * @brief Macro to create a query
+ * @param ecs = Pointer to ecs
+ * @param ... = Component structures, at most ECS_QUERY_MAX_COMP
+ */
+
+#define ecs_query_new(ecs, ...)                                             \
+	__ecs_query_new(                                                          \
+		ecs,                                                                    \
+		(CompID[]) { __ECS_IDS(__ECS_NARGS(__VA_ARGS__), __VA_ARGS__) },         \
+		__ECS_NARGS(__VA_ARGS__)                                                \
+	)                                                                         \
+
+
+/*
+ * @brief Function to make a bit set of component ids
+ * @param comps = Ids of the components
+ * @param cnt   = No of components
+ * @return Returns the bit set
+ */
+
+static inline u64 __ecs_mask(CompID* comps, u32 cnt) {
+	u64 mask = 0;
+	for (u32 i = 0; i < cnt; i++) mask |= 1ull << comps[i];
+	return mask;
+}
+#define ecs_mask(...) __ecs_mask((CompID[]) { __ECS_IDS(__ECS_NARGS(__VA_ARGS__), __VA_ARGS__) }, __ECS_NARGS(__VA_ARGS__))
+
+
+/*
+ * @brief Structure of a change filter over a query
+ * @mem query     = Query to be filtered
+ * @mem changed   = Components (ecs_mask) whose mutable access is looked for
+ * @mem added     = Components (ecs_mask) whose addition is looked for
+ * @mem last_tick = Ecs tick of the last iteration of the filter
+ * @info An entity passes if any component of `changed` was accessed mutably
+ *       or any component of `added` was added since the filter last ran.
+ *       Every consumer keeps its own filter, the first iteration passes
+ *       every entity.
+ */
+
+typedef struct {
+	ECS_Query* query;
+	u64 changed;
+	u64 added;
+	u32 last_tick;
+} ECS_Filter;
+
+
+/*
+ * @brief Function to make a filter
+ * @param query   = Pointer to the query
+ * @param changed = Components to look for changes (ecs_mask), 0 for none
+ * @param added   = Components to look for additions (ecs_mask), 0 for none
+ * @return Returns the filter
+ */
+
+static inline ECS_Filter ecs_filter_new(ECS_Query* query, u64 changed, u64 added) {
+	assert(((changed | added) & ~query->mask) == 0, "Filter components are not part of the query.\n");
+	return (ECS_Filter) { .query = query, .changed = changed, .added = added };
+}
+
+
+/*
+ * @brief Structure to walk a query chunk by chunk
+ * @mem query    = Query being iterated
+ * @mem filter   = Filter applied, NULL for none
+ * @mem since    = Tick the filter compares against
+ * @mem start    = Position of the first entity of the chunk in the query
+ * @mem cnt      = No of entities in the chunk
+ * @mem entities = Entities of the chunk
+ * @mem cols     = Column of every component for the chunk, NULL if not owned
+ * @info Chunks of a filtered iteration are runs of consecutive passing entities
+ */
+
+typedef struct {
+	ECS_Query* query;
+	ECS_Filter* filter;
+	u32 since;
+	u32 start;
+	u32 cnt;
+	Entity* entities;
+	void* cols[ECS_QUERY_MAX_COMP];
+} ECS_Query_Iter;
+
+
+/*
+ * @brief Function to start iterating a query
+ * @param query = Pointer to the query
+ * @return Returns the iterator, call `ecs_query_next` to get the first chunk
+ */
+
+static inline ECS_Query_Iter ecs_query_iter(ECS_Query* query) {
+	return (ECS_Query_Iter) { .query = query };
+}
+
+
+/*
+ * @brief Function to start iterating the entities passing a filter
+ * @param filter = Pointer to the filter
+ * @return Returns the iterator, call `ecs_query_next` to get the first chunk
+ * @info Marks the filter as run, changes made from here on show up next time.
+ *       Not thread safe, filters are iterated from one thread.
+ */
+
+ECS_Query_Iter ecs_filter_iter(ECS_Filter* filter);
+
+
+/*
+ * @brief Function to get an iterator positioned on a range of the query
+ * @param query = Pointer to the query
+ * @param start = Position of the first entity of the range
+ * @param cnt   = No of entities in the range
+ * @return Returns the iterator with the range as its current chunk
+ * @info Used to split a query between threads
+ */
+
+ECS_Query_Iter ecs_query_chunk(ECS_Query* query, u32 start, u32 cnt);
+
+
+/*
+ * @brief Function to move the iterator to the next chunk
+ * @param it = Pointer to the iterator
+ * @return Returns False when there is no chunk left
+ */
+
+b32 ecs_query_next(ECS_Query_Iter* it);
+
+
+/*
+ * @brief Function to get a component of a row in the current chunk without marking it changed
+ * @param it  = Pointer to the iterator
+ * @param k   = Position of the component in the query
+ * @param row = Row in the chunk
+ * @return Returns pointer to the component
+ */
+
+static inline const void* __ecs_iter_read(ECS_Query_Iter* it, u32 k, u32 row) {
+	if (it->cols[k])
+		return (u8*) it->cols[k] + (u64) row * it->query->recs[k]->comp_size;
+	return comp_record_get_entry(it->query->recs[k], it->entities[row]);
+}
+#define ecs_iter_read(it, comp, k, row) ((const comp*) __ecs_iter_read(it, k, row))
+
+
+/*
+ * @brief Function to get a component of a row in the current chunk and mark it changed
+ * @param it  = Pointer to the iterator
+ * @param k   = Position of the component in the query
+ * @param row = Row in the chunk
+ * @return Returns pointer to the component
+ */
+
+static inline void* __ecs_iter_get(ECS_Query_Iter* it, u32 k, u32 row) {
+	CompRecord* rec = it->query->recs[k];
+	u32 idx = it->cols[k] ? it->start + row : rec->sparse[entity_index(it->entities[row])];
+	rec->changed_ticks[idx] = it->query->ecs->tick;
+	return comp_record_at(rec, idx);
+}
+#define ecs_iter_get(it, comp, k, row) ((comp*) __ecs_iter_get(it, k, row))
+
+
+/*
+ * @brief Function to get the column of a component for the current chunk and mark it changed
+ * @param it = Pointer to the iterator
+ * @param k  = Position of the component in the query
+ * @return Returns pointer to the first component of the chunk, NULL if the query doesnt own it
+ */
+
+static inline void* __ecs_iter_column(ECS_Query_Iter* it, u32 k) {
+	if (!it->cols[k]) return NULL;
+
+	u32* ticks = it->query->recs[k]->changed_ticks + it->start;
+	u32 tick = it->query->ecs->tick;
+	for (u32 i = 0; i < it->cnt; i++) ticks[i] = tick;
+	return it->cols[k];
+}
+#define ecs_iter_column(it, comp, k) ((comp*) __ecs_iter_column(it, k))
+
+
+/*
+ * @brief Macro to get the column of a component for the current chunk without marking it changed
+ * @param it   = Pointer to the iterator
+ * @param comp = Component structure
+ * @param k    = Position of the component in the query
+ * @return Returns pointer to the first component of the chunk, NULL if the query doesnt own it
+ */
+
+#define ecs_iter_read_column(it, comp, k) ((const comp*) (it)->cols[k])
+
+
+/*
+ * @brief Macro to loop through each entity matched by a query
+ * @param query = Pointer to the query
+ * @param block = Block of code to be executed
+ * @info Makes variables (it, entity, i) visible to be used in block, `i` is
+ *       the row in the chunk, use `ecs_iter_get(&it, comp, k, i)` for components
+ */
+
+#define ecs_query_for_each(query, block)\
+	do {\
+		ECS_Query_Iter it = ecs_query_iter(query);\
+		while (ecs_query_next(&it)) {\
+			for (u32 i = 0; i < it.cnt; i++) {\
+				Entity entity = it.entities[i];\
+				block;\
+			}\
+		}\
+	} while (0)\
+
+
+/*
+ * @brief Macro to loop through each entity passing a filter
+ * @param filter = Pointer to the filter
+ * @param block  = Block of code to be executed
+ * @info Same variables as `ecs_query_for_each`
+ */
+
+#define ecs_filter_for_each(filter, block)\
+	do {\
+		ECS_Query_Iter it = ecs_filter_iter(filter);\
+		while (ecs_query_next(&it)) {\
+			for (u32 i = 0; i < it.cnt; i++) {\
+				Entity entity = it.entities[i];\
+				block;\
+			}\
+		}\
+	} while (0)\
+
+
 /* =======================
  * Entity Commands
  * ======================= */
@@ -293,11 +757,23 @@ void ecs_delete(ECS* ecs);
  * @brief Function to create new entity
  * @param ecs = Pointer to ecs
  * @return Returns a entity type which is a entity id
+ * @info Slots are reused in LIFO order from the free list, so ids are
+ *       deterministic and creation is O(1) however full the ecs is
  */
 
 Entity entity_new(ECS* ecs);
 
 
+/*
+ * @brief Function to create multiple entities at once
+ * @param ecs  = Pointer to ecs
+ * @param ents = Array to be filled with the new entities
+ * @param cnt  = No of entities to create
+ */
+
+void entity_new_n(ECS* ecs, Entity* ents, u32 cnt);
+
+
 /*
  * @brief Function to delete an entity
  * @param ecs = Pointer to the ecs
@@ -307,36 +783,75 @@ Entity entity_new(ECS* ecs);
 void entity_delete(ECS* ecs, Entity ent);
 
 
+/*
+ * @brief Function to delete multiple entities at once
+ * @param ecs  = Pointer to ecs
+ * @param ents = Entities to be deleted
+ * @param cnt  = No of entities in `ents`
+ */
+
+void entity_delete_n(ECS* ecs, Entity* ents, u32 cnt);
+
+
+/*
+ * @brief Function to check if an entity handle is still valid
+ * @param ecs = Pointer to ecs
+ * @param ent = entity id
+ * @return Returns True if the entity exists and the handle is not stale
+ */
+
+static inline b32 entity_alive(ECS* ecs, Entity ent) {
+	u32 idx = entity_index(ent);
+	return idx < ecs->max_entity_cnt
+		&& ecs->slots[idx] == OCCUPIED
+		&& ecs->generations[idx] == entity_generation(ent);
+}
+
+
 /*
  * @brief Internal function to add component to entity
  * @param ecs  = Pointer to ecs
  * @param ent  = entity id
- * @param name = Name of the component
+ * @param id   = Id of the component
  * @param data = Data of the component
+ * @return Returns pointer to the stored component
  */
 
-void* __entity_add_component(ECS* ecs, Entity ent, char* name, void* data);
+void* __entity_add_component(ECS* ecs, Entity ent, CompID id, void* data);
 
 
 /*
  * @brief Internal function to get the component from entity
  * @param ecs  = Pointer to ecs
  * @param ent  = entity id
- * @param name = Name of the component
+ * @param id   = Id of the component
  * @return Returns pointer to the component data
+ * @info The pointer is invalidated by adding or removing the same component on any entity
+ * @info The component is marked changed
  */
 
-void* __entity_get_component(ECS* ecs, Entity ent, char* name);
+void* __entity_get_component(ECS* ecs, Entity ent, CompID id);
+
+
+/*
+ * @brief Internal function to read the component of entity without marking it changed
+ * @param ecs  = Pointer to ecs
+ * @param ent  = entity id
+ * @param id   = Id of the component
+ * @return Returns pointer to the component data
+ */
+
+const void* __entity_read_component(ECS* ecs, Entity ent, CompID id);
 
 
 /*
  * @brief Internal function to remove component from entity
  * @param ecs  = Pointer to ecs
  * @param ent  = entity id
- * @param name = Name of the component
+ * @param id   = Id of the component
  */
 
-void __entity_remove_component(ECS* ecs, Entity ent, char* name);
+void __entity_remove_component(ECS* ecs, Entity ent, CompID id);
 
 
 /*
@@ -347,13 +862,11 @@ void __entity_remove_component(ECS* ecs, Entity ent, char* name);
  * @param ...  = Component parameters
  */
 
-#define entity_add_component(ecs, ent, comp, ...)   \
-	({                                                    \
-		comp c = __VA_ARGS__;                           \
-		comp* cp = alloc(sizeof(c));                    \
-		memcpy(cp, &c, sizeof(c));                          \
-		__entity_add_component(ecs, ent, #comp, cp);    \
-	})                                                    \
+#define entity_add_component(ecs, ent, comp, ...)        \
+	({                                                     \
+		comp c = __VA_ARGS__;                                \
+		(comp*) __entity_add_component(ecs, ent, comp_id(comp), &c);    \
+	})                                                     \
 
 
 /*
@@ -364,7 +877,18 @@ void __entity_remove_component(ECS* ecs, Entity ent, char* name);
  */
 
 #define entity_get_component(ecs, ent, comp)\
-	__entity_get_component(ecs, ent, #comp)
+	((comp*) __entity_get_component(ecs, ent, comp_id(comp)))
+
+
+/*
+ * @brief Macro to read a component without marking it changed
+ * @param ecs  = Pointer to ecs
+ * @param ent  = entity id
+ * @param comp = Component structure
+ */
+
+#define entity_read_component(ecs, ent, comp)\
+	((const comp*) __entity_read_component(ecs, ent, comp_id(comp)))
 
 
 /*
@@ -375,6 +899,339 @@ void __entity_remove_component(ECS* ecs, Entity ent, char* name);
  */
 
 #define entity_remove_component(ecs, ent, comp)\
-	__entity_remove_component(ecs, ent, #comp)
+	__entity_remove_component(ecs, ent, comp_id(comp))
+
+
+/* =======================
+ * Entity Command Buffers
+ * ======================= */
+
+
+/*
+ * Structural changes recorded to be applied later by `ecs_flush`.
+ *
+ * Every thread records into its own buffer (picked with
+ * thread_pool_thread_idx), so systems running on the pool can spawn and
+ * delete entities without locking. Buffers grow with libc realloc since
+ * alloc() is not thread safe. Components used from worker threads have to
+ * be registered beforehand (`ecs_register_component`).
+ *
+ * `ecs_flush` applies every buffer in one sorted pass: deletes of existing
+ * entities (so spawns reuse their slots while they are in cache), spawns,
+ * adds and removes grouped by component, then deletes of spawned entities.
+ * Adds and removes of one component keep the order a thread recorded them
+ * in, so the last one of an entity wins. Commands on entities that are
+ * dead by then are skipped, adding a component the entity already has
+ * overwrites it.
+ */
+
+
+/*
+ * @brief Structure of a recorded command, followed by `size` bytes of component data
+ */
+
+typedef enum {
+	ECS_CMD_ADD,
+	ECS_CMD_REMOVE,
+	ECS_CMD_DELETE
+} ECS_Cmd_Type;
+
+typedef struct {
+	ECS_Cmd_Type type;
+	CompID comp;
+	Entity ent;
+	u32 size;
+} ECS_Cmd;
+
+
+/*
+ * @brief Structure of a command buffer
+ * @mem data        = Recorded commands
+ * @mem len         = Bytes used in `data`
+ * @mem cap         = Capacity of `data`
+ * @mem spawn_cnt   = No of entities spawned
+ * @mem spawned     = Entities created for the spawns by the last flush
+ * @mem spawned_cap = Capacity of `spawned`
+ */
+
+struct ECS_Cmd_Buffer {
+	u8* data;
+	u64 len;
+	u64 cap;
+	u32 spawn_cnt;
+	Entity* spawned;
+	u32 spawned_cap;
+};
+
+
+/*
+ * @brief Function to get the command buffer of the calling thread
+ * @param ecs = Pointer to ecs
+ * @return Returns pointer to the command buffer
+ */
+
+ECS_Cmd_Buffer* ecs_cmd_buffer(ECS* ecs);
+
+
+/*
+ * @brief Function to record creating an entity
+ * @param ecs = Pointer to ecs
+ * @return Returns a placeholder entity, only valid in commands of the same thread until the flush
+ */
+
+Entity ecs_cmd_spawn(ECS* ecs);
+
+
+/*
+ * @brief Internal function to record adding a component
+ * @param ecs  = Pointer to ecs
+ * @param ent  = entity id or placeholder
+ * @param id   = Id of the component
+ * @param data = Component data, copied into the buffer
+ * @param size = Size of the component
+ */
+
+void __ecs_cmd_add(ECS* ecs, Entity ent, CompID id, void* data, u32 size);
+
+
+/*
+ * @brief Internal function to record removing a component
+ * @param ecs = Pointer to ecs
+ * @param ent = entity id or placeholder
+ * @param id  = Id of the component
+ */
+
+void __ecs_cmd_remove(ECS* ecs, Entity ent, CompID id);
+
+
+/*
+ * @brief Function to record deleting an entity
+ * @param ecs = Pointer to ecs
+ * @param ent = entity id or placeholder
+ */
+
+void ecs_cmd_delete(ECS* ecs, Entity ent);
+
+
+/*
+ * @brief Macro to record adding a component
+ * @param ecs  = Pointer to ecs
+ * @param ent  = entity id or placeholder
+ * @param comp = Component structure
+ * @param ...  = Component parameters
+ */
+
+#define ecs_cmd_add(ecs, ent, comp, ...)                               \
+	do {                                                                 \
+		comp c = __VA_ARGS__;                                              \
+		__ecs_cmd_add(ecs, ent, comp_id(comp), &c, sizeof(c));             \
+	} while (0)                                                          \
+
+
+/*
+ * @brief Macro to record removing a component
+ * @param ecs  = Pointer to ecs
+ * @param ent  = entity id or placeholder
+ * @param comp = Component structure
+ */
+
+#define ecs_cmd_remove(ecs, ent, comp)\
+	__ecs_cmd_remove(ecs, ent, comp_id(comp))
+
+
+/*
+ * @brief Function to apply every recorded command
+ * @param ecs = Pointer to ecs
+ * @info Must be called from a single thread while no system is running
+ */
+
+void ecs_flush(ECS* ecs);
+
+
+/* =======================
+ * World Snapshots
+ * ======================= */
+
+
+/*
+ * Binary image of an ecs, written in one pass and loaded by mapping the file.
+ *
+ * Layout, every section starts at a multiple of ECS_SNAPSHOT_ALIGN:
+ *	header | component table | slots | generations | free list |
+ *	per component: entities | components | added ticks | changed ticks | sparse |
+ *	blob
+ *
+ * Loading maps the file copy-on-write and points the entity slots and
+ * component records straight at it, nothing is parsed or copied. Pages are
+ * read when first touched and copied when first written. A record moves its
+ * packed arrays to the allocator the first time it has to grow.
+ *
+ * Components are matched by name, so they have to be registered before
+ * loading. Components holding pointers need a pair of hooks: `save` gets a
+ * copy of the component and replaces its pointers with refs to data pushed
+ * into the blob, `load` runs on the loaded component and turns the refs back
+ * into pointers. Queries and pending commands are not saved.
+ */
+
+#define ECS_SNAPSHOT_MAGIC    0x53534345 // "ECSS"
+#define ECS_SNAPSHOT_VERSION  1
+#define ECS_SNAPSHOT_ALIGN    64
+#define ECS_SNAPSHOT_NAME_LEN 64
+
+
+/*
+ * @brief Structure at the start of a snapshot file
+ * @mem magic           = ECS_SNAPSHOT_MAGIC
+ * @mem version         = ECS_SNAPSHOT_VERSION
+ * @mem max_entity_cnt  = Max no of entities of the saved ecs
+ * @mem entity_cnt      = No of alive entities
+ * @mem free_cnt        = No of indices in the free list
+ * @mem tick            = Change tick of the saved ecs
+ * @mem comp_cnt        = No of component records
+ * @mem slots_off       = Offset of the slot states
+ * @mem generations_off = Offset of the slot generations
+ * @mem free_list_off   = Offset of the free list
+ * @mem blob_off        = Offset of the data pushed by save hooks
+ * @mem blob_size       = Size of the blob in bytes
+ * @mem file_size       = Size of the whole file in bytes
+ */
+
+typedef struct {
+	u32 magic;
+	u32 version;
+	u32 max_entity_cnt;
+	u32 entity_cnt;
+	u32 free_cnt;
+	u32 tick;
+	u32 comp_cnt;
+	u32 pad;
+	u64 slots_off;
+	u64 generations_off;
+	u64 free_list_off;
+	u64 blob_off;
+	u64 blob_size;
+	u64 file_size;
+} ECS_Snapshot_Header;
+
+
+/*
+ * @brief Structure describing a component record in a snapshot
+ * @mem name        = Name the component was registered with
+ * @mem comp_size   = Size of a single component in bytes
+ * @mem entry_cnt   = No of entries
+ * @mem hooked      = True if the components went through a save hook
+ * @mem entries_off = Offset of the packed entities
+ * @mem data_off    = Offset of the packed components
+ * @mem added_off   = Offset of the packed added ticks
+ * @mem changed_off = Offset of the packed changed ticks
+ * @mem sparse_off  = Offset of the sparse array
+ */
+
+typedef struct {
+	char name[ECS_SNAPSHOT_NAME_LEN];
+	u32 comp_size;
+	u32 entry_cnt;
+	u32 hooked;
+	u32 pad;
+	u64 entries_off;
+	u64 data_off;
+	u64 added_off;
+	u64 changed_off;
+	u64 sparse_off;
+} ECS_Snapshot_Comp;
+
+
+/*
+ * @brief Structure collecting the data pushed by save hooks
+ * @mem data = Bytes pushed so far
+ * @mem len  = No of bytes used
+ * @mem cap  = Capacity of `data`
+ */
+
+typedef struct {
+	u8* data;
+	u64 len;
+	u64 cap;
+} ECS_Blob;
+
+
+/*
+ * @brief Function to push data into the blob
+ * @param blob = Pointer to the blob
+ * @param data = Data to be copied
+ * @param size = Size of the data in bytes
+ * @return Returns the ref of the data, never 0 so NULL pointers can stay NULL
+ * @info Data is 8 byte aligned, pushes of multiples of 8 bytes are contiguous
+ */
+
+u64 ecs_blob_push(ECS_Blob* blob, const void* data, u64 size);
+
+
+/*
+ * @brief Function to resolve a ref while loading
+ * @param blob = Blob given to the load hook
+ * @param ref  = Ref returned by ecs_blob_push
+ * @return Returns pointer to the data
+ */
+
+static inline const void* ecs_blob_get(const u8* blob, u64 ref) {
+	return blob + ref - 1;
+}
+
+
+/*
+ * @brief Hooks for components holding pointers
+ * @param comp = Copy of the component being saved, or the loaded component
+ * @param blob = Blob to push pointed data into, or the loaded blob
+ */
+
+typedef void (*ECS_Save_Fn)(void* comp, ECS_Blob* blob);
+typedef void (*ECS_Load_Fn)(void* comp, const u8* blob);
+
+
+/*
+ * @brief Function to set the snapshot hooks of a component
+ * @param id   = Id of the component
+ * @param save = Called on a copy of every component when saving
+ * @param load = Called on every component after loading
+ * @info Hooks are global like the component registry
+ */
+
+void __ecs_snapshot_hook(CompID id, ECS_Save_Fn save, ECS_Load_Fn load);
+
+
+/*
+ * @brief Macro to set the snapshot hooks of a component
+ * @param comp = Component structure
+ * @param save = Save hook
+ * @param load = Load hook
+ */
+
+#define ecs_snapshot_hook(comp, save, load)\
+	__ecs_snapshot_hook(comp_id(comp), save, load)
+
+
+RESULT(ECS, ECS*);
+
+
+/*
+ * @brief Function to write the ecs into a snapshot file
+ * @param ecs  = Pointer to ecs
+ * @param path = Path of the file
+ * @return Returns the no of bytes written
+ * @info Recorded commands have to be flushed first
+ */
+
+Result_u64 ecs_snapshot_save(ECS* ecs, const char* path);
+
+
+/*
+ * @brief Function to create an ecs from a snapshot file
+ * @param path = Path of the file
+ * @return Returns pointer to the ecs, delete it with ecs_delete
+ * @info The file is mapped until the ecs is deleted
+ */
+
+Result_ECS ecs_snapshot_load(const char* path);
 
 #endif // __ECS_H__
@@ -0,0 +1,98 @@
+#include "system.h"
+
+ECS_Scheduler* ecs_scheduler_new(ECS* ecs, u32 thread_cnt) {
+	if (thread_cnt == 0) thread_cnt = thread_pool_cpu_cnt();
+	if (thread_cnt > THREAD_POOL_MAX_THREAD_CNT) thread_cnt = THREAD_POOL_MAX_THREAD_CNT;
+
+	ECS_Scheduler* sched = alloc(sizeof(ECS_Scheduler));
+	sched->ecs = ecs;
+
+	// The thread calling ecs_scheduler_run works too
+	sched->pool = thread_pool_new(thread_cnt - 1);
+	return sched;
+}
+
+void ecs_scheduler_delete(ECS_Scheduler* sched) {
+	thread_pool_delete(sched->pool);
+	clean(sched->tasks);
+	clean(sched);
+}
+
+void ecs_system_add(ECS_Scheduler* sched, ECS_System system) {
+	assert(sched->system_cnt < ECS_MAX_SYSTEM_CNT, "System limit reached. Cant add system `%s`.\n", system.name);
+	assert(system.fn, "System `%s` has no callback.\n", system.name);
+
+	// Iterating a query reads its components
+	if (system.query) {
+		system.reads |= system.query->mask & ~system.writes;
+	}
+	sched->systems[sched->system_cnt++] = system;
+}
+
+static b32 systems_conflict(ECS_System* a, ECS_System* b) {
+	return (a->writes & (b->reads | b->writes)) || (b->writes & a->reads);
+}
+
+static void scheduler_run_task(void* arg, u32 task) {
+	ECS_Scheduler* sched = arg;
+	ECS_Task t = sched->tasks[task];
+	ECS_System* sys = &sched->systems[t.system];
+
+	if (sys->query == NULL) {
+		sys->fn(sched->ecs, NULL, sys->user);
+	} else if (t.cnt == ECS_TASK_WHOLE) {
+		ECS_Query_Iter it = ecs_query_iter(sys->query);
+		while (ecs_query_next(&it)) {
+			sys->fn(sched->ecs, &it, sys->user);
+		}
+	} else {
+		ECS_Query_Iter it = ecs_query_chunk(sys->query, t.start, t.cnt);
+		sys->fn(sched->ecs, &it, sys->user);
+	}
+}
+
+static void scheduler_push_task(ECS_Scheduler* sched, u32* task_cnt, ECS_Task task) {
+	if (*task_cnt == sched->task_cap) {
+		sched->task_cap = sched->task_cap ? sched->task_cap * 2 : 64;
+		sched->tasks = alloc_resize(sched->tasks, sizeof(ECS_Task) * sched->task_cap);
+	}
+	sched->tasks[(*task_cnt)++] = task;
+}
+
+void ecs_scheduler_run(ECS_Scheduler* sched) {
+	// Putting every system after the last earlier system it conflicts with
+	sched->wave_cnt = 0;
+	for (u32 i = 0; i < sched->system_cnt; i++) {
+		u32 wave = 0;
+		for (u32 j = 0; j < i; j++) {
+			if (sched->waves[j] >= wave && systems_conflict(&sched->systems[i], &sched->systems[j]))
+				wave = sched->waves[j] + 1;
+		}
+		sched->waves[i] = wave;
+		if (wave + 1 > sched->wave_cnt) sched->wave_cnt = wave + 1;
+	}
+
+	for (u32 wave = 0; wave < sched->wave_cnt; wave++) {
+		u32 task_cnt = 0;
+		for (u32 i = 0; i < sched->system_cnt; i++) {
+			if (sched->waves[i] != wave) continue;
+
+			ECS_System* sys = &sched->systems[i];
+			if (sys->query == NULL || !sys->parallel) {
+				scheduler_push_task(sched, &task_cnt, (ECS_Task) { i, 0, ECS_TASK_WHOLE });
+				continue;
+			}
+
+			for (u32 start = 0; start < sys->query->len; start += ECS_QUERY_CHUNK_SIZE) {
+				u32 left = sys->query->len - start;
+				u32 cnt = left < ECS_QUERY_CHUNK_SIZE ? left : ECS_QUERY_CHUNK_SIZE;
+				scheduler_push_task(sched, &task_cnt, (ECS_Task) { i, start, cnt });
+			}
+		}
+
+		thread_pool_run(sched->pool, scheduler_run_task, sched, task_cnt);
+	}
+
+	// Applying the structural changes recorded by the systems
+	ecs_flush(sched->ecs);
+}
@@ -0,0 +1,133 @@
+#ifndef __SYSTEM_H__
+#define __SYSTEM_H__
+
+#include "ecs/ecs.h"
+#include "core/thread_pool.h"
+
+/*
+ * Systems and scheduler
+ *
+ * Every system declares the components it reads and writes. Each run the
+ * scheduler puts a system in the wave after the last earlier system it
+ * conflicts with (one writes what the other reads or writes). Systems of a
+ * wave run together on the thread pool, and parallel systems are split into
+ * query chunks so a single large system uses every thread too.
+ *
+ * Systems must not add/remove components or create/delete entities
+ * directly, they record them with the ecs_cmd_* functions and the changes
+ * are applied once every system is done. Systems must not use
+ * alloc()/clean() or the frame arena.
+ */
+
+#define ECS_MAX_SYSTEM_CNT 64
+
+
+/*
+ * @brief System callback
+ * @param ecs  = Pointer to ecs
+ * @param it   = Chunk of the system query, NULL if the system has no query
+ * @param user = User data given with the system
+ */
+
+typedef void (*ECS_System_Fn)(ECS* ecs, ECS_Query_Iter* it, void* user);
+
+
+/*
+ * @brief Structure describing a system
+ * @mem name     = Name of the system
+ * @mem fn       = Callback called for every chunk of the query
+ * @mem user     = User data passed to the callback
+ * @mem query    = Query to be iterated, NULL to call `fn` once per run
+ * @mem reads    = Components read (ecs_mask), query components are added to it
+ * @mem writes   = Components written (ecs_mask)
+ * @mem parallel = True if chunks can run on different threads at once
+ */
+
+typedef struct {
+	char* name;
+	ECS_System_Fn fn;
+	void* user;
+	ECS_Query* query;
+	u64 reads;
+	u64 writes;
+	b32 parallel;
+} ECS_System;
+
+
+/*
+ * @brief Structure of a unit of work handed to the thread pool
+ * @mem system = Index of the system
+ * @mem start  = Position of the first entity in the query
+ * @mem cnt    = No of entities, ECS_TASK_WHOLE to run the entire system
+ */
+
+typedef struct {
+	u32 system;
+	u32 start;
+	u32 cnt;
+} ECS_Task;
+
+#define ECS_TASK_WHOLE 0xffffffff
+
+
+/*
+ * @brief Structure holding the systems and the threads running them
+ * @mem ecs        = Pointer to ecs
+ * @mem pool       = Thread pool
+ * @mem system_cnt = No of systems
+ * @mem systems    = Systems in the order they were added
+ * @mem waves      = Wave of every system in the last run
+ * @mem wave_cnt   = No of waves in the last run
+ * @mem tasks      = Task list of the wave being run
+ * @mem task_cap   = Capacity of `tasks`
+ */
+
+typedef struct {
+	ECS* ecs;
+	Thread_Pool* pool;
+	u32 system_cnt;
+	ECS_System systems[ECS_MAX_SYSTEM_CNT];
+	u32 waves[ECS_MAX_SYSTEM_CNT];
+	u32 wave_cnt;
+	ECS_Task* tasks;
+	u32 task_cap;
+} ECS_Scheduler;
+
+
+/*
+ * @brief Function to create a scheduler
+ * @param ecs        = Pointer to ecs
+ * @param thread_cnt = No of threads running systems including the caller, 0 to use every cpu
+ * @return Returns pointer to the scheduler
+ */
+
+ECS_Scheduler* ecs_scheduler_new(ECS* ecs, u32 thread_cnt);
+
+
+/*
+ * @brief Function to delete a scheduler
+ * @param sched = Pointer to the scheduler
+ */
+
+void ecs_scheduler_delete(ECS_Scheduler* sched);
+
+
+/*
+ * @brief Function to add a system
+ * @param sched  = Pointer to the scheduler
+ * @param system = Description of the system
+ * @info Conflicting systems run in the order they were added
+ */
+
+void ecs_system_add(ECS_Scheduler* sched, ECS_System system);
+
+
+/*
+ * @brief Function to run every system once
+ * @param sched = Pointer to the scheduler
+ * @info Returns once every system is done and their commands are flushed
+ */
+
+void ecs_scheduler_run(ECS_Scheduler* sched);
+
+#endif // __SYSTEM_H__
@@ -3,6 +3,46 @@
 
 extern Context* ctx;
 
+void event_queue_init(Event_Queue* queue) {
+	queue->head = 0;
+	queue->tail = 0;
+	queue->dropped = 0;
+	queue->coalesce_motion = true;
+}
+
+u32 event_queue_len(Event_Queue* queue) {
+	return queue->tail - queue->head;
+}
+
+void event_queue_push(Event_Queue* queue, Event event) {
+	u32 len = event_queue_len(queue);
+
+	if (queue->coalesce_motion && event.type == MOUSE_MOTION && len) {
+		Event* last = &queue->events[(queue->tail - 1) & (EVENT_QUEUE_CAP - 1)];
+		if (last->type == MOUSE_MOTION) {
+			last->e.mouse_pos = event.e.mouse_pos;
+			return;
+		}
+	}
+
+	// Dropping the newest event keeps the already queued ones in order
+	if (len == EVENT_QUEUE_CAP) {
+		queue->dropped++;
+		return;
+	}
+
+	queue->events[queue->tail & (EVENT_QUEUE_CAP - 1)] = event;
+	queue->tail++;
+}
+
+b32 event_queue_pop(Event_Queue* queue, Event* event) {
+	if (queue->head == queue->tail) return false;
+
+	*event = queue->events[queue->head & (EVENT_QUEUE_CAP - 1)];
+	queue->head++;
+	return true;
+}
+
 void key_callback(GLFWwindow* window, i32 key, i32 scancode, i32 action, i32 mods) {
 	Event event = { 0 };
 	event.e.key = key;
@@ -16,7 +56,7 @@ void key_callback(GLFWwindow* window, i32 key, i32 scancode, i32 action, i32 mod
 			break;
 	}
 
-	dyn_array_append(ctx->events, event);
+	event_queue_push(&ctx->events, event);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -44,25 +84,28 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 			assert(0, "Unhandled mouse action: %d\n", action);
 	}
 
-	dyn_array_append(ctx->events, event);
+	event_queue_push(&ctx->events, event);
 }
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
 	Event event = { 0 };
 	event.e.mouse_pos = (v2) { xpos, ypos };
 	event.type = MOUSE_MOTION;
-	dyn_array_append(ctx->events, event);
+	event_queue_push(&ctx->events, event);
+}
+
+void event_register_callbacks(GLFWwindow* glfw_window) {
+	glfwSetKeyCallback(glfw_window, key_callback);
+	glfwSetMouseButtonCallback(glfw_window, mouse_button_callback);
+	glfwSetCursorPosCallback(glfw_window, cursor_position_callback);
+}
+
+void event_set_motion_coalescing(b32 enable) {
+	ctx->events.coalesce_motion = enable;
 }
 
 i32 event_poll(Window window, Event* event) {
-	glfwSetKeyCallback(window.glfw_window, key_callback);
-	glfwSetMouseButtonCallback(window.glfw_window, mouse_button_callback);
-	glfwSetCursorPosCallback(window.glfw_window, cursor_position_callback);
-
-	i32 len = dyn_array_len(ctx->events);
-	if (len)
-		*event = dyn_array_pop(ctx->events, 0);
-	return len;
+	return event_queue_pop(&ctx->events, event);
 }
 
 v2 event_mouse_pos(Window window) {
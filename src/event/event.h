@@ -32,6 +32,31 @@ typedef struct {
 	} e;
 } Event;
 
+/*
+ * Fixed size FIFO of pending events. `head` and `tail` are free running
+ * counters masked into the buffer, so the capacity has to be a power of two.
+ * With `coalesce_motion` set, a MOUSE_MOTION pushed right after another
+ * pending MOUSE_MOTION replaces it instead of taking a new slot.
+ */
+
+#define EVENT_QUEUE_CAP 1024
+
+typedef struct {
+	Event events[EVENT_QUEUE_CAP];
+	u32 head, tail;
+	u32 dropped;
+	b32 coalesce_motion;
+} Event_Queue;
+
+STATIC_ASSERT((EVENT_QUEUE_CAP & (EVENT_QUEUE_CAP - 1)) == 0, "Event queue capacity must be a power of two.");
+
+void event_queue_init(Event_Queue* queue);
+void event_queue_push(Event_Queue* queue, Event event);
+b32 event_queue_pop(Event_Queue* queue, Event* event);
+u32 event_queue_len(Event_Queue* queue);
+
+void event_register_callbacks(GLFWwindow* glfw_window);
+void event_set_motion_coalescing(b32 enable);
 i32 event_poll(Window window, Event* event);
 v2 event_mouse_pos(Window window);
 void event_set_mouse_pos(Window window, v2 pos);
@@ -37,7 +37,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(bg_1);
 
 	Texture bg_2 = unwrap(
 		texture_from_file(
@@ -45,7 +44,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(bg_2);
 
 	Texture bg_3 = unwrap(
 		texture_from_file(
@@ -53,7 +51,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(bg_3);
 
 	// Ground
 	Texture ground = unwrap(
@@ -62,7 +59,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(ground);
 
 	// Fence
 	Texture fence = unwrap(
@@ -71,7 +67,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(fence);
 
 	// Shop
 	Texture shop = unwrap(
@@ -80,7 +75,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(shop);
 
 	// Grass
 	Texture grass_1 = unwrap(
@@ -89,7 +83,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(grass_1);
 
 	Texture grass_2 = unwrap(
 		texture_from_file(
@@ -97,7 +90,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(grass_2);
 
 	Texture grass_3 = unwrap(
 		texture_from_file(
@@ -105,7 +97,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(grass_3);
 
 	// Lamp
 	Texture lamp = unwrap(
@@ -114,7 +105,6 @@ int main() {
 			true
 		)
 	);
-	texture_bind(lamp);
 
 	// Rock
 	Texture rock_3 = unwrap(
@@ -123,13 +113,11 @@ int main() {
 			true
 		)
 	);
-	texture_bind(rock_3);
 
 	// Player
 	Texture pl_tex = unwrap(
 		texture_from_file("assets/oak_woods/character/char_blue.png", true)
 	);
-	texture_bind(pl_tex);
 
 	v3 pl_pos = { 0, 0, 0 };
 
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include "window/window.h"
 #include "graphics/imr.h"
+#include "graphics/draw_list.h"
 #include "graphics/texture.h"
 #include "camera/camera.h"
 #include "event/event.h"
@@ -51,6 +52,7 @@ Polygon pol_map[ROW][COL];
 int main(int argc, char** argv) {
 	Window window = unwrap(window_new("Isometric", WIN_WIDTH, WIN_HEIGHT));
 	IMR imr = unwrap(imr_new());
+	Draw_List* draw_list = draw_list_new();
 	OCamera cam = ocamera_new(
 		(v2) { 0, 0 },
 		3.0f,
@@ -58,7 +60,6 @@ int main(int argc, char** argv) {
 	);
 
 	Texture tex = unwrap(texture_from_file("assets/sprites.png", false));
-	texture_bind(tex);
 
 	TileConfig tconf = {
 		.width = 32, .height = 32,
@@ -94,25 +95,23 @@ int main(int argc, char** argv) {
 		}
 
 		m4 mvp = ocamera_calc_mvp(&cam);
-		imr_update_mvp(&imr, mvp);
 
+		imr_reset_stats(&imr);
 		imr_clear((v4) { 0, 0, 0, 1 });
-		imr_begin(&imr);
 
 		// Tile rendering
 		for (i32 y = 0; y < ROW; y++) {
 			for (i32 x = 0; x < COL; x++) {
 				i32 px = (x - y) * (tconf.width / 2);
 				i32 py = (x + y) * (tconf.height / 2 - tconf.y_offset);
-				imr_push_quad_tex(
-					&imr,
-					(v3) { px, py, 0 },
-					(v2) { tconf.width , tconf.height },
-					(Rect) { map[y][x] / 3.0f, 0, 1.0f / 3.0f, 1 },
-					tex.id,
-					rotate_z(0),
-					(v4) { 1, 1, 1, 1 }
-				);
+				draw_list_push_quad(draw_list, (Draw_State) { .layer = 0 }, &(Quad_Desc) {
+					.pos = (v3) { px, py, 0 },
+					.size = (v2) { tconf.width , tconf.height },
+					.tex_rect = (Rect) { map[y][x] / 3.0f, 0, 1.0f / 3.0f, 1 },
+					.tex_id = tex.id,
+					.rot = rotate_z(0),
+					.color = (v4) { 1, 1, 1, 1 }
+				});
 
 				pol_map[y][x] = (Polygon) {
 					(v2) { px + tconf.width / 2, py + tconf.y_offset },
@@ -142,24 +141,26 @@ int main(int argc, char** argv) {
 				if (A1 + A2 + A3 + A4 == A) {
 					i32 px = (x - y) * (tconf.width / 2);
 					i32 py = (x + y) * (tconf.height / 2 - tconf.y_offset);
-					imr_push_quad_tex(
-						&imr,
-						(v3) { px, py, 0 },
-						(v2) { tconf.width , tconf.height },
-						(Rect) { map[y][x] / 3.0f, 0, 1.0f / 3.0f, 1 },
-						tex.id,
-						rotate_z(0),
-						(v4) { 1, 0, 0, 0.5 }
-					);
+					// Highlight goes on top of every tile
+					draw_list_push_quad(draw_list, (Draw_State) { .layer = 1 }, &(Quad_Desc) {
+						.pos = (v3) { px, py, 0 },
+						.size = (v2) { tconf.width , tconf.height },
+						.tex_rect = (Rect) { map[y][x] / 3.0f, 0, 1.0f / 3.0f, 1 },
+						.tex_id = tex.id,
+						.rot = rotate_z(0),
+						.color = (v4) { 1, 0, 0, 0.5 }
+					});
 				}
 			}
 		}
 
-		imr_end(&imr);
+		draw_list_flush(draw_list, &imr, mvp);
 		window_update(&window);
 	}
 
+	imr_print_stats(&imr);
 	texture_delete(tex);
+	draw_list_delete(draw_list);
 	imr_delete(&imr);
 	window_delete(window);
 	return 0;
@@ -15,6 +15,7 @@
 
 #define SHADER_SRC(...)\
 	"#version 440 core\n"\
+	IMR_GLSL_DEFINES\
 	"#define PI 3.1415926538\n"\
 	"#define TOTAL_LIGHTS 4\n"\
 	#__VA_ARGS__\
@@ -23,7 +24,7 @@ const char* vertex_src = SHADER_SRC(
 	layout (location = 0) in vec3 position;
 	layout (location = 1) in vec4 color;
 	layout (location = 2) in vec2 tex_coord;
-	layout (location = 3) in float tex_id;
+	layout (location = 3) in IMR_TEX_ID tex_id;
 
 	uniform mat4 mvp;
 
@@ -35,7 +36,7 @@ const char* vertex_src = SHADER_SRC(
 	void main() {
 		o_color = color;
 		o_tex_coord = tex_coord;
-		o_tex_id = tex_id;
+		o_tex_id = float(tex_id);
 		o_mvp = mvp;
 		gl_Position = mvp * vec4(position, 1.0f);
 	}
@@ -120,7 +121,7 @@ const char* light_vertex_src = SHADER_SRC(
 	layout (location = 0) in vec3 position;
 	layout (location = 1) in vec4 color;
 	layout (location = 2) in vec2 tex_coord;
-	layout (location = 3) in float tex_id;
+	layout (location = 3) in IMR_TEX_ID tex_id;
 
 	uniform mat4 mvp;
 
@@ -132,7 +133,7 @@ const char* light_vertex_src = SHADER_SRC(
 	void main() {
 		o_color = color;
 		o_tex_coord = tex_coord;
-		o_tex_id = tex_id;
+		o_tex_id = float(tex_id);
 		o_mvp = mvp;
 		gl_Position = vec4(position, 1.0f);
 	}
@@ -397,43 +398,43 @@ int main(int argc, char** argv) {
 			m4 mvp = ocamera_calc_mvp(&cam);
 			imr_update_mvp(&imr, mvp);
 
-			int loc = GLCall(glGetUniformLocation(color_shader, "dim"));
-			assert(loc != -1, "Cannot find uniform: dim\n");
-			GLCall(glUniform2f(loc, SURF_WIDTH, SURF_HEIGHT));
+			i32 uniform = shader_uniform(&color_shader, "dim");
+			assert(uniform != -1, "Cannot find uniform: dim\n");
+			shader_set_v2(&color_shader, uniform, (v2) { SURF_WIDTH, SURF_HEIGHT });
 
 			for (int i = 0; i < TOTAL_LIGHTS; i++) {
 				char* uni_name = "light[%d].%s";
 				char buff[100];
 
 				sprintf(buff, uni_name, i, "pos");
-				loc = GLCall(glGetUniformLocation(color_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform2f(loc, lights[i].pos.x, lights[i].pos.y));
+				uniform = shader_uniform(&color_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_v2(&color_shader, uniform, lights[i].pos);
 
 				sprintf(buff, uni_name, i, "radius");
-				loc = GLCall(glGetUniformLocation(color_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform1f(loc, lights[i].radius));
+				uniform = shader_uniform(&color_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&color_shader, uniform, lights[i].radius);
 
 				sprintf(buff, uni_name, i, "intensity");
-				loc = GLCall(glGetUniformLocation(color_shader, buff));
-				assert(loc != -1, "Cannot find uniform: light.intensity\n");
-				GLCall(glUniform1f(loc, lights[i].intensity));
+				uniform = shader_uniform(&color_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&color_shader, uniform, lights[i].intensity);
 
 				sprintf(buff, uni_name, i, "dir");
-				loc = GLCall(glGetUniformLocation(color_shader, buff));
-				assert(loc != -1, "Cannot find uniform: light.dir\n");
-				GLCall(glUniform1f(loc, lights[i].dir));
+				uniform = shader_uniform(&color_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&color_shader, uniform, lights[i].dir);
 
 				sprintf(buff, uni_name, i, "fov");
-				loc = GLCall(glGetUniformLocation(color_shader, buff));
-				assert(loc != -1, "Cannot find uniform: light.fov\n");
-				GLCall(glUniform1f(loc, lights[i].fov));
+				uniform = shader_uniform(&color_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&color_shader, uniform, lights[i].fov);
 
 				sprintf(buff, uni_name, i, "color");
-				loc = GLCall(glGetUniformLocation(color_shader, buff));
-				assert(loc != -1, "Cannot find uniform: light.color\n");
-				GLCall(glUniform4f(loc, lights[i].color.r, lights[i].color.g, lights[i].color.b, lights[i].color.a));
+				uniform = shader_uniform(&color_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_v4(&color_shader, uniform, lights[i].color);
 			}
 
 			v2 size = { 20, 20 };
@@ -466,45 +467,43 @@ int main(int argc, char** argv) {
 
 			m4 mvp = ocamera_calc_mvp(&cam);
 			imr_update_mvp(&imr, mvp);
-
-			int loc;
-			loc = GLCall(glGetUniformLocation(light_shader, "dim"));
-			assert(loc != -1, "Cannot find uniform: dim\n");
-			GLCall(glUniform2f(loc, SURF_WIDTH, SURF_HEIGHT));
+			i32 uniform = shader_uniform(&light_shader, "dim");
+			assert(uniform != -1, "Cannot find uniform: dim\n");
+			shader_set_v2(&light_shader, uniform, (v2) { SURF_WIDTH, SURF_HEIGHT });
 
 			for (int i = 0; i < TOTAL_LIGHTS; i++) {
 				char* uni_name = "light[%d].%s";
 				char buff[100];
 
 				sprintf(buff, uni_name, i, "pos");
-				loc = GLCall(glGetUniformLocation(light_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform2f(loc, lights[i].pos.x, lights[i].pos.y));
+				uniform = shader_uniform(&light_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_v2(&light_shader, uniform, lights[i].pos);
 
 				sprintf(buff, uni_name, i, "radius");
-				loc = GLCall(glGetUniformLocation(light_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform1f(loc, lights[i].radius));
+				uniform = shader_uniform(&light_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&light_shader, uniform, lights[i].radius);
 
 				sprintf(buff, uni_name, i, "intensity");
-				loc = GLCall(glGetUniformLocation(light_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform1f(loc, lights[i].intensity));
+				uniform = shader_uniform(&light_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&light_shader, uniform, lights[i].intensity);
 
 				sprintf(buff, uni_name, i, "dir");
-				loc = GLCall(glGetUniformLocation(light_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform1f(loc, lights[i].dir));
+				uniform = shader_uniform(&light_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&light_shader, uniform, lights[i].dir);
 
 				sprintf(buff, uni_name, i, "fov");
-				loc = GLCall(glGetUniformLocation(light_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform1f(loc, lights[i].fov));
+				uniform = shader_uniform(&light_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_f32(&light_shader, uniform, lights[i].fov);
 
 				sprintf(buff, uni_name, i, "color");
-				loc = GLCall(glGetUniformLocation(light_shader, buff));
-				assert(loc != -1, "Cannot find uniform: %s\n", buff);
-				GLCall(glUniform4f(loc, lights[i].color.r, lights[i].color.g, lights[i].color.b, lights[i].color.a));
+				uniform = shader_uniform(&light_shader, buff);
+				assert(uniform != -1, "Cannot find uniform: %s\n", buff);
+				shader_set_v4(&light_shader, uniform, lights[i].color);
 			}
 
 			imr_push_quad(
@@ -527,23 +526,23 @@ int main(int argc, char** argv) {
 			glViewport(0, 0, SURF_WIDTH, SURF_HEIGHT);
 			glBindFramebuffer(GL_FRAMEBUFFER, mix_fbo.fbo);
 
-			GLCall(glBindTextureUnit(colo_fbo.color_texture, colo_fbo.color_texture));
-			GLCall(glBindTextureUnit(light_fbo.color_texture, light_fbo.color_texture));
-
 			imr_clear((v4) { 0, 0, 0, 1 });
 
 			imr_begin(&imr);
 
+			u32 color_unit = imr_texture_slot(&imr, (Texture) { .id = colo_fbo.color_texture });
+			u32 light_unit = imr_texture_slot(&imr, (Texture) { .id = light_fbo.color_texture });
+
 			// m4 mvp = ocamera_calc_mvp(&cam);
 			// imr_update_mvp(&imr, mvp);
 
-			int loc = GLCall(glGetUniformLocation(mix_shader, "color_texture"));
-			assert(loc != -1, "Cannot find uniform: color_texture\n");
-			GLCall(glUniform1i(loc, colo_fbo.color_texture));
+			i32 uniform = shader_uniform(&mix_shader, "color_texture");
+			assert(uniform != -1, "Cannot find uniform: color_texture\n");
+			shader_set_i32(&mix_shader, uniform, color_unit);
 
-			loc = GLCall(glGetUniformLocation(mix_shader, "light_texture"));
-			assert(loc != -1, "Cannot find uniform: light_texture\n");
-			GLCall(glUniform1i(loc, light_fbo.color_texture));
+			uniform = shader_uniform(&mix_shader, "light_texture");
+			assert(uniform != -1, "Cannot find uniform: light_texture\n");
+			shader_set_i32(&mix_shader, uniform, light_unit);
 
 			imr_push_quad(
 				&imr,
@@ -565,7 +564,6 @@ int main(int argc, char** argv) {
 			imr_switch_shader_to_default(&imr);
 
 			glViewport(0, 0, WIN_WIDTH, WIN_HEIGHT);
-			GLCall(glBindTextureUnit(texture_to_render, texture_to_render));
 
 			imr_clear((v4) { 0, 0, 0, 1 });
 			
@@ -34,3 +34,53 @@ Rect ac_get_frame(AnimationComponent* ac) {
 		return dyn_array_get(entry.frames, idx);
 	});
 }
+
+// Dyn arrays are saved as their length followed by the elements
+static u64 dyn_save(ECS_Blob* blob, i32 len, void* data, u64 elem_size) {
+	u64 ref = ecs_blob_push(blob, &(u64) { len }, sizeof(u64));
+	ecs_blob_push(blob, data, elem_size * len);
+	return ref;
+}
+
+void ac_snapshot_save(void* comp, ECS_Blob* blob) {
+	AnimationComponent* ac = comp;
+	if (ac->entries == NULL) return;
+
+	// Frames go first so the saved entries can refer to them
+	i32 len = ac->entries->len;
+	AnimationEntry* entries = alloc(sizeof(AnimationEntry) * (len ? len : 1));
+	for (i32 i = 0; i < len; i++) {
+		entries[i] = ac->entries->data[i];
+		if (entries[i].frames) {
+			entries[i].frames = (void*) dyn_save(blob, entries[i].frames->len, entries[i].frames->data, sizeof(Rect));
+		}
+	}
+
+	ac->entries = (void*) dyn_save(blob, len, entries, sizeof(AnimationEntry));
+	clean(entries);
+}
+
+void ac_snapshot_load(void* comp, const u8* blob) {
+	AnimationComponent* ac = comp;
+	if (ac->entries == NULL) return;
+
+	// Loaded arrays are regular dyn arrays so they can still grow
+	const u64* saved = ecs_blob_get(blob, (u64) ac->entries);
+	const AnimationEntry* saved_entries = (const AnimationEntry*) (saved + 1);
+
+	Dyn_Array(AnimationEntry) entries = NULL;
+	dyn_array_resize(entries, (i32) saved[0]);
+	for (i32 i = 0; i < entries->len; i++) {
+		AnimationEntry entry = saved_entries[i];
+		if (entry.frames) {
+			const u64* saved_frames = ecs_blob_get(blob, (u64) entry.frames);
+
+			Dyn_Array(Rect) frames = NULL;
+			dyn_array_resize(frames, (i32) saved_frames[0]);
+			memcpy(frames->data, saved_frames + 1, sizeof(Rect) * frames->len);
+			entry.frames = (void*) frames;
+		}
+		entries->data[i] = entry;
+	}
+	ac->entries = (void*) entries;
+}
@@ -3,6 +3,7 @@
 
 #include "window/window.h"
 #include "core/dyn_array.h"
+#include "ecs/ecs.h"
 #include "graphics/texture.h"
 #include "math/rect.h"
 #include "math/vec.h"
@@ -55,5 +56,7 @@ typedef struct {
 AnimationComponent make_animation_component(void* entries, i32 starting_state);
 void ac_switch_frame(AnimationComponent* ac, i32 id);
 Rect ac_get_frame(AnimationComponent* ac);
+void ac_snapshot_save(void* comp, ECS_Blob* blob);
+void ac_snapshot_load(void* comp, const u8* blob);
 
 #endif // __COMPONENTS_H__
@@ -2,6 +2,7 @@
 #include "graphics/imr.h"
 #include "math/vec.h"
 #include "ecs/ecs.h"
+#include "ecs/system.h"
 
 #include "components.h"
 #include "renderer.h"
@@ -13,7 +14,6 @@ typedef enum {
 
 Entity player_init(ECS* ecs) {
 	Texture player_sprite = unwrap(texture_from_file(PLAYER_SPRITE, true));
-	texture_bind(player_sprite);
 
 	Entity player = entity_new(ecs);
 
@@ -96,12 +96,43 @@ Entity player_init(ECS* ecs) {
 	return player;
 }
 
+// Systems
+
+void movement_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	for (u32 i = 0; i < it->cnt; i++) {
+		// Only columns that actually change are taken mutably, so change filters skip idle entities
+		const MovementComponent* mc = ecs_iter_read(it, MovementComponent, 0, i);
+		i32 state = IDLE;
+		if (mc->h_dir == M_LEFT || mc->h_dir == M_RIGHT) {
+			TransformComponent* tc = ecs_iter_get(it, TransformComponent, 1, i);
+			f32 speed = mc->h_dir == M_LEFT ? -mc->speed : mc->speed;
+			tc->pos = v3_add(tc->pos, (v3) {speed, 0, 0});
+			state = WALK;
+		}
+
+		if (ecs_iter_read(it, AnimationComponent, 2, i)->curr_state != state) {
+			ac_switch_frame(ecs_iter_get(it, AnimationComponent, 2, i), state);
+		}
+	}
+}
+
+void animation_system(ECS* ecs, ECS_Query_Iter* it, void* user) {
+	for (u32 i = 0; i < it->cnt; i++) {
+		AnimationComponent* ac = ecs_iter_get(it, AnimationComponent, 0, i);
+		RenderComponent* rc = ecs_iter_get(it, RenderComponent, 1, i);
+		rc->tex_coord = ac_get_frame(ac);
+	}
+}
+
 // Main
 
 int main(int argc, char** argv) {
 	Window window = unwrap(window_new("Game", WIN_SIZE.x, WIN_SIZE.y));
 	ECS* ecs = ecs_new(MAX_ENTITY_CNT);
 
+	// Animation frames live in dyn arrays, snapshots need to follow them
+	ecs_snapshot_hook(AnimationComponent, ac_snapshot_save, ac_snapshot_load);
+
 	OCamera camera = ocamera_new(
 		(v2) { 0, 0 },
 		1.0f,
@@ -112,13 +143,28 @@ int main(int argc, char** argv) {
 
 	Entity player = player_init(ecs);
 
-	float speed = 5.0f;
+	ECS_Scheduler* sched = ecs_scheduler_new(ecs, 0);
+	ecs_system_add(sched, (ECS_System) {
+		.name = "movement",
+		.fn = movement_system,
+		.query = ecs_query_new(ecs, MovementComponent, TransformComponent, AnimationComponent),
+		.writes = ecs_mask(TransformComponent, AnimationComponent),
+		.parallel = true
+	});
+	ecs_system_add(sched, (ECS_System) {
+		.name = "animation",
+		.fn = animation_system,
+		.query = ecs_query_new(ecs, AnimationComponent, RenderComponent),
+		.writes = ecs_mask(AnimationComponent, RenderComponent),
+		.parallel = true
+	});
+
 	while (!window.should_close) {
 
 		// Event
 		{
-			TransformComponent* tc = entity_get_component(ecs, player, TransformComponent);
-			MovementComponent* mc = entity_get_component(ecs, player, MovementComponent);
+			// Read only, keys that write take the component mutably so change filters skip idle frames
+			const MovementComponent* mc = entity_read_component(ecs, player, MovementComponent);
 			Event event;
 			while(event_poll(window, &event)) {
 				if (event.type == KEYDOWN) {
@@ -132,19 +178,21 @@ int main(int argc, char** argv) {
 
 						case GLFW_KEY_A: {
 							if (mc->look_dir == M_RIGHT) {
-								tc->rot = rotate_y(PI);
+								entity_get_component(ecs, player, TransformComponent)->rot = rotate_y(PI);
 							}
-							mc->h_dir = M_LEFT;
-							mc->look_dir = M_LEFT;
+							MovementComponent* w_mc = entity_get_component(ecs, player, MovementComponent);
+							w_mc->h_dir = M_LEFT;
+							w_mc->look_dir = M_LEFT;
 							break;
 						}
 
 						case GLFW_KEY_D: {
 							if (mc->look_dir == M_LEFT) {
-								tc->rot = rotate_y(2 * PI);
+								entity_get_component(ecs, player, TransformComponent)->rot = rotate_y(2 * PI);
 							}
-							mc->h_dir = M_RIGHT;
-							mc->look_dir = M_RIGHT;
+							MovementComponent* w_mc = entity_get_component(ecs, player, MovementComponent);
+							w_mc->h_dir = M_RIGHT;
+							w_mc->look_dir = M_RIGHT;
 							break;
 						}
 					}
@@ -152,37 +200,27 @@ int main(int argc, char** argv) {
 				else if (event.type == KEYUP) {
 					switch (event.e.key) {
 						case GLFW_KEY_A:
-							mc->h_dir = M_NONE;
+							entity_get_component(ecs, player, MovementComponent)->h_dir = M_NONE;
 							break;
 
 						case GLFW_KEY_D:
-							mc->h_dir = M_NONE;
+							entity_get_component(ecs, player, MovementComponent)->h_dir = M_NONE;
 							break;
 					}
 				}
 			}
 		}
 
-		// Movement Update
-		{
-			TransformComponent* tc = entity_get_component(ecs, player, TransformComponent);
-			AnimationComponent* ac = entity_get_component(ecs, player, AnimationComponent);
-			MovementComponent* mc = entity_get_component(ecs, player, MovementComponent);
-			if (mc->h_dir == M_LEFT) {
-				tc->pos = v3_add(tc->pos, (v3) {-mc->speed, 0, 0});
-				ac_switch_frame(ac, WALK);
-			} else if (mc->h_dir == M_RIGHT) {
-				tc->pos = v3_add(tc->pos, (v3) {mc->speed, 0, 0});
-				ac_switch_frame(ac, WALK);
-			} else {
-				ac_switch_frame(ac, IDLE);
-			}
-		}
+		// Movement and animation update
+		ecs_scheduler_run(sched);
 
 		renderer_update(&ren, &camera, (v4) { 0.5, 0.5, 0.5, 1 });
 		window_update(&window);
 	}
 	
+	arena_print_stats(frame_arena());
+	imr_print_stats(&ren.imr);
+	ecs_scheduler_delete(sched);
 	ecs_delete(ecs);
 	window_delete(window);
 	return 0;
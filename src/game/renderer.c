@@ -1,5 +1,17 @@
 #include "renderer.h"
 
+#include <math.h>
+
+// Looks up the light uniforms of a program, the lights themselves are in the light buffer
+static Light_Uniforms renderer_light_uniforms(const Shader* shader) {
+	Light_Uniforms u;
+	u.dim = shader_uniform(shader, "dim");
+	assert(u.dim != -1, "Cannot find uniform: dim\n");
+	u.light_cnt = shader_uniform(shader, "light_cnt");
+	assert(u.light_cnt != -1, "Cannot find uniform: light_cnt\n");
+	return u;
+}
+
 Result_Renderer renderer_new(ECS* ecs, v2 surf_size, v2 win_size) {
 
 	// Setting up IMR
@@ -47,15 +59,47 @@ Result_Renderer renderer_new(ECS* ecs, v2 surf_size, v2 win_size) {
 		return ERR(Renderer, unwrap_err(r_mix_fbo));
 	}
 
+	Shader color_shader = unwrap(r_color_shader);
+	Shader light_shader = unwrap(r_light_shader);
+	Shader mix_shader = unwrap(r_mix_shader);
+
+	i32 mix_color_texture = shader_uniform(&mix_shader, "color_texture");
+	assert(mix_color_texture != -1, "Cannot find uniform: color_texture\n");
+	i32 mix_light_texture = shader_uniform(&mix_shader, "light_texture");
+	assert(mix_light_texture != -1, "Cannot find uniform: light_texture\n");
+
+	// Render query has to own its records so the color pass reads plain columns
+	ECS_Query* render_query = ecs_query_new(ecs, RenderComponent, TransformComponent);
+	assert(render_query->owning, "Render and transform components are owned by another query.\n");
+
+	// Light index in the buffer is the position in the query, so it has to follow the record
+	ECS_Query* light_query = ecs_query_new(ecs, LightComponent);
+	assert(light_query->owning, "Light component is owned by another query.\n");
+
+	u32 light_ssbo;
+	GLCall(glGenBuffers(1, &light_ssbo));
+	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, light_ssbo));
+	GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Light_Data) * LIGHT_INITIAL_CAP, NULL, GL_DYNAMIC_DRAW));
+
 	return OK(Renderer, (Renderer) {
 		.imr = unwrap(r_imr),
+		.draw_list = draw_list_new(),
 		.ecs = ecs,
+		.render_query = render_query,
+		.lights = ecs_filter_new(light_query, ecs_mask(LightComponent), 0),
+		.light_ssbo = light_ssbo,
+		.light_data = alloc(sizeof(Light_Data) * LIGHT_INITIAL_CAP),
+		.light_cap = LIGHT_INITIAL_CAP,
 		.final_cam = final_cam,
 		.surf_size = surf_size,
 		.win_size = win_size,
-		.color_shader = unwrap(r_color_shader),
-		.light_shader = unwrap(r_light_shader),
-		.mix_shader = unwrap(r_mix_shader),
+		.color_shader = color_shader,
+		.light_shader = light_shader,
+		.mix_shader = mix_shader,
+		.color_uniforms = renderer_light_uniforms(&color_shader),
+		.light_uniforms = renderer_light_uniforms(&light_shader),
+		.mix_color_texture = mix_color_texture,
+		.mix_light_texture = mix_light_texture,
 		.light_fbo = unwrap(r_light_fbo),
 		.color_fbo = unwrap(r_color_fbo),
 		.mix_fbo = unwrap(r_mix_fbo),
@@ -63,13 +107,24 @@ Result_Renderer renderer_new(ECS* ecs, v2 surf_size, v2 win_size) {
 }
 
 void renderer_delete(Renderer* ren) {
+	draw_list_delete(ren->draw_list);
 	imr_delete(&ren->imr);
+	shader_delete(ren->color_shader);
+	shader_delete(ren->light_shader);
+	shader_delete(ren->mix_shader);
+	GLCall(glDeleteBuffers(1, &ren->light_ssbo));
+	clean(ren->light_data);
 	fbo_delete(&ren->light_fbo);
 	fbo_delete(&ren->color_fbo);
 	fbo_delete(&ren->mix_fbo);
 }
 
 void renderer_update(Renderer* ren, OCamera* camera, v4 color) {
+	imr_reset_stats(&ren->imr);
+
+	// Lights shared by the color and light pass
+	renderer_upload_lights(ren);
+
 	// Color pass
 	renderer_color_pass(ren, camera, color);
 
@@ -91,8 +146,6 @@ void renderer_update(Renderer* ren, OCamera* camera, v4 color) {
 		imr_update_mvp(&ren->imr, mvp);
 
 		Texture texture_to_render = ren->mix_fbo.color_texture;
-		texture_bind(texture_to_render);
-	
 		imr_push_quad_tex(
 			&ren->imr,
 			(v3) {0, 0, 0},
@@ -107,58 +160,65 @@ void renderer_update(Renderer* ren, OCamera* camera, v4 color) {
 	}
 }
 
-void renderer_push_light_uniforms(Renderer* ren) {
-	CompRecord* cr = comp_table_get_record(ren->ecs->table, LightComponent);
-	if (cr == NULL) return;
-
-	int loc;
-
-	loc = GLCall(glGetUniformLocation(ren->color_shader, "dim"));
-	assert(loc != -1, "Cannot find uniform: dim\n");
-	GLCall(glUniform2f(loc, ren->surf_size.x, ren->surf_size.y));
-
-	loc = GLCall(glGetUniformLocation(ren->color_shader, "light_cnt"));
-	assert(loc != -1, "Cannot find uniform: light_cnt\n");
-	GLCall(glUniform1i(loc, cr->entry_cnt));
-
-	for (int i = 0; i < cr->entry_cnt; i++) {
-		Entity ent = cr->entries_ent[i];
-		CompEntry* entry = comp_record_get_entry(cr, ent);
-		LightComponent* light = entry->data;
-
-		char* uni_name = "light[%d].%s";
-		char buff[100];
-
-		sprintf(buff, uni_name, i, "pos");
-		loc = GLCall(glGetUniformLocation(ren->color_shader, buff));
-		assert(loc != -1, "Cannot find uniform: %s\n", buff);
-		GLCall(glUniform2f(loc, light->pos.x, light->pos.y));
-
-		sprintf(buff, uni_name, i, "radius");
-		loc = GLCall(glGetUniformLocation(ren->color_shader, buff));
-		assert(loc != -1, "Cannot find uniform: %s\n", buff);
-		GLCall(glUniform1f(loc, light->radius));
-
-		sprintf(buff, uni_name, i, "intensity");
-		loc = GLCall(glGetUniformLocation(ren->color_shader, buff));
-		assert(loc != -1, "Cannot find uniform: light->intensity\n");
-		GLCall(glUniform1f(loc, light->intensity));
-
-		sprintf(buff, uni_name, i, "dir");
-		loc = GLCall(glGetUniformLocation(ren->color_shader, buff));
-		assert(loc != -1, "Cannot find uniform: light->dir\n");
-		GLCall(glUniform1f(loc, light->dir));
-
-		sprintf(buff, uni_name, i, "fov");
-		loc = GLCall(glGetUniformLocation(ren->color_shader, buff));
-		assert(loc != -1, "Cannot find uniform: light->fov\n");
-		GLCall(glUniform1f(loc, light->fov));
-
-		sprintf(buff, uni_name, i, "color");
-		loc = GLCall(glGetUniformLocation(ren->color_shader, buff));
-		assert(loc != -1, "Cannot find uniform: light->color\n");
-		GLCall(glUniform4f(loc, light->color.r, light->color.g, light->color.b, light->color.a));
+void renderer_upload_lights(Renderer* ren) {
+	ECS_Query* q = ren->lights.query;
+
+	// Lights moved in the record since the last upload changed index, so all are sent again
+	b32 full = ren->lights.last_tick == 0 || q->recs[0]->moved_tick > ren->lights.last_tick;
+	ECS_Query_Iter it = ecs_filter_iter(&ren->lights);
+	GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ren->light_ssbo));
+	if (q->len > ren->light_cap) {
+		while (ren->light_cap < q->len) ren->light_cap *= 2;
+		ren->light_data = alloc_resize(ren->light_data, sizeof(Light_Data) * ren->light_cap);
+		GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Light_Data) * ren->light_cap, NULL, GL_DYNAMIC_DRAW));
+		full = true;
+	}
+	if (full) it = ecs_query_iter(q);
+
+	// Changed lights are packed in place and sent as one range
+	u32 first = q->len, last = 0;
+	while (ecs_query_next(&it)) {
+		const LightComponent* lights = ecs_iter_read_column(&it, LightComponent, 0);
+
+		for (u32 i = 0; i < it.cnt; i++) {
+			const LightComponent* light = &lights[i];
+			ren->light_data[it.start + i] = (Light_Data) {
+				.pos = light->pos,
+				.radius = light->radius,
+				.intensity = light->intensity,
+				.dir = light->dir,
+				.fov = light->fov,
+				.color = light->color
+			};
+		}
+		if (it.start < first) first = it.start;
+		if (it.start + it.cnt > last) last = it.start + it.cnt;
+	}
+
+	if (first < last) {
+		GLCall(glBufferSubData(
+			GL_SHADER_STORAGE_BUFFER,
+			sizeof(Light_Data) * first,
+			sizeof(Light_Data) * (last - first),
+			&ren->light_data[first]
+		));
 	}
+	GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, ren->light_ssbo));
+}
+
+void renderer_push_light_uniforms(Renderer* ren, Shader* shader, Light_Uniforms* uniforms) {
+	shader_set_v2(shader, uniforms->dim, ren->surf_size);
+	shader_set_i32(shader, uniforms->light_cnt, ren->lights.query->len);
+}
+
+// Sprites are alpha blended without a depth test, so z has to order them across textures. Visible z
+// goes from -far at the back to -near at the front, every whole z unit back from the front is its own
+// layer and sprites more than 255 units back share the first one
+static u8 renderer_sprite_layer(OCamera* camera, f32 z) {
+	f32 back = floorf(-camera->boundary.near - z);
+	if (back < 0) return 255;
+	if (back > 255) return 0;
+	return 255 - (u8) back;
 }
 
 void renderer_color_pass(Renderer* ren, OCamera* camera, v4 color) {
@@ -175,34 +235,29 @@ void renderer_color_pass(Renderer* ren, OCamera* camera, v4 color) {
 	imr_update_mvp(&ren->imr, mvp);
 
 	// Handling light
-	renderer_push_light_uniforms(ren);
-
-	// Handling animation component
-	{
-		ecs_for_each_comp(ren->ecs, AnimationComponent, {
-			Rect r = ac_get_frame(comp);
-			RenderComponent* rc = entity_get_component(ren->ecs, entity, RenderComponent);
-			rc->tex_coord = r;
-		});
+	renderer_push_light_uniforms(ren, &ren->color_shader, &ren->color_uniforms);
+
+	// Handling render component, sprites are drawn back to front by z and grouped by texture inside a z unit
+	Draw_State state = { .shader = ren->color_shader, .blend = DRAW_BLEND_ALPHA };
+	ECS_Query_Iter it = ecs_query_iter(ren->render_query);
+	while (ecs_query_next(&it)) {
+		const RenderComponent* rcs = ecs_iter_read_column(&it, RenderComponent, 0);
+		const TransformComponent* tcs = ecs_iter_read_column(&it, TransformComponent, 1);
+		for (u32 i = 0; i < it.cnt; i++) {
+			state.layer = renderer_sprite_layer(camera, tcs[i].pos.z);
+			state.depth = tcs[i].pos.z;
+			draw_list_push_quad(ren->draw_list, state, &(Quad_Desc) {
+				.pos = tcs[i].pos,
+				.size = tcs[i].size,
+				.tex_rect = rcs[i].tex_coord,
+				.tex_id = rcs[i].texture.id,
+				.rot = tcs[i].rot,
+				.color = rcs[i].color
+			});
+		}
 	}
 
-	// Handling render component
-	{
-		ecs_for_each_comp(ren->ecs, RenderComponent, {
-			TransformComponent* tc = entity_get_component(ren->ecs, entity, TransformComponent);
-			imr_push_quad_tex(
-				&ren->imr,
-				tc->pos,
-				tc->size,
-				comp->tex_coord,
-				comp->texture.id,
-				tc->rot,
-				comp->color
-			);
-		});
-	}
-
-	imr_end(&ren->imr);
+	draw_list_flush(ren->draw_list, &ren->imr, mvp);
 	fbo_unbind();
 }
 
@@ -219,7 +274,7 @@ void renderer_light_pass(Renderer* ren, OCamera* camera, v4 color) {
 	imr_update_mvp(&ren->imr, mvp);
 
 	// Handling light
-	renderer_push_light_uniforms(ren);
+	renderer_push_light_uniforms(ren, &ren->light_shader, &ren->light_uniforms);
 
 	imr_push_quad(
 		&ren->imr,
@@ -242,18 +297,11 @@ void renderer_mix_pass(Renderer* ren, OCamera* camera, v4 color) {
 	imr_clear(color);
 	imr_begin(&ren->imr);
 
-	texture_bind(ren->color_fbo.color_texture);
-	texture_bind(ren->light_fbo.color_texture);
-
-	int loc;
-
-	loc = GLCall(glGetUniformLocation(ren->mix_shader, "color_texture"));
-	assert(loc != -1, "Cannot find uniform: color_texture\n");
-	GLCall(glUniform1i(loc, ren->color_fbo.color_texture.id));
+	u32 color_unit = imr_texture_slot(&ren->imr, ren->color_fbo.color_texture);
+	u32 light_unit = imr_texture_slot(&ren->imr, ren->light_fbo.color_texture);
 
-	loc = GLCall(glGetUniformLocation(ren->mix_shader, "light_texture"));
-	assert(loc != -1, "Cannot find uniform: light_texture\n");
-	GLCall(glUniform1i(loc, ren->light_fbo.color_texture.id));
+	shader_set_i32(&ren->mix_shader, ren->mix_color_texture, color_unit);
+	shader_set_i32(&ren->mix_shader, ren->mix_light_texture, light_unit);
 
 	imr_push_quad(
 		&ren->imr,
@@ -4,6 +4,7 @@
 #include "math/vec.h"
 #include "math/mat.h"
 #include "graphics/imr.h"
+#include "graphics/draw_list.h"
 #include "graphics/fbo.h"
 #include "graphics/shader.h"
 #include "ecs/ecs.h"
@@ -12,13 +13,50 @@
 #include "components.h"
 #include "shader_src.h"
 
+/*
+ * @brief Positions of the light uniforms of a program, looked up once when the renderer is made
+ */
+
+typedef struct {
+	i32 dim, light_cnt;
+} Light_Uniforms;
+
+/*
+ * @brief Light as laid out in the std430 light buffer of the shaders
+ * @info `color` is a vec4, std430 puts it on a 16 byte boundary
+ */
+
+typedef struct {
+	v2 pos;
+	f32 radius;
+	f32 intensity;
+	f32 dir;
+	f32 fov;
+	f32 pad[2];
+	v4 color;
+} Light_Data;
+
+STATIC_ASSERT(sizeof(Light_Data) == 48, "Light_Data has to match the std430 Light of the shaders.");
+
+#define LIGHT_INITIAL_CAP 16
+
 typedef struct {
 	IMR imr;
+	Draw_List* draw_list;
 	ECS* ecs;
+	ECS_Query* render_query;
+
+	// Lights are uploaded once per frame to a buffer both light programs read
+	ECS_Filter lights;
+	u32 light_ssbo;
+	Light_Data* light_data;
+	u32 light_cap;
 	OCamera final_cam;
 	v2 surf_size, win_size;
 
 	Shader color_shader, light_shader, mix_shader;
+	Light_Uniforms color_uniforms, light_uniforms;
+	i32 mix_color_texture, mix_light_texture;
 	FBO light_fbo, color_fbo, mix_fbo;
 } Renderer;
 
@@ -28,7 +66,8 @@ Result_Renderer renderer_new(ECS* ecs, v2 surf_size, v2 win_size);
 void renderer_delete(Renderer* ren);
 void renderer_update(Renderer* ren, OCamera* camera, v4 color);
 
-void renderer_push_light_uniforms(Renderer* ren);
+void renderer_upload_lights(Renderer* ren);
+void renderer_push_light_uniforms(Renderer* ren, Shader* shader, Light_Uniforms* uniforms);
 void renderer_color_pass(Renderer* ren, OCamera* camera, v4 color);
 void renderer_light_pass(Renderer* ren, OCamera* camera, v4 color);
 void renderer_mix_pass(Renderer* ren, OCamera* camera, v4 color);
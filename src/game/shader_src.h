@@ -1,12 +1,18 @@
 #ifndef __SHADER_SRC_H__
 #define __SHADER_SRC_H__
 
+#include "graphics/imr.h"
+
 // TODO: Merge color_frag shader and light_frag shader into one using two export textures
 
+// Shader storage binding of the lights, SHADER_SRC passes it on to the shaders
+#define LIGHT_BINDING 1
+
 #define SHADER_SRC(...)\
 	"#version 440 core\n"\
+	IMR_GLSL_DEFINES\
 	"#define PI 3.1415926538\n"\
-	"#define MAX_LIGHT_CAP 100\n"\
+	"#define LIGHT_BINDING " STRINGIFY(LIGHT_BINDING) "\n"\
 	"vec2 pix_size = vec2(1);\n"\
 	#__VA_ARGS__\
 
@@ -15,7 +21,7 @@ static const char* color_vertex_src = SHADER_SRC(
 	layout (location = 0) in vec3 position;
 	layout (location = 1) in vec4 color;
 	layout (location = 2) in vec2 tex_coord;
-	layout (location = 3) in float tex_id;
+	layout (location = 3) in IMR_TEX_ID tex_id;
 
 	uniform mat4 mvp;
 
@@ -27,7 +33,7 @@ static const char* color_vertex_src = SHADER_SRC(
 	void main() {
 		o_color = color;
 		o_tex_coord = tex_coord;
-		o_tex_id = tex_id;
+		o_tex_id = float(tex_id);
 		o_mvp = mvp;
 		gl_Position = mvp * vec4(position, 1.0f);
 	}
@@ -50,10 +56,12 @@ static const char* color_fragment_src = SHADER_SRC(
 		vec4 color;
 	};
 
+	layout (std430, binding = LIGHT_BINDING) readonly buffer Lights {
+		Light light[];
+	};
+
 	uniform vec2 dim;
-	uniform Light light[MAX_LIGHT_CAP];
 	uniform int light_cnt;
-	uniform sampler2D textures[32];
 
 	vec2 rotate(vec2 v, float angle) {
 		float cosAngle = cos(angle);
@@ -67,7 +75,7 @@ static const char* color_fragment_src = SHADER_SRC(
 	void main() {
 		vec4 final_color = vec4(0,0,0,1);
 		int idx = int(o_tex_id);
-		vec4 color = texture(textures[idx], o_tex_coord) * o_color;
+		vec4 color = IMR_TEXTURE(idx, o_tex_coord) * o_color;
 
 		for (int i = 0; i < light_cnt; i++) {
 
@@ -107,7 +115,7 @@ static const char* light_vertex_src = SHADER_SRC(
 	layout (location = 0) in vec3 position;
 	layout (location = 1) in vec4 color;
 	layout (location = 2) in vec2 tex_coord;
-	layout (location = 3) in float tex_id;
+	layout (location = 3) in IMR_TEX_ID tex_id;
 
 	uniform mat4 mvp;
 
@@ -119,7 +127,7 @@ static const char* light_vertex_src = SHADER_SRC(
 	void main() {
 		o_color = color;
 		o_tex_coord = tex_coord;
-		o_tex_id = tex_id;
+		o_tex_id = float(tex_id);
 		o_mvp = mvp;
 		gl_Position = vec4(position, 1.0f);
 	}
@@ -142,8 +150,11 @@ static const char* light_fragment_src = SHADER_SRC(
 		vec4 color;
 	};
 
+	layout (std430, binding = LIGHT_BINDING) readonly buffer Lights {
+		Light light[];
+	};
+
 	uniform vec2 dim;
-	uniform Light light[MAX_LIGHT_CAP];
 	uniform int light_cnt;
 
 	vec2 rotate(vec2 v, float angle) {
@@ -0,0 +1,202 @@
+#include "draw_list.h"
+
+#include <string.h>
+
+Draw_List* draw_list_new() {
+	Draw_List* list = alloc(sizeof(Draw_List));
+
+	// Index 0 is always the IMR default shader, its samplers are set by imr_new
+	list->shaders[0] = (Shader) { 0 };
+	list->shader_cnt = 1;
+	list->sampled = 1;
+	list->run = alloc(sizeof(Quad_Desc) * MAX_QUAD_CNT);
+	return list;
+}
+
+void draw_list_delete(Draw_List* list) {
+	clean(list->cmds);
+	clean(list->run);
+	clean(list->quads);
+	clean(list->tris);
+	clean(list);
+}
+
+static u32 draw_list_shader_idx(Draw_List* list, Shader shader) {
+	for (u32 i = 0; i < list->shader_cnt; i++) {
+		if (list->shaders[i].id == shader.id) return i;
+	}
+
+	assert(list->shader_cnt < DRAW_LIST_MAX_SHADER_CNT, "Draw list shader limit reached. Cant add shader %u.\n", shader.id);
+	list->shaders[list->shader_cnt] = shader;
+	return list->shader_cnt++;
+}
+
+// Flips float bits so they sort like the floats they hold
+static u32 draw_list_depth_bits(f32 depth) {
+	u32 bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+}
+
+static void draw_list_push_cmd(Draw_List* list, Draw_State state, f32 tex_id, u32 idx) {
+	u32 tex = (u32) tex_id;
+	assert(tex <= 0xffff, "Texture %u does not fit in a draw list key.\n", tex);
+
+	u64 key = (u64) state.layer << 56
+		| (u64) draw_list_shader_idx(list, state.shader) << 50
+		| (u64) (state.blend & 0x3) << 48
+		| (u64) tex << 32
+		| draw_list_depth_bits(state.depth);
+
+	if (list->cmd_cnt == list->cmd_cap) {
+		list->cmd_cap = list->cmd_cap ? list->cmd_cap * 2 : 256;
+		list->cmds = alloc_resize(list->cmds, sizeof(Draw_Cmd) * list->cmd_cap);
+	}
+	list->cmds[list->cmd_cnt++] = (Draw_Cmd) { key, idx };
+}
+
+void draw_list_push_quad(Draw_List* list, Draw_State state, const Quad_Desc* quad) {
+	if (list->quad_cnt == list->quad_cap) {
+		list->quad_cap = list->quad_cap ? list->quad_cap * 2 : 256;
+		list->quads = alloc_resize(list->quads, sizeof(Quad_Desc) * list->quad_cap);
+	}
+	list->quads[list->quad_cnt] = *quad;
+	draw_list_push_cmd(list, state, quad->tex_id, list->quad_cnt++);
+}
+
+void draw_list_push_triangle(Draw_List* list, Draw_State state, const Triangle_Desc* tri) {
+	if (list->tri_cnt == list->tri_cap) {
+		list->tri_cap = list->tri_cap ? list->tri_cap * 2 : 64;
+		list->tris = alloc_resize(list->tris, sizeof(Triangle_Desc) * list->tri_cap);
+	}
+	list->tris[list->tri_cnt] = *tri;
+	draw_list_push_cmd(list, state, tri->tex_id, list->tri_cnt++ | DRAW_CMD_TRIANGLE);
+}
+
+// Stable LSD radix sort on the keys, a byte per pass. Passes where every key has the same byte are skipped.
+static Draw_Cmd* draw_list_sort(Draw_List* list, Frame_Arena* arena) {
+	u32 cnt = list->cmd_cnt;
+	Draw_Cmd* src = list->cmds;
+	Draw_Cmd* dst = arena_push_array(arena, Draw_Cmd, cnt);
+	u32 (*hist)[256] = list->sort_hist;
+	memset(hist, 0, sizeof(list->sort_hist));
+
+	for (u32 i = 0; i < cnt; i++) {
+		u64 key = src[i].key;
+		for (u32 p = 0; p < 8; p++) {
+			hist[p][(key >> (p * 8)) & 0xff]++;
+		}
+	}
+
+	for (u32 p = 0; p < 8; p++) {
+		u32 shift = p * 8;
+		if (hist[p][(src[0].key >> shift) & 0xff] == cnt) continue;
+
+		u32 offset = 0;
+		for (u32 b = 0; b < 256; b++) {
+			u32 n = hist[p][b];
+			hist[p][b] = offset;
+			offset += n;
+		}
+		for (u32 i = 0; i < cnt; i++) {
+			dst[hist[p][(src[i].key >> shift) & 0xff]++] = src[i];
+		}
+
+		Draw_Cmd* t = src;
+		src = dst;
+		dst = t;
+	}
+	return src;
+}
+
+static void draw_list_set_blend(Draw_Blend blend) {
+	switch (blend) {
+		case DRAW_BLEND_ALPHA:
+			GLCall(glEnable(GL_BLEND));
+			GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+			break;
+		case DRAW_BLEND_ADD:
+			GLCall(glEnable(GL_BLEND));
+			GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+			break;
+		case DRAW_BLEND_OPAQUE:
+			GLCall(glDisable(GL_BLEND));
+			break;
+	}
+}
+
+void draw_list_flush(Draw_List* list, IMR* imr, m4 mvp) {
+	imr_end(imr);
+	if (list->cmd_cnt == 0) return;
+
+	// The sort copy is frame scratch, the arena chains more blocks for big lists
+	Frame_Arena* arena = frame_arena();
+	u64 mark = arena_mark(arena);
+	Draw_Cmd* cmds = draw_list_sort(list, arena);
+
+	// Consecutive quads are gathered so they go through imr_push_quads together
+	Quad_Desc* run = list->run;
+	u32 run_cnt = 0;
+
+	Shader prev_shader = imr->shader;
+	u32 shader = ~0u, blend = ~0u;
+	for (u32 i = 0; i < list->cmd_cnt; i++) {
+		u64 key = cmds[i].key;
+		u32 k_shader = (key >> 50) & 0x3f;
+		u32 k_blend = (key >> 48) & 0x3;
+
+		// Shader and blend changes end the batch
+		if (k_shader != shader || k_blend != blend) {
+			imr_push_quads(imr, run, run_cnt);
+			run_cnt = 0;
+			imr_end(imr);
+
+			if (k_shader != shader) {
+				Shader s = list->shaders[k_shader].id ? list->shaders[k_shader] : imr->def_shader;
+				imr_switch_shader(imr, s);
+				if (!(list->sampled & (1ull << k_shader))) {
+					imr_reapply_samplers(imr);
+					list->sampled |= 1ull << k_shader;
+				}
+				imr_update_mvp(imr, mvp);
+				shader = k_shader;
+			}
+			if (k_blend != blend) {
+				draw_list_set_blend(k_blend);
+				imr->stats.state_changes++;
+				blend = k_blend;
+			}
+			imr_begin(imr);
+		}
+
+		u32 idx = cmds[i].idx;
+		if (idx & DRAW_CMD_TRIANGLE) {
+			imr_push_quads(imr, run, run_cnt);
+			run_cnt = 0;
+
+			Triangle_Desc* t = &list->tris[idx & ~DRAW_CMD_TRIANGLE];
+			imr_push_triangle_tex(imr, t->p1, t->p2, t->p3, t->tex_coord, t->tex_id, t->rot, t->color);
+		} else {
+			run[run_cnt++] = list->quads[idx];
+			if (run_cnt == MAX_QUAD_CNT) {
+				imr_push_quads(imr, run, run_cnt);
+				run_cnt = 0;
+			}
+		}
+	}
+	imr_push_quads(imr, run, run_cnt);
+	imr_end(imr);
+
+	// Back to what IMR started with
+	if (blend != DRAW_BLEND_ALPHA) {
+		draw_list_set_blend(DRAW_BLEND_ALPHA);
+		imr->stats.state_changes++;
+	}
+	imr_switch_shader(imr, prev_shader);
+	GLCall(glUseProgram(prev_shader.id));
+
+	arena_reset_to(arena, mark);
+	list->cmd_cnt = 0;
+	list->quad_cnt = 0;
+	list->tri_cnt = 0;
+}
@@ -0,0 +1,147 @@
+#ifndef __DRAW_LIST_H__
+#define __DRAW_LIST_H__
+
+#include "core/defines.h"
+#include "core/log.h"
+#include "core/alloc.h"
+#include "imr.h"
+
+/*
+ * Draw list
+ *
+ * Retained front end for IMR. Quads and triangles are recorded with a 64 bit
+ * sort key, on flush the keys are radix sorted through frame arena scratch and
+ * the draws are emitted through IMR, flushing a batch only when the shader
+ * or blend mode changes or IMR runs out of texture units.
+ *
+ * Key, from the most significant bit:
+ *   layer (8) | shader (6) | blend (2) | texture (16) | depth (32)
+ *
+ * The sort is stable, draws with equal keys keep their submission order.
+ * Draws on one layer are grouped by shader, blend and texture before depth,
+ * so overlapping translucent draws have to be on different layers to keep
+ * their order. Shaders have to take the same inputs as the IMR default
+ * shader (mvp and the textures sampler array), a zeroed Shader stands for
+ * the default.
+ */
+
+#define DRAW_LIST_MAX_SHADER_CNT 64
+
+typedef enum {
+	DRAW_BLEND_ALPHA,
+	DRAW_BLEND_ADD,
+	DRAW_BLEND_OPAQUE
+} Draw_Blend;
+
+
+/*
+ * @brief State a draw is recorded with
+ * @mem layer  = Layer, lower layers are drawn first
+ * @mem shader = Shader to draw with, zeroed for the IMR default shader
+ * @mem blend  = Blend mode
+ * @mem depth  = Order inside a layer after the state, lower is drawn first
+ */
+
+typedef struct {
+	u8 layer;
+	Shader shader;
+	Draw_Blend blend;
+	f32 depth;
+} Draw_State;
+
+typedef struct {
+	v3 p1, p2, p3;
+	Triangle tex_coord;
+	f32 tex_id;
+	m4 rot;
+	v4 color;
+} Triangle_Desc;
+
+
+/*
+ * @brief Recorded draw
+ * @mem key = Sort key
+ * @mem idx = Index into the quads, or the triangles with DRAW_CMD_TRIANGLE set
+ */
+
+typedef struct {
+	u64 key;
+	u32 idx;
+} Draw_Cmd;
+
+#define DRAW_CMD_TRIANGLE 0x80000000
+
+
+/*
+ * @brief Structure holding the draws recorded since the last flush
+ * @mem cmds       = Draws in submission order
+ * @mem quads      = Quads of the draws
+ * @mem tris       = Triangles of the draws
+ * @mem shaders    = Shaders used by the list, the key holds their index
+ * @mem sampled    = Bit per shader, set once its samplers are provided
+ * @mem sort_hist  = Byte histograms of the sort
+ * @mem run        = Quads gathered for one imr_push_quads call
+ */
+
+typedef struct {
+	Draw_Cmd* cmds;
+	u32 cmd_cnt, cmd_cap;
+	u32 sort_hist[8][256];
+	Quad_Desc* run;
+	Quad_Desc* quads;
+	u32 quad_cnt, quad_cap;
+	Triangle_Desc* tris;
+	u32 tri_cnt, tri_cap;
+	Shader shaders[DRAW_LIST_MAX_SHADER_CNT];
+	u32 shader_cnt;
+	u64 sampled;
+} Draw_List;
+
+
+/*
+ * @brief Function to create a draw list
+ * @return Returns pointer to the draw list
+ */
+
+Draw_List* draw_list_new();
+
+
+/*
+ * @brief Function to delete a draw list
+ * @param list = Pointer to the draw list
+ */
+
+void draw_list_delete(Draw_List* list);
+
+
+/*
+ * @brief Function to record a quad
+ * @param list  = Pointer to the draw list
+ * @param state = State to draw with
+ * @param quad  = Quad, same as the imr_push_quad_tex arguments
+ */
+
+void draw_list_push_quad(Draw_List* list, Draw_State state, const Quad_Desc* quad);
+
+
+/*
+ * @brief Function to record a triangle
+ * @param list  = Pointer to the draw list
+ * @param state = State to draw with
+ * @param tri   = Triangle, same as the imr_push_triangle_tex arguments
+ */
+
+void draw_list_push_triangle(Draw_List* list, Draw_State state, const Triangle_Desc* tri);
+
+
+/*
+ * @brief Function to draw every recorded draw in key order and empty the list
+ * @param list = Pointer to the draw list
+ * @param imr  = IMR to draw with, vertices pushed to it before are drawn first
+ * @param mvp  = Mvp set on every shader used
+ * @info Leaves IMR ended, with its previous shader and alpha blending
+ */
+
+void draw_list_flush(Draw_List* list, IMR* imr, m4 mvp);
+
+#endif // __DRAW_LIST_H__
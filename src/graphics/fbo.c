@@ -23,10 +23,12 @@ Result_FBO fbo_new(u32 width, u32 height) {
 	GLuint attachments[1] = { GL_COLOR_ATTACHMENT0 };
 	GLCall(glDrawBuffers(1, attachments));
 
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	// Checking while the new framebuffer is still bound
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
 	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
 		return ERR(FBO, "Framebuffer is not complete!");
 	}
 
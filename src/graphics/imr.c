@@ -1,11 +1,18 @@
 #include "imr.h"
+#include "math/utils.h"
+#include <string.h>
+
+#if defined(__SSE2__) && !defined(IMR_NO_SIMD)
+#include <immintrin.h>
+#endif
 
 const char* v_src =
 	"#version 440 core\n"
+	IMR_GLSL_DEFINES
 	"layout (location = 0) in vec3 position;\n"
 	"layout (location = 1) in vec4 color;\n"
 	"layout (location = 2) in vec2 tex_coord;\n"
-	"layout (location = 3) in float tex_id;\n"
+	"layout (location = 3) in IMR_TEX_ID tex_id;\n"
 	"uniform mat4 mvp;\n"
 	"out vec4 o_color;\n"
 	"out vec2 o_tex_coord;\n"
@@ -13,24 +20,35 @@ const char* v_src =
 	"void main() {\n"
 	"o_color = color;\n"
 	"o_tex_coord = tex_coord;\n"
-	"o_tex_id = tex_id;\n"
+	"o_tex_id = float(tex_id);\n"
 	"gl_Position = mvp * vec4(position, 1.0f);\n"
 	"}\n";
 
 const char* f_src =
 	"#version 440 core\n"
+	IMR_GLSL_DEFINES
 	"layout (location = 0) out vec4 color;\n"
-	"uniform sampler2D textures[32];\n"
 	"in vec4 o_color;\n"
 	"in vec2 o_tex_coord;\n"
 	"in float o_tex_id;\n"
 	"void main() {\n"
 	"int index = int(o_tex_id);\n"
-	"color = texture(textures[index], o_tex_coord) * o_color;\n"
+	"color = IMR_TEXTURE(index, o_tex_coord) * o_color;\n"
 	"}\n";
 
+// GLEW_ flags only tell the entry points were found, which is always true with glewExperimental
+static b32 imr_has_extension(const char* name) {
+	i32 cnt;
+	GLCall(glGetIntegerv(GL_NUM_EXTENSIONS, &cnt));
+	for (i32 i = 0; i < cnt; i++) {
+		const char* ext = (const char*) GLCall(glGetStringi(GL_EXTENSIONS, i));
+		if (strcmp(ext, name) == 0) return true;
+	}
+	return false;
+}
+
 Result_IMR imr_new() {
-	u32 vao, vbo;
+	u32 vao, vbo, ibo;
 	Shader shader;
 
 	GLCall(glEnable(GL_BLEND));
@@ -42,9 +60,43 @@ Result_IMR imr_new() {
 
 	GLCall(glGenBuffers(1, &vbo));
 	GLCall(glBindBuffer(GL_ARRAY_BUFFER, vbo));
-	GLCall(glBufferData(GL_ARRAY_BUFFER, MAX_VBO_SIZE, NULL, GL_DYNAMIC_DRAW));
+
+	// Persistently mapped ring if the driver has immutable storage
+	b32 persistent = false;
+	Vertex* mapped = NULL;
+	Vertex* verts = NULL;
+#ifndef IMR_NO_PERSISTENT_MAP
+	persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#endif
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLCall(glBufferStorage(GL_ARRAY_BUFFER, IMR_RING_CNT * MAX_VBO_SIZE, NULL, flags));
+		mapped = GLCall(glMapBufferRange(GL_ARRAY_BUFFER, 0, IMR_RING_CNT * MAX_VBO_SIZE, flags));
+		if (mapped == NULL) {
+			return ERR(IMR, "Failed to map vertex buffer.");
+		}
+		verts = mapped;
+	} else {
+		GLCall(glBufferData(GL_ARRAY_BUFFER, MAX_VBO_SIZE, NULL, GL_STREAM_DRAW));
+		verts = alloc(MAX_VBO_SIZE);
+	}
 
 	// VAO format
+#ifdef IMR_COMPACT_VERTEX
+	STATIC_ASSERT(
+		24 == sizeof(Vertex),
+		"Vertex has been updated. Update VAO format."
+	);
+
+	GLCall(glEnableVertexAttribArray(0));
+	GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*) offsetof(Vertex, pos)));
+	GLCall(glEnableVertexAttribArray(1));
+	GLCall(glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (const void*) offsetof(Vertex, color)));
+	GLCall(glEnableVertexAttribArray(2));
+	GLCall(glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), (const void*) offsetof(Vertex, tex_coord)));
+	GLCall(glEnableVertexAttribArray(3));
+	GLCall(glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(Vertex), (const void*) offsetof(Vertex, tex_id)));
+#else
 	STATIC_ASSERT(
 		10 == sizeof(Vertex) / sizeof(f32),
 		"Vertex has been updated. Update VAO format."
@@ -58,11 +110,27 @@ Result_IMR imr_new() {
 	GLCall(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*) offsetof(Vertex, tex_coord)));
 	GLCall(glEnableVertexAttribArray(3));
 	GLCall(glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*) offsetof(Vertex, tex_id)));
+#endif
+
+	// Quad indices never change, the binding is part of the VAO
+	u16* indices = alloc(sizeof(u16) * MAX_INDEX_CNT);
+	for (u32 i = 0; i < MAX_QUAD_CNT; i++) {
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 2;
+		indices[i * 6 + 4] = i * 4 + 3;
+		indices[i * 6 + 5] = i * 4 + 0;
+	}
+
+	GLCall(glGenBuffers(1, &ibo));
+	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo));
+	GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u16) * MAX_INDEX_CNT, indices, GL_STATIC_DRAW));
+	clean(indices);
 
 	// Generating white texture
 	u32 data = 0xffffffff;
 	Texture white = unwrap(texture_from_data(1, 1, &data));
-	texture_bind(white);
 
 	// Shader
 	Result_Shader rs = shader_new(v_src, f_src);
@@ -71,33 +139,86 @@ Result_IMR imr_new() {
 	}
 
 	shader = unwrap(rs);
-	GLCall(glUseProgram(shader));
 
-	// Providing texture samples
-	u32 samplers[TEXTURE_SAMPLE_AMT];
-	for (u32 i = 0; i < TEXTURE_SAMPLE_AMT; i++)
-		samplers[i] = i;
-	
-	// Providing samplers to the shader
-	int loc = GLCall(glGetUniformLocation(shader, "textures"));
-	assert(loc != -1, "Cannot find uniform: textures\n");
-	GLCall(glUniform1iv(loc, TEXTURE_SAMPLE_AMT, samplers));
+	// Texture handles if the driver has bindless textures, units otherwise
+	b32 bindless = false;
+#ifndef IMR_NO_BINDLESS
+	bindless = imr_has_extension("GL_ARB_bindless_texture");
+#endif
+	IMR_Handles handles = { 0 };
+	if (bindless) {
+		handles.handle_cap = 64;
+		handles.handles = alloc(sizeof(u64) * handles.handle_cap);
+		handles.ids = alloc(sizeof(u32) * handles.handle_cap);
+		handles.delete_cnt = texture_delete_cnt();
+		GLCall(glCreateBuffers(1, &handles.ssbo));
+		GLCall(glNamedBufferData(handles.ssbo, sizeof(u64) * handles.handle_cap, NULL, GL_DYNAMIC_DRAW));
+	} else {
+		// Providing texture samples
+		i32 samplers[TEXTURE_SAMPLE_AMT];
+		for (u32 i = 0; i < TEXTURE_SAMPLE_AMT; i++)
+			samplers[i] = i;
+
+		// Providing samplers to the shader
+		i32 uniform = shader_uniform(&shader, "textures");
+		assert(uniform != -1, "Cannot find uniform: textures\n");
+		shader_set_i32_array(&shader, uniform, samplers, TEXTURE_SAMPLE_AMT);
+	}
 
 	return OK(IMR, (IMR) {
 		.vao = vao,
 		.vbo = vbo,
+		.ibo = ibo,
 		.shader = shader,
 		.def_shader = shader,
-		.buff_idx = 0,
-		.white = white
+		.verts = verts,
+		.vert_cnt = 0,
+		.persistent = persistent,
+		.mapped = mapped,
+		.white = white,
+		.bindless = bindless,
+		.handles = handles
 	});
 }
 
+// Forgets every handle, making those of textures that still exist non resident
+static void imr_release_handles(IMR* imr) {
+	IMR_Handles* h = &imr->handles;
+	for (u32 i = 0; i < h->handle_cnt; i++) {
+		if (texture_delete_stamp(h->ids[i]) > h->delete_cnt) continue;
+		GLCall(glMakeTextureHandleNonResidentARB(h->handles[i]));
+	}
+	if (h->idx) memset(h->idx, 0, sizeof(u32) * h->idx_cap);
+	h->handle_cnt = 0;
+	h->delete_cnt = texture_delete_cnt();
+}
+
 void imr_delete(IMR* imr) {
+	texture_slots_release(&imr->slots);
+	if (imr->persistent) {
+		for (u32 i = 0; i < imr->fence_cnt; i++) {
+			GLCall(glDeleteSync(imr->fences[(imr->fence_first + i) % IMR_MAX_FENCE_CNT].sync));
+		}
+		GLCall(glBindBuffer(GL_ARRAY_BUFFER, imr->vbo));
+		GLCall(glUnmapBuffer(GL_ARRAY_BUFFER));
+	} else {
+		clean(imr->verts);
+	}
+
 	GLCall(glDeleteVertexArrays(1, &imr->vao));
 	GLCall(glDeleteBuffers(1, &imr->vbo));
+	GLCall(glDeleteBuffers(1, &imr->ibo));
+	if (imr->bindless) {
+		imr_release_handles(imr);
+		GLCall(glDeleteBuffers(1, &imr->handles.ssbo));
+		clean(imr->handles.handles);
+		clean(imr->handles.ids);
+		clean(imr->handles.idx);
+	}
 	texture_delete(imr->white);
-	shader_delete(imr->shader);
+	if (imr->shader.id != imr->def_shader.id) {
+		shader_delete(imr->shader);
+	}
 	shader_delete(imr->def_shader);
 }
 
@@ -106,64 +227,211 @@ void imr_clear(v4 color) {
 	GLCall(glClear(GL_COLOR_BUFFER_BIT));
 }
 
+static void imr_wait_oldest_fence(IMR* imr) {
+	IMR_Fence* fence = &imr->fences[imr->fence_first];
+
+	GLenum status;
+	do {
+		status = GLCall(glClientWaitSync(fence->sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000));
+	} while (status == GL_TIMEOUT_EXPIRED);
+	assert(status != GL_WAIT_FAILED, "Waiting on vertex buffer fence failed.\n");
+
+	GLCall(glDeleteSync(fence->sync));
+	imr->fence_first = (imr->fence_first + 1) % IMR_MAX_FENCE_CNT;
+	imr->fence_cnt--;
+}
+
+// Finds room for a full batch in the ring, waiting only on batches in the way
+static u32 imr_ring_reserve(IMR* imr) {
+	for (;;) {
+		u32 head = imr->ring_head;
+		if (imr->fence_cnt == 0) {
+			if (head + MAX_VERT_CNT > IMR_RING_VERT_CNT) imr->ring_head = 0;
+			return imr->ring_head;
+		}
+
+		// Batches in flight span from the oldest one up to the head
+		u32 tail = imr->fences[imr->fence_first].start;
+		if (imr->fence_cnt < IMR_MAX_FENCE_CNT) {
+			if (head > tail) {
+				if (IMR_RING_VERT_CNT - head >= MAX_VERT_CNT) return head;
+				if (tail >= MAX_VERT_CNT) return imr->ring_head = 0;
+			} else if (head < tail && tail - head >= MAX_VERT_CNT) {
+				return head;
+			}
+		}
+		imr_wait_oldest_fence(imr);
+	}
+}
+
 void imr_begin(IMR* imr) {
-	imr->buff_idx = 0;
-	texture_bind(imr->white);
-	GLCall(glUseProgram(imr->shader));
+	imr->vert_cnt = 0;
+	if (imr->persistent) {
+		imr->verts = imr->mapped + imr_ring_reserve(imr);
+	}
+
+	// Handles of deleted textures are gone, their names can be taken again
+	if (imr->bindless) {
+		if (imr->handles.delete_cnt != texture_delete_cnt()) imr_release_handles(imr);
+		GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IMR_HANDLE_BINDING, imr->handles.ssbo));
+	}
+
+	GLCall(glUseProgram(imr->shader.id));
 	GLCall(glBindBuffer(GL_ARRAY_BUFFER, imr->vbo));
 }
 
 void imr_end(IMR* imr) {
-	GLCall(glBindBuffer(GL_ARRAY_BUFFER, imr->vbo));
-	GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(imr->buffer), imr->buffer));
+	// Units of the batch are free for the next one once it is drawn
+	imr->stats.state_changes += imr->slots.binds;
+	texture_slots_release(&imr->slots);
 
+	if (imr->vert_cnt == 0) return;
 	GLCall(glBindVertexArray(imr->vao));
-	GLCall(glDrawArrays(GL_TRIANGLES, 0, imr->buff_idx / VERTEX_SIZE));
+	u32 index_cnt = imr->vert_cnt / 4 * 6;
+
+	if (imr->persistent) {
+		// Vertices are already in the buffer, the fence tells when the GPU is done with them
+		GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, index_cnt, GL_UNSIGNED_SHORT, NULL, imr->ring_head));
+
+		u32 idx = (imr->fence_first + imr->fence_cnt++) % IMR_MAX_FENCE_CNT;
+		imr->fences[idx].sync = GLCall(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		imr->fences[idx].start = imr->ring_head;
+		imr->ring_head += imr->vert_cnt;
+	} else {
+		// Uploading only what was pushed this batch
+		GLCall(glBindBuffer(GL_ARRAY_BUFFER, imr->vbo));
+		GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * imr->vert_cnt, imr->verts));
+		GLCall(glDrawElements(GL_TRIANGLES, index_cnt, GL_UNSIGNED_SHORT, NULL));
+	}
+	imr->stats.draw_calls++;
+	imr->stats.vertices += imr->vert_cnt;
+	imr->vert_cnt = 0;
 }
 
 void imr_switch_shader(IMR* imr, Shader shader) {
+	if (imr->shader.id != shader.id) imr->stats.state_changes++;
 	imr->shader = shader;
 }
 
 void imr_switch_shader_to_default(IMR* imr) {
-	imr->shader = imr->def_shader;
+	imr_switch_shader(imr, imr->def_shader);
 }
 
 void imr_reapply_samplers(IMR* imr) {
-	GLCall(glUseProgram(imr->shader));
+	if (imr->bindless) return;
 
 	// Providing texture samples
-	u32 samplers[TEXTURE_SAMPLE_AMT];
+	i32 samplers[TEXTURE_SAMPLE_AMT];
 	for (u32 i = 0; i < TEXTURE_SAMPLE_AMT; i++)
 		samplers[i] = i;
-	
+
 	// Providing samplers to the shader
-	int loc = GLCall(glGetUniformLocation(imr->shader, "textures"));
-	assert(loc != -1, "Cannot find uniform: textures\n");
-	GLCall(glUniform1iv(loc, TEXTURE_SAMPLE_AMT, samplers));
+	i32 uniform = shader_uniform(&imr->shader, "textures");
+	assert(uniform != -1, "Cannot find uniform: textures\n");
+	shader_set_i32_array(&imr->shader, uniform, samplers, TEXTURE_SAMPLE_AMT);
 }
 
 void imr_update_mvp(IMR* imr, m4 mvp) {
-	i32 loc = GLCall(glGetUniformLocation(imr->shader, "mvp"));
-	GLCall(glUniformMatrix4fv(loc, 1, GL_TRUE, &mvp.m[0][0]));
+	shader_set_m4(&imr->shader, shader_uniform(&imr->shader, "mvp"), mvp);
 }
 
-void imr_push_vertex(IMR* imr, Vertex v) {
-	STATIC_ASSERT(
-		10 == sizeof(Vertex) / sizeof(f32),
-		"Vertex has been updated. Update this method."
+u32 imr_texture_slot(IMR* imr, Texture texture) {
+	i32 slot = texture_slot(&imr->slots, texture.id);
+	if (slot == -1) {
+		imr_end(imr);
+		imr_begin(imr);
+		slot = texture_slot(&imr->slots, texture.id);
+		assert(slot != -1, "Every texture unit is sampled by open batches of other renderers.\n");
+	}
+	return slot;
+}
+
+static u32 imr_handle_idx(IMR* imr, u32 id) {
+	IMR_Handles* h = &imr->handles;
+	if (id < h->idx_cap && h->idx[id]) return h->idx[id] - 1;
+
+	if (id >= h->idx_cap) {
+		u32 cap = h->idx_cap ? h->idx_cap : 64;
+		while (cap <= id) cap *= 2;
+		h->idx = alloc_resize(h->idx, sizeof(u32) * cap);
+		memset(h->idx + h->idx_cap, 0, sizeof(u32) * (cap - h->idx_cap));
+		h->idx_cap = cap;
+	}
+
+#ifdef IMR_COMPACT_VERTEX
+	assert(h->handle_cnt < 65536, "Compact vertices cant index more than 65536 textures.\n");
+#endif
+
+	// Draws already issued keep reading the old storage
+	if (h->handle_cnt == h->handle_cap) {
+		h->handle_cap *= 2;
+		h->handles = alloc_resize(h->handles, sizeof(u64) * h->handle_cap);
+		h->ids = alloc_resize(h->ids, sizeof(u32) * h->handle_cap);
+		GLCall(glNamedBufferData(h->ssbo, sizeof(u64) * h->handle_cap, NULL, GL_DYNAMIC_DRAW));
+		GLCall(glNamedBufferSubData(h->ssbo, 0, sizeof(u64) * h->handle_cnt, h->handles));
+	}
+
+	u64 handle = GLCall(glGetTextureHandleARB(id));
+	b32 resident = GLCall(glIsTextureHandleResidentARB(handle));
+	if (!resident) {
+		GLCall(glMakeTextureHandleResidentARB(handle));
+	}
+	GLCall(glNamedBufferSubData(h->ssbo, sizeof(u64) * h->handle_cnt, sizeof(u64), &handle));
+
+	h->handles[h->handle_cnt] = handle;
+	h->ids[h->handle_cnt] = id;
+	h->idx[id] = ++h->handle_cnt;
+	return h->handle_cnt - 1;
+}
+
+// Index the shader samples a texture with, -1 if the batch is out of units
+static i32 imr_texture_try_index(IMR* imr, u32 id) {
+	if (imr->bindless) return imr_handle_idx(imr, id);
+	return texture_slot(&imr->slots, id);
+}
+
+u32 imr_texture_index(IMR* imr, Texture texture) {
+	i32 idx = imr_texture_try_index(imr, texture.id);
+	if (idx == -1) {
+		imr_end(imr);
+		imr_begin(imr);
+		idx = imr_texture_try_index(imr, texture.id);
+		assert(idx != -1, "Every texture unit is sampled by open batches of other renderers.\n");
+	}
+	return idx;
+}
+
+void imr_reset_stats(IMR* imr) {
+	imr->stats = (IMR_Stats) { 0 };
+}
+
+void imr_print_stats(IMR* imr) {
+	log_info(
+		"IMR: %u draw calls, %u state changes, %u vertices\n",
+		imr->stats.draw_calls, imr->stats.state_changes, imr->stats.vertices
 	);
+}
 
-	imr->buffer[imr->buff_idx++] = v.pos.x;
-	imr->buffer[imr->buff_idx++] = v.pos.y;
-	imr->buffer[imr->buff_idx++] = v.pos.z;
-	imr->buffer[imr->buff_idx++] = v.color.r;
-	imr->buffer[imr->buff_idx++] = v.color.g;
-	imr->buffer[imr->buff_idx++] = v.color.b;
-	imr->buffer[imr->buff_idx++] = v.color.a;
-	imr->buffer[imr->buff_idx++] = v.tex_coord.x;
-	imr->buffer[imr->buff_idx++] = v.tex_coord.y;
-	imr->buffer[imr->buff_idx++] = v.tex_id;
+Vertex imr_vertex(v3 pos, v4 color, v2 tex_coord, f32 tex_id) {
+#ifdef IMR_COMPACT_VERTEX
+	return (Vertex) {
+		.pos = pos,
+		.color = { f32_to_unorm8(color.r), f32_to_unorm8(color.g), f32_to_unorm8(color.b), f32_to_unorm8(color.a) },
+		.tex_coord = { f32_to_unorm16(tex_coord.x), f32_to_unorm16(tex_coord.y) },
+		.tex_id = (u16) tex_id
+	};
+#else
+	return (Vertex) {
+		.pos = pos,
+		.color = color,
+		.tex_coord = tex_coord,
+		.tex_id = tex_id
+	};
+#endif
+}
+
+void imr_push_vertex(IMR* imr, Vertex v) {
+	imr->verts[imr->vert_cnt++] = v;
 }
 
 void imr_push_quad(IMR* imr, v3 pos, v2 size, m4 rot, v4 color) {
@@ -174,50 +442,249 @@ void imr_push_quad(IMR* imr, v3 pos, v2 size, m4 rot, v4 color) {
 }
 
 void imr_push_quad_tex(IMR* imr, v3 pos, v2 size, Rect tex_rect, f32 tex_id, m4 rot, v4 color) {
-	if (((imr->buff_idx + 6 * VERTEX_SIZE) / VERTEX_SIZE) >= MAX_VERT_CNT) {
-		imr_end(imr);
-		imr_begin(imr);
+	Quad_Desc quad = {
+		.pos = pos,
+		.size = size,
+		.tex_rect = tex_rect,
+		.tex_id = tex_id,
+		.rot = rot,
+		.color = color
+	};
+	imr_push_quads(imr, &quad, 1);
+}
+
+void imr_push_quads(IMR* imr, const Quad_Desc* quads, u32 cnt) {
+	u32 tex_idx[MAX_QUAD_CNT];
+	while (cnt) {
+		u32 room = (MAX_VERT_CNT - imr->vert_cnt) / 4;
+		u32 n = cnt < room ? cnt : room;
+
+		// Taking quads until one needs a texture there is no unit left for
+		u32 k = 0;
+		f32 tex_id = -1;
+		i32 idx = 0;
+		for (; k < n; k++) {
+			if (quads[k].tex_id != tex_id) {
+				idx = imr_texture_try_index(imr, (u32) quads[k].tex_id);
+				if (idx == -1) break;
+				tex_id = quads[k].tex_id;
+			}
+			tex_idx[k] = idx;
+		}
+		assert(k > 0 || imr->vert_cnt > 0, "Every texture unit is sampled by open batches of other renderers.\n");
+
+		Vertex* out = imr->verts + imr->vert_cnt;
+		imr_build_quads(out, quads, k);
+		for (u32 i = 0; i < k; i++) {
+			out[i * 4 + 0].tex_id = tex_idx[i];
+			out[i * 4 + 1].tex_id = tex_idx[i];
+			out[i * 4 + 2].tex_id = tex_idx[i];
+			out[i * 4 + 3].tex_id = tex_idx[i];
+		}
+		imr->vert_cnt += k * 4;
+		quads += k;
+		cnt -= k;
+
+		// Quads left mean the batch is out of room or units
+		if (cnt) {
+			imr_end(imr);
+			imr_begin(imr);
+		}
 	}
+}
 
-	Vertex p1, p2, p3, p4, p5, p6;
+/*
+ * Corners are pushed in the order (-, -), (+, -), (+, +), (-, +) of the
+ * half size, rotated over the quad center. Corners have z = 0, so w is 1
+ * and the divide can be skipped when m[0][3] = m[1][3] = 0 and m[3][3] = 1.
+ */
 
-	// Rotating over origin
-	p1.pos = m4_mul_v3(rot, (v3) { -size.x / 2, -size.y / 2, 0.0f });
-	p2.pos = m4_mul_v3(rot, (v3) {  size.x / 2, -size.y / 2, 0.0f });
-	p3.pos = m4_mul_v3(rot, (v3) {  size.x / 2,  size.y / 2, 0.0f });
+static b32 imr_is_affine(const m4* m) {
+	return m->m[0][3] == 0 && m->m[1][3] == 0 && m->m[3][3] == 1;
+}
 
-	p4.pos = m4_mul_v3(rot, (v3) {  size.x / 2,  size.y / 2, 0.0f });
-	p5.pos = m4_mul_v3(rot, (v3) { -size.x / 2,  size.y / 2, 0.0f });
-	p6.pos = m4_mul_v3(rot, (v3) { -size.x / 2, -size.y / 2, 0.0f });
+static void imr_build_quad(Vertex* out, const Quad_Desc* q) {
+	const m4* m = &q->rot;
+	f32 hw = q->size.x / 2;
+	f32 hh = q->size.y / 2;
+	f32 lx[4] = { -hw, hw, hw, -hw };
+	f32 ly[4] = { -hh, -hh, hh, hh };
+	b32 affine = imr_is_affine(m);
+
+	v2 uv[4] = {
+		{ q->tex_rect.x, q->tex_rect.y },
+		{ q->tex_rect.x + q->tex_rect.w, q->tex_rect.y },
+		{ q->tex_rect.x + q->tex_rect.w, q->tex_rect.y + q->tex_rect.h },
+		{ q->tex_rect.x, q->tex_rect.y + q->tex_rect.h }
+	};
 
-	// Shifting to the desired position
-	p1.pos = v3_add(p1.pos, (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
-	p2.pos = v3_add(p2.pos, (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
-	p3.pos = v3_add(p3.pos, (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
-
-	p4.pos = v3_add(p4.pos, (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
-	p5.pos = v3_add(p5.pos, (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
-	p6.pos = v3_add(p6.pos, (v3) { pos.x + size.x / 2, pos.y + size.y / 2, pos.z });
-
-	// Making the texure coordinates
-	p1.tex_coord = (v2) { tex_rect.x, tex_rect.y };
-	p2.tex_coord = (v2) { tex_rect.x + tex_rect.w, tex_rect.y };
-	p3.tex_coord = (v2) { tex_rect.x + tex_rect.w, tex_rect.y + tex_rect.h };
-	p4.tex_coord = (v2) { tex_rect.x + tex_rect.w, tex_rect.y + tex_rect.h };
-	p5.tex_coord = (v2) { tex_rect.x, tex_rect.y + tex_rect.h };
-	p6.tex_coord = (v2) { tex_rect.x, tex_rect.y };
-
-	p1.color = p2.color = p3.color = p4.color = p5.color = p6.color = color;
-	p1.tex_id = p2.tex_id = p3.tex_id = p4.tex_id = p5.tex_id = p6.tex_id = tex_id;
-
-	imr_push_vertex(imr, p1);
-	imr_push_vertex(imr, p2);
-	imr_push_vertex(imr, p3);
-	imr_push_vertex(imr, p4);
-	imr_push_vertex(imr, p5);
-	imr_push_vertex(imr, p6);
+	for (u32 c = 0; c < 4; c++) {
+		v3 p = {
+			lx[c] * m->m[0][0] + ly[c] * m->m[1][0] + m->m[3][0],
+			lx[c] * m->m[0][1] + ly[c] * m->m[1][1] + m->m[3][1],
+			lx[c] * m->m[0][2] + ly[c] * m->m[1][2] + m->m[3][2]
+		};
+		if (!affine) {
+			f32 w = lx[c] * m->m[0][3] + ly[c] * m->m[1][3] + m->m[3][3];
+			if (w) {
+				p.x /= w;
+				p.y /= w;
+				p.z /= w;
+			}
+		}
+
+		p.x += q->pos.x + hw;
+		p.y += q->pos.y + hh;
+		p.z += q->pos.z;
+		out[c] = imr_vertex(p, q->color, uv[c], q->tex_id);
+	}
 }
 
+#if defined(__SSE2__) && !defined(IMR_NO_SIMD)
+
+/*
+ * Quad_Desc is read as rows of 4 floats, transposing 4 quads' rows gives a
+ * register per field with quad i in lane i
+ */
+
+STATIC_ASSERT(sizeof(Quad_Desc) == 30 * sizeof(f32), "Quad_Desc has been updated. Update imr_build_quads_x4.");
+STATIC_ASSERT(offsetof(Quad_Desc, rot) == 10 * sizeof(f32), "Quad_Desc has been updated. Update imr_build_quads_x4.");
+STATIC_ASSERT(offsetof(Quad_Desc, color) == 26 * sizeof(f32), "Quad_Desc has been updated. Update imr_build_quads_x4.");
+
+#define IMR_LOAD_SOA(q, off, a, b, c, d) do {  \
+	a = _mm_loadu_ps((const f32*) &q[0] + off); \
+	b = _mm_loadu_ps((const f32*) &q[1] + off); \
+	c = _mm_loadu_ps((const f32*) &q[2] + off); \
+	d = _mm_loadu_ps((const f32*) &q[3] + off); \
+	_MM_TRANSPOSE4_PS(a, b, c, d);              \
+} while (0)
+
+// Same rounding as f32_to_unorm8/16
+#define IMR_UNORM(x, scale) _mm_cvttps_epi32(_mm_add_ps(                          \
+	_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f)), scale), \
+	_mm_set1_ps(0.5f)                                                          \
+))
+
+static void imr_build_quads_x4(Vertex* out, const Quad_Desc* q) {
+	__m128 px, py, pz, sx, sy, rx, ry, rw, rh, id, m00, m01, m02, m03;
+	__m128 m10, m11, m12, m13, m20, m21, m22, m23, m30, m31, m32, m33;
+	__m128 cr, cg, cb, ca;
+	IMR_LOAD_SOA(q,  0, px, py, pz, sx);
+	IMR_LOAD_SOA(q,  4, sy, rx, ry, rw);
+	IMR_LOAD_SOA(q,  8, rh, id, m00, m01);
+	IMR_LOAD_SOA(q, 12, m02, m03, m10, m11);
+	IMR_LOAD_SOA(q, 16, m12, m13, m20, m21);
+	IMR_LOAD_SOA(q, 20, m22, m23, m30, m31);
+	IMR_LOAD_SOA(q, 24, m32, m33, cr, cg);
+	IMR_LOAD_SOA(q, 26, cr, cg, cb, ca);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 projective = _mm_or_ps(
+		_mm_or_ps(_mm_cmpneq_ps(m03, zero), _mm_cmpneq_ps(m13, zero)),
+		_mm_cmpneq_ps(m33, one)
+	);
+	b32 affine = _mm_movemask_ps(projective) == 0;
+
+	__m128 hw = _mm_mul_ps(sx, _mm_set1_ps(0.5f));
+	__m128 hh = _mm_mul_ps(sy, _mm_set1_ps(0.5f));
+	__m128 cx = _mm_add_ps(px, hw);
+	__m128 cy = _mm_add_ps(py, hh);
+
+	__m128 lx[4] = { _mm_sub_ps(zero, hw), hw, hw, _mm_sub_ps(zero, hw) };
+	__m128 ly[4] = { _mm_sub_ps(zero, hh), _mm_sub_ps(zero, hh), hh, hh };
+	__m128 u[4] = { rx, _mm_add_ps(rx, rw), _mm_add_ps(rx, rw), rx };
+	__m128 v[4] = { ry, ry, _mm_add_ps(ry, rh), _mm_add_ps(ry, rh) };
+
+#ifdef IMR_COMPACT_VERTEX
+	// Packed color and the texture slot are the same for every corner
+	__m128 unorm8 = _mm_set1_ps(255.0f);
+	__m128i rgba = _mm_or_si128(
+		_mm_or_si128(IMR_UNORM(cr, unorm8), _mm_slli_epi32(IMR_UNORM(cg, unorm8), 8)),
+		_mm_or_si128(_mm_slli_epi32(IMR_UNORM(cb, unorm8), 16), _mm_slli_epi32(IMR_UNORM(ca, unorm8), 24))
+	);
+	__m128i slot = _mm_and_si128(_mm_cvttps_epi32(id), _mm_set1_epi32(0xffff));
+	__m128 unorm16 = _mm_set1_ps(65535.0f);
+#endif
+
+	for (u32 c = 0; c < 4; c++) {
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx[c], m00), _mm_mul_ps(ly[c], m10)), m30);
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx[c], m01), _mm_mul_ps(ly[c], m11)), m31);
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx[c], m02), _mm_mul_ps(ly[c], m12)), m32);
+		if (!affine) {
+			__m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx[c], m03), _mm_mul_ps(ly[c], m13)), m33);
+
+			// A zero w leaves the corner as is
+			__m128 w_zero = _mm_cmpeq_ps(w, zero);
+			w = _mm_or_ps(_mm_and_ps(w_zero, one), _mm_andnot_ps(w_zero, w));
+			x = _mm_div_ps(x, w);
+			y = _mm_div_ps(y, w);
+			z = _mm_div_ps(z, w);
+		}
+		x = _mm_add_ps(x, cx);
+		y = _mm_add_ps(y, cy);
+		z = _mm_add_ps(z, pz);
+
+#ifdef IMR_COMPACT_VERTEX
+		// Position and color, then the texture coordinates and slot
+		__m128 a = _mm_castsi128_ps(rgba);
+		_MM_TRANSPOSE4_PS(x, y, z, a);
+
+		__m128i uv = _mm_or_si128(IMR_UNORM(u[c], unorm16), _mm_slli_epi32(IMR_UNORM(v[c], unorm16), 16));
+		__m128i lo = _mm_unpacklo_epi32(uv, slot);
+		__m128i hi = _mm_unpackhi_epi32(uv, slot);
+
+		__m128 rows[4] = { x, y, z, a };
+		__m128i tails[4] = { lo, _mm_unpackhi_epi64(lo, lo), hi, _mm_unpackhi_epi64(hi, hi) };
+		for (u32 i = 0; i < 4; i++) {
+			u8* dst = (u8*) &out[i * 4 + c];
+			_mm_storeu_ps((f32*) dst, rows[i]);
+			_mm_storel_epi64((__m128i*) (dst + 16), tails[i]);
+		}
+#else
+		// Rows of x, y, z, r and g, b, a, u, then v and the texture slot
+		__m128 r = cr;
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+		__m128 g = cg, b = cb, a = ca, uc = u[c];
+		_MM_TRANSPOSE4_PS(g, b, a, uc);
+		__m128 lo = _mm_unpacklo_ps(v[c], id);
+		__m128 hi = _mm_unpackhi_ps(v[c], id);
+
+		__m128 first[4] = { x, y, z, r };
+		__m128 second[4] = { g, b, a, uc };
+		for (u32 i = 0; i < 4; i++) {
+			f32* dst = (f32*) &out[i * 4 + c];
+			_mm_storeu_ps(dst, first[i]);
+			_mm_storeu_ps(dst + 4, second[i]);
+		}
+		_mm_storel_pi((__m64*) ((f32*) &out[0 * 4 + c] + 8), lo);
+		_mm_storeh_pi((__m64*) ((f32*) &out[1 * 4 + c] + 8), lo);
+		_mm_storel_pi((__m64*) ((f32*) &out[2 * 4 + c] + 8), hi);
+		_mm_storeh_pi((__m64*) ((f32*) &out[3 * 4 + c] + 8), hi);
+#endif
+	}
+}
+
+void imr_build_quads(Vertex* out, const Quad_Desc* quads, u32 cnt) {
+	u32 i = 0;
+	for (; i + 4 <= cnt; i += 4) {
+		imr_build_quads_x4(out + i * 4, quads + i);
+	}
+	for (; i < cnt; i++) {
+		imr_build_quad(out + i * 4, quads + i);
+	}
+}
+
+#else
+
+void imr_build_quads(Vertex* out, const Quad_Desc* quads, u32 cnt) {
+	for (u32 i = 0; i < cnt; i++) {
+		imr_build_quad(out + i * 4, quads + i);
+	}
+}
+
+#endif
+
 void imr_push_triangle(IMR* imr, v3 p1, v3 p2, v3 p3, m4 rot, v4 color) {
 	Triangle tex_coord = {
 		(v3) { 0, 0, 0 },
@@ -228,10 +695,11 @@ void imr_push_triangle(IMR* imr, v3 p1, v3 p2, v3 p3, m4 rot, v4 color) {
 }
 
 void imr_push_triangle_tex(IMR* imr, v3 p1, v3 p2, v3 p3, Triangle tex_coord, f32 tex_id, m4 rot, v4 color) {
-	if (((imr->buff_idx + 3 * VERTEX_SIZE) / VERTEX_SIZE) >= MAX_VERT_CNT) {
+	if (imr->vert_cnt + 4 > MAX_VERT_CNT) {
 		imr_end(imr);
 		imr_begin(imr);
 	}
+	f32 slot = imr_texture_index(imr, (Texture) { .id = (u32) tex_id });
 
 	v3 centroid = {
 		(p1.x + p2.x + p3.x) / 3.0f,
@@ -239,27 +707,23 @@ void imr_push_triangle_tex(IMR* imr, v3 p1, v3 p2, v3 p3, Triangle tex_coord, f3
 		(p1.z + p2.z + p3.z) / 3.0f,
 	};
 
-	Vertex a1, a2, a3;
+	v3 a1, a2, a3;
 
 	// Rotating over origin
-	a1.pos = m4_mul_v3(rot, (v3) { p1.x - centroid.x, p1.y - centroid.y, p1.z - centroid.z });
-	a2.pos = m4_mul_v3(rot, (v3) { p2.x - centroid.x, p2.y - centroid.y, p2.z - centroid.z });
-	a3.pos = m4_mul_v3(rot, (v3) { p3.x - centroid.x, p3.y - centroid.y, p3.z - centroid.z });
+	a1 = m4_mul_v3(rot, (v3) { p1.x - centroid.x, p1.y - centroid.y, p1.z - centroid.z });
+	a2 = m4_mul_v3(rot, (v3) { p2.x - centroid.x, p2.y - centroid.y, p2.z - centroid.z });
+	a3 = m4_mul_v3(rot, (v3) { p3.x - centroid.x, p3.y - centroid.y, p3.z - centroid.z });
 
 	// Shifting to the desired position
-	a1.pos = v3_add(a1.pos, (v3) { centroid.x, centroid.y, centroid.z });
-	a2.pos = v3_add(a2.pos, (v3) { centroid.x, centroid.y, centroid.z });
-	a3.pos = v3_add(a3.pos, (v3) { centroid.x, centroid.y, centroid.z });
-
-	// Texture coordinates
-	a1.tex_coord = (v2) { tex_coord.a.x, tex_coord.a.y };
-	a2.tex_coord = (v2) { tex_coord.b.x, tex_coord.b.y };
-	a3.tex_coord = (v2) { tex_coord.c.x, tex_coord.c.y };
+	a1 = v3_add(a1, (v3) { centroid.x, centroid.y, centroid.z });
+	a2 = v3_add(a2, (v3) { centroid.x, centroid.y, centroid.z });
+	a3 = v3_add(a3, (v3) { centroid.x, centroid.y, centroid.z });
 
-	a1.color = a2.color = a3.color = color;
-	a1.tex_id = a2.tex_id = a3.tex_id = tex_id;
+	Vertex last = imr_vertex(a3, color, (v2) { tex_coord.c.x, tex_coord.c.y }, slot);
 
-	imr_push_vertex(imr, a1);
-	imr_push_vertex(imr, a2);
-	imr_push_vertex(imr, a3);
+	// Repeating the last corner makes the second triangle of the quad empty
+	imr_push_vertex(imr, imr_vertex(a1, color, (v2) { tex_coord.a.x, tex_coord.a.y }, slot));
+	imr_push_vertex(imr, imr_vertex(a2, color, (v2) { tex_coord.b.x, tex_coord.b.y }, slot));
+	imr_push_vertex(imr, last);
+	imr_push_vertex(imr, last);
 }
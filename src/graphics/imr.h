@@ -3,6 +3,7 @@
 
 #include "core/defines.h"
 #include "core/log.h"
+#include "core/alloc.h"
 #include "core/result.h"
 #include "math/vec.h"
 #include "math/mat.h"
@@ -10,6 +11,35 @@
 #include "shader.h"
 #include "texture.h"
 
+/*
+ * Vertex layout
+ *
+ * By default a vertex is 10 floats (40 bytes). With IMR_COMPACT_VERTEX
+ * defined it is 24 bytes: RGBA8 normalized color, 16 bit UNORM texture
+ * coordinates and an integer texture slot read with glVertexAttribIPointer.
+ * Texture coordinates are clamped to [0, 1] in the compact layout.
+ *
+ * Shaders drawn through IMR declare the slot as
+ * `layout (location = 3) in IMR_TEX_ID tex_id;` with IMR_GLSL_DEFINES put
+ * right after their #version line, so they work with either layout.
+ * Fragment shaders sample with IMR_TEXTURE(int(tex_id), uv), which works
+ * with either texture path. Vertices are made with imr_vertex.
+ */
+
+#ifdef IMR_COMPACT_VERTEX
+
+typedef struct {
+	v3 pos;
+	u8 color[4];
+	u16 tex_coord[2];
+	u16 tex_id;
+	u16 pad;
+} Vertex;
+
+#define IMR_GLSL_TEX_ID "#define IMR_TEX_ID uint\n"
+
+#else
+
 typedef struct {
 	v3 pos;
 	v4 color;
@@ -17,25 +47,163 @@ typedef struct {
 	f32 tex_id;
 } Vertex;
 
+#define IMR_GLSL_TEX_ID "#define IMR_TEX_ID float\n"
+
+#endif
+
+// Shader storage binding of the texture handles, IMR_GLSL_TEXTURES is built from it
+#define IMR_HANDLE_BINDING 0
+
+#ifndef IMR_NO_BINDLESS
+#define IMR_GLSL_TEXTURES                                                                     \
+	"#extension GL_ARB_bindless_texture : enable\n"                                           \
+	"#ifdef GL_ARB_bindless_texture\n"                                                        \
+	"layout (std430, binding = " STRINGIFY(IMR_HANDLE_BINDING) ") readonly buffer imr_texture_handles { uvec2 imr_handles[]; };\n" \
+	"#define IMR_TEXTURE(idx, uv) texture(sampler2D(imr_handles[idx]), uv)\n"                  \
+	"#else\n"                                                                                 \
+	"uniform sampler2D textures[32];\n"                                                       \
+	"#define IMR_TEXTURE(idx, uv) texture(textures[idx], uv)\n"                               \
+	"#endif\n"
+#else
+#define IMR_GLSL_TEXTURES                                           \
+	"uniform sampler2D textures[32];\n"                             \
+	"#define IMR_TEXTURE(idx, uv) texture(textures[idx], uv)\n"
+#endif
+
+#define IMR_GLSL_DEFINES IMR_GLSL_TEX_ID IMR_GLSL_TEXTURES
+
 typedef struct {
 	v3 a, b, c;
 } Triangle;
 
-#define TEXTURE_SAMPLE_AMT 32
-#define VERTEX_SIZE   10
 #define MAX_VERT_CNT  10000
-#define MAX_BUFF_CAP  MAX_VERT_CNT  * VERTEX_SIZE
-#define MAX_VBO_SIZE  MAX_BUFF_CAP  * sizeof(f32)
+#define MAX_VBO_SIZE  (MAX_VERT_CNT * sizeof(Vertex))
+
+/*
+ * Quads are 4 vertices drawn through a static index buffer repeating the
+ * (0, 1, 2, 2, 3, 0) pattern. Triangles are pushed as quads with the last
+ * corner repeated, so their second triangle is degenerate and both kinds
+ * share one batch. Raw vertices have to be pushed 4 at a time.
+ */
+
+#define MAX_QUAD_CNT  (MAX_VERT_CNT / 4)
+#define MAX_INDEX_CNT (MAX_QUAD_CNT * 6)
+
+STATIC_ASSERT(MAX_VERT_CNT % 4 == 0, "Batches have to hold whole quads");
+STATIC_ASSERT(MAX_VERT_CNT <= 65536, "Quad indices are 16 bit");
 
-STATIC_ASSERT(VERTEX_SIZE == sizeof(Vertex) / sizeof(f32), "Size of vertex missmatched");
+/*
+ * Textures
+ *
+ * Texture ids pushed to IMR are texture names (Texture.id), vertices get the
+ * index the shader samples with.
+ *
+ * With GL_ARB_bindless_texture (unless IMR_NO_BINDLESS is defined) every
+ * texture drawn gets a resident handle in a shader storage buffer, and the
+ * index is its position there. Textures never end a batch.
+ *
+ * Without it every batch maps textures to units with a Texture_Slots and the
+ * index is the unit, a batch is drawn early when it needs more textures
+ * than there are units.
+ *
+ * Raw vertices pushed with imr_push_vertex take their index from
+ * imr_texture_index. Samplers of custom shaders take a unit from
+ * imr_texture_slot in both cases.
+ */
+
+/*
+ * @brief Texture handles of the bindless path
+ * @mem ssbo       = Shader storage buffer holding the handles
+ * @mem handles    = Handles in buffer order
+ * @mem ids        = Texture name of every handle
+ * @mem handle_cnt = No of handles
+ * @mem handle_cap = Capacity of `handles` and the buffer
+ * @mem idx        = Position in `handles` plus 1 for every texture name, 0 if not drawn yet
+ * @mem idx_cap    = Capacity of `idx`
+ * @mem delete_cnt = texture_delete_cnt() when `idx` was last valid
+ */
+
+typedef struct {
+	u32 ssbo;
+	u64* handles;
+	u32* ids;
+	u32 handle_cnt, handle_cap;
+	u32* idx;
+	u32 idx_cap;
+	u32 delete_cnt;
+} IMR_Handles;
+
+/*
+ * Batched quads
+ *
+ * imr_push_quads takes an array of quads with the same meaning as the
+ * imr_push_quad_tex arguments. Corners are transformed 4 quads at a time
+ * with SSE in structure of arrays form (scalar without SSE2 or with
+ * IMR_NO_SIMD defined), and the w divide is skipped for affine matrices.
+ * imr_build_quads is the same vertex generation without any GL work.
+ */
+
+typedef struct {
+	v3 pos;
+	v2 size;
+	Rect tex_rect;
+	f32 tex_id;
+	m4 rot;
+	v4 color;
+} Quad_Desc;
+
+/*
+ * Vertex streaming
+ *
+ * With GL 4.4 / ARB_buffer_storage the vbo is a persistently mapped ring of
+ * IMR_RING_CNT batches. Vertices are written straight into the mapping and
+ * every draw gets a fence, a batch only waits when the GPU still reads the
+ * part of the ring it needs. Batches are packed one after another, so small
+ * ones share the ring and the GPU lags behind by several of them.
+ *
+ * Without it (or with IMR_NO_PERSISTENT_MAP defined) vertices go to a cpu
+ * buffer and only the used part is uploaded with glBufferSubData.
+ */
+
+#define IMR_RING_CNT      3
+#define IMR_RING_VERT_CNT (IMR_RING_CNT * MAX_VERT_CNT)
+#define IMR_MAX_FENCE_CNT 64
+
+typedef struct {
+	GLsync sync;
+	u32 start;
+} IMR_Fence;
+
+/*
+ * @brief Work done by an IMR since the last imr_reset_stats
+ * @mem draw_calls    = No of draw calls issued
+ * @mem state_changes = No of shader switches and texture binds, plus blend changes made by draw lists
+ * @mem vertices      = No of vertices drawn
+ */
+
+typedef struct {
+	u32 draw_calls;
+	u32 state_changes;
+	u32 vertices;
+} IMR_Stats;
 
 typedef struct {
-	u32 vao, vbo;
+	u32 vao, vbo, ibo;
 	Shader shader;
 	Shader def_shader;
-	f32 buffer[MAX_BUFF_CAP];
-	u32 buff_idx;
+	Vertex* verts;
+	u32 vert_cnt;
+	b32 persistent;
+	Vertex* mapped;
+	u32 ring_head;
+	IMR_Fence fences[IMR_MAX_FENCE_CNT];
+	u32 fence_first;
+	u32 fence_cnt;
 	Texture white;
+	Texture_Slots slots;
+	b32 bindless;
+	IMR_Handles handles;
+	IMR_Stats stats;
 } IMR;
 
 RESULT(IMR, IMR);
@@ -49,9 +217,16 @@ void imr_switch_shader(IMR* imr, Shader shader);
 void imr_reapply_samplers(IMR* imr);
 void imr_switch_shader_to_default(IMR* imr);
 void imr_update_mvp(IMR* imr, m4 mvp);
+u32 imr_texture_slot(IMR* imr, Texture texture);
+u32 imr_texture_index(IMR* imr, Texture texture);
+void imr_reset_stats(IMR* imr);
+void imr_print_stats(IMR* imr);
+Vertex imr_vertex(v3 pos, v4 color, v2 tex_coord, f32 tex_id);
 void imr_push_vertex(IMR* imr, Vertex v);
 void imr_push_quad(IMR* imr, v3 pos, v2 size, m4 rot, v4 color);
 void imr_push_quad_tex(IMR* imr, v3 pos, v2 size, Rect tex_rect, f32 tex_id, m4 rot, v4 color);
+void imr_push_quads(IMR* imr, const Quad_Desc* quads, u32 cnt);
+void imr_build_quads(Vertex* out, const Quad_Desc* quads, u32 cnt);
 void imr_push_triangle(IMR* imr, v3 p1, v3 p2, v3 p3, m4 rot, v4 color);
 void imr_push_triangle_tex(IMR* imr, v3 p1, v3 p2, v3 p3, Triangle tex_coord, f32 tex_id, m4 rot, v4 color);
 
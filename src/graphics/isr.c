@@ -0,0 +1,184 @@
+#include "isr.h"
+#include "math/utils.h"
+
+static const char* isr_v_src =
+	"#version 440 core\n"
+	"layout (location = 0) in vec2 corner;\n"
+	"layout (location = 1) in vec3 pos;\n"
+	"layout (location = 2) in vec2 size;\n"
+	"layout (location = 3) in float rot;\n"
+	"layout (location = 4) in vec4 tex_rect;\n"
+	"layout (location = 5) in vec4 color;\n"
+	"layout (location = 6) in uint tex_id;\n"
+	"uniform mat4 mvp;\n"
+	"out vec4 o_color;\n"
+	"out vec2 o_tex_coord;\n"
+	"flat out uint o_tex_id;\n"
+	"void main() {\n"
+	"vec2 p = (corner - 0.5f) * size;\n"
+	"float c = cos(rot);\n"
+	"float s = sin(rot);\n"
+	"p = vec2(p.x * c - p.y * s, p.x * s + p.y * c) + pos.xy + size * 0.5f;\n"
+	"o_color = color;\n"
+	"o_tex_coord = tex_rect.xy + corner * tex_rect.zw;\n"
+	"o_tex_id = tex_id;\n"
+	"gl_Position = mvp * vec4(p, pos.z, 1.0f);\n"
+	"}\n";
+
+static const char* isr_f_src =
+	"#version 440 core\n"
+	"layout (location = 0) out vec4 color;\n"
+	"uniform sampler2D textures[32];\n"
+	"in vec4 o_color;\n"
+	"in vec2 o_tex_coord;\n"
+	"flat in uint o_tex_id;\n"
+	"void main() {\n"
+	"color = texture(textures[o_tex_id], o_tex_coord) * o_color;\n"
+	"}\n";
+
+Result_ISR isr_new() {
+	u32 vao, quad_vbo, vbo;
+
+	GLCall(glEnable(GL_BLEND));
+	GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+	GLCall(glGenVertexArrays(1, &vao));
+	GLCall(glBindVertexArray(vao));
+
+	// Unit quad drawn as a triangle strip for every instance
+	v2 quad[4] = {
+		{ 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }
+	};
+
+	GLCall(glGenBuffers(1, &quad_vbo));
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, quad_vbo));
+	GLCall(glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW));
+	GLCall(glEnableVertexAttribArray(0));
+	GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(v2), (const void*) 0));
+
+	// Instance buffer
+	GLCall(glGenBuffers(1, &vbo));
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+	GLCall(glBufferData(GL_ARRAY_BUFFER, MAX_SPRITE_BUFF_SIZE, NULL, GL_STREAM_DRAW));
+
+	STATIC_ASSERT(
+		40 == sizeof(Sprite),
+		"Sprite has been updated. Update VAO format."
+	);
+
+	GLCall(glEnableVertexAttribArray(1));
+	GLCall(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Sprite), (const void*) offsetof(Sprite, pos)));
+	GLCall(glEnableVertexAttribArray(2));
+	GLCall(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (const void*) offsetof(Sprite, size)));
+	GLCall(glEnableVertexAttribArray(3));
+	GLCall(glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Sprite), (const void*) offsetof(Sprite, rot)));
+	GLCall(glEnableVertexAttribArray(4));
+	GLCall(glVertexAttribPointer(4, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Sprite), (const void*) offsetof(Sprite, tex_rect)));
+	GLCall(glEnableVertexAttribArray(5));
+	GLCall(glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Sprite), (const void*) offsetof(Sprite, color)));
+	GLCall(glEnableVertexAttribArray(6));
+	GLCall(glVertexAttribIPointer(6, 1, GL_UNSIGNED_INT, sizeof(Sprite), (const void*) offsetof(Sprite, tex_id)));
+
+	for (u32 i = 1; i <= 6; i++) {
+		GLCall(glVertexAttribDivisor(i, 1));
+	}
+
+	// Generating white texture
+	u32 data = 0xffffffff;
+	Texture white = unwrap(texture_from_data(1, 1, &data));
+
+	// Shader
+	Result_Shader rs = shader_new(isr_v_src, isr_f_src);
+	if (rs.status == ERROR) {
+		return ERR(ISR, unwrap_err(rs));
+	}
+
+	Shader shader = unwrap(rs);
+
+	// Providing samplers to the shader
+	i32 samplers[TEXTURE_SAMPLE_AMT];
+	for (u32 i = 0; i < TEXTURE_SAMPLE_AMT; i++)
+		samplers[i] = i;
+
+	i32 uniform = shader_uniform(&shader, "textures");
+	assert(uniform != -1, "Cannot find uniform: textures\n");
+	shader_set_i32_array(&shader, uniform, samplers, TEXTURE_SAMPLE_AMT);
+
+	return OK(ISR, (ISR) {
+		.vao = vao,
+		.quad_vbo = quad_vbo,
+		.vbo = vbo,
+		.shader = shader,
+		.sprites = alloc(MAX_SPRITE_BUFF_SIZE),
+		.sprite_cnt = 0,
+		.white = white
+	});
+}
+
+void isr_delete(ISR* isr) {
+	texture_slots_release(&isr->slots);
+	clean(isr->sprites);
+	GLCall(glDeleteVertexArrays(1, &isr->vao));
+	GLCall(glDeleteBuffers(1, &isr->quad_vbo));
+	GLCall(glDeleteBuffers(1, &isr->vbo));
+	texture_delete(isr->white);
+	shader_delete(isr->shader);
+}
+
+void isr_begin(ISR* isr) {
+	isr->sprite_cnt = 0;
+	GLCall(glUseProgram(isr->shader.id));
+}
+
+void isr_end(ISR* isr) {
+	texture_slots_release(&isr->slots);
+	if (isr->sprite_cnt == 0) return;
+	GLCall(glBindVertexArray(isr->vao));
+
+	// Orphaning the storage first, the driver hands out fresh memory instead of
+	// waiting for the previous batch to be drawn, then uploading only this batch
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, isr->vbo));
+	GLCall(glBufferData(GL_ARRAY_BUFFER, MAX_SPRITE_BUFF_SIZE, NULL, GL_STREAM_DRAW));
+	GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Sprite) * isr->sprite_cnt, isr->sprites));
+	GLCall(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, isr->sprite_cnt));
+	isr->sprite_cnt = 0;
+}
+
+void isr_update_mvp(ISR* isr, m4 mvp) {
+	shader_set_m4(&isr->shader, shader_uniform(&isr->shader, "mvp"), mvp);
+}
+
+void isr_push_sprite(ISR* isr, v3 pos, v2 size, f32 rot, v4 color) {
+	Rect tex_rect = {
+		0, 0, 1, 1
+	};
+	isr_push_sprite_tex(isr, pos, size, rot, tex_rect, isr->white.id, color);
+}
+
+void isr_push_sprite_tex(ISR* isr, v3 pos, v2 size, f32 rot, Rect tex_rect, f32 tex_id, v4 color) {
+	if (isr->sprite_cnt == MAX_SPRITE_CNT) {
+		isr_end(isr);
+		isr_begin(isr);
+	}
+
+	// Out of units, drawing the batch frees them
+	i32 slot = texture_slot(&isr->slots, (u32) tex_id);
+	if (slot == -1) {
+		isr_end(isr);
+		isr_begin(isr);
+		slot = texture_slot(&isr->slots, (u32) tex_id);
+		assert(slot != -1, "Every texture unit is sampled by open batches of other renderers.\n");
+	}
+
+	isr->sprites[isr->sprite_cnt++] = (Sprite) {
+		.pos = pos,
+		.size = size,
+		.rot = rot,
+		.tex_rect = {
+			f32_to_unorm16(tex_rect.x), f32_to_unorm16(tex_rect.y),
+			f32_to_unorm16(tex_rect.w), f32_to_unorm16(tex_rect.h)
+		},
+		.color = { f32_to_unorm8(color.r), f32_to_unorm8(color.g), f32_to_unorm8(color.b), f32_to_unorm8(color.a) },
+		.tex_id = slot
+	};
+}
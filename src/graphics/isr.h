@@ -0,0 +1,59 @@
+#ifndef __ISR_H__
+#define __ISR_H__
+
+#include "core/defines.h"
+#include "core/log.h"
+#include "core/alloc.h"
+#include "core/result.h"
+#include "math/vec.h"
+#include "math/mat.h"
+#include "math/rect.h"
+#include "shader.h"
+#include "texture.h"
+
+/*
+ * Instanced sprite renderer
+ *
+ * Every sprite is one 40 byte instance instead of 4 transformed vertices.
+ * A static unit quad is expanded in the vertex shader, which does the
+ * rotation and placement IMR does on the cpu, and a batch is drawn with a
+ * single glDrawArraysInstanced. Sprites follow imr_push_quad_tex: `pos` is
+ * the top left corner and the sprite rotates over its center.
+ *
+ * Colors are RGBA8 and texture rects 16 bit UNORM, so texture rects are
+ * clamped to [0, 1]. Sprites are drawn with the mvp the same way as IMR,
+ * `tex_id` is the texture (Texture.id) and is mapped to a unit per batch.
+ */
+
+typedef struct {
+	v3 pos;
+	v2 size;
+	f32 rot;
+	u16 tex_rect[4];
+	u8 color[4];
+	u32 tex_id;
+} Sprite;
+
+#define MAX_SPRITE_CNT 16384
+#define MAX_SPRITE_BUFF_SIZE (MAX_SPRITE_CNT * sizeof(Sprite))
+
+typedef struct {
+	u32 vao, quad_vbo, vbo;
+	Shader shader;
+	Sprite* sprites;
+	u32 sprite_cnt;
+	Texture white;
+	Texture_Slots slots;
+} ISR;
+
+RESULT(ISR, ISR);
+
+Result_ISR isr_new();
+void isr_delete(ISR* isr);
+void isr_begin(ISR* isr);
+void isr_end(ISR* isr);
+void isr_update_mvp(ISR* isr, m4 mvp);
+void isr_push_sprite(ISR* isr, v3 pos, v2 size, f32 rot, v4 color);
+void isr_push_sprite_tex(ISR* isr, v3 pos, v2 size, f32 rot, Rect tex_rect, f32 tex_id, v4 color);
+
+#endif // __ISR_H__
@@ -25,11 +25,133 @@ Result_Shader shader_new(const char* v_src, const char* f_src) {
 	GLCall(glDeleteShader(vs));
 	GLCall(glDeleteShader(fs));
 
-	return OK(Shader, program);
+	// Reading the active uniforms once, lookups after this make no GL calls
+	i32 cnt;
+	GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &cnt));
+
+	Shader shader = {
+		.id = program,
+		.uniforms = alloc(sizeof(Shader_Uniform) * (cnt ? cnt : 1)),
+		.uniform_cnt = 0
+	};
+	hashmap_reserve(shader.lookup, cnt);
+
+	for (i32 i = 0; i < cnt; i++) {
+		Shader_Uniform* u = &shader.uniforms[shader.uniform_cnt];
+		*u = (Shader_Uniform) { 0 };
+
+		i32 len;
+		GLCall(glGetActiveUniform(program, i, SHADER_MAX_UNIFORM_NAME, &len, &u->size, &u->type, u->name));
+		assert(len < SHADER_MAX_UNIFORM_NAME - 1, "Uniform name `%s` is too long.\n", u->name);
+
+		// Uniforms in blocks have no location, their block is in the block table
+		u->loc = GLCall(glGetUniformLocation(program, u->name));
+		if (u->loc == -1) continue;
+
+		if (len > 3 && strcmp(u->name + len - 3, "[0]") == 0) {
+			u->name[len - 3] = '\0';
+			len -= 3;
+		}
+
+		u64 key = hash_bytes(u->name, len);
+		assert(!hashmap_exists(shader.lookup, key), "Uniform `%s` has the hash of another uniform.\n", u->name);
+		hashmap_insert(shader.lookup, key, shader.uniform_cnt);
+		shader.uniform_cnt++;
+	}
+
+	// Block indices go from 0 to the block count, the table is indexed the same
+	GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &cnt));
+	shader.blocks = alloc(sizeof(Shader_Block) * (cnt ? cnt : 1));
+	shader.block_cnt = cnt;
+	for (i32 i = 0; i < cnt; i++) {
+		Shader_Block* b = &shader.blocks[i];
+		i32 len, binding;
+		GLCall(glGetActiveUniformBlockName(program, i, SHADER_MAX_UNIFORM_NAME, &len, b->name));
+		assert(len < SHADER_MAX_UNIFORM_NAME - 1, "Uniform block name `%s` is too long.\n", b->name);
+		GLCall(glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &b->size));
+		GLCall(glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &binding));
+		b->binding = binding;
+	}
+
+	return OK(Shader, shader);
+}
+
+void shader_delete(Shader shader) {
+	GLCall(glDeleteProgram(shader.id));
+	hashmap_delete(shader.lookup);
+	clean(shader.uniforms);
+	clean(shader.blocks);
+}
+
+i32 shader_uniform(const Shader* shader, const char* name) {
+	u32* idx = hashmap_find(shader->lookup, hash_bytes(name, strlen(name)));
+	if (idx == NULL || strcmp(shader->uniforms[*idx].name, name) != 0) return -1;
+	return *idx;
+}
+
+static u32 upload_cnt;
+
+// Returns true if the uniform has to be uploaded, remembering the value
+static b32 shader_changed(Shader* shader, i32 uniform, const void* value, u32 size) {
+	if (uniform == -1) return false;
+
+	Shader_Uniform* u = &shader->uniforms[uniform];
+	if (size <= sizeof(u->value)) {
+		if (u->set && memcmp(u->value, value, size) == 0) return false;
+		memcpy(u->value, value, size);
+		u->set = true;
+	}
+	upload_cnt++;
+	return true;
+}
+
+void shader_set_i32(Shader* shader, i32 uniform, i32 value) {
+	if (!shader_changed(shader, uniform, &value, sizeof(value))) return;
+	GLCall(glProgramUniform1i(shader->id, shader->uniforms[uniform].loc, value));
+}
+
+void shader_set_f32(Shader* shader, i32 uniform, f32 value) {
+	if (!shader_changed(shader, uniform, &value, sizeof(value))) return;
+	GLCall(glProgramUniform1f(shader->id, shader->uniforms[uniform].loc, value));
+}
+
+void shader_set_v2(Shader* shader, i32 uniform, v2 value) {
+	if (!shader_changed(shader, uniform, &value, sizeof(value))) return;
+	GLCall(glProgramUniform2f(shader->id, shader->uniforms[uniform].loc, value.x, value.y));
+}
+
+void shader_set_v4(Shader* shader, i32 uniform, v4 value) {
+	if (!shader_changed(shader, uniform, &value, sizeof(value))) return;
+	GLCall(glProgramUniform4f(shader->id, shader->uniforms[uniform].loc, value.x, value.y, value.z, value.w));
+}
+
+void shader_set_m4(Shader* shader, i32 uniform, m4 value) {
+	if (!shader_changed(shader, uniform, &value, sizeof(value))) return;
+	GLCall(glProgramUniformMatrix4fv(shader->id, shader->uniforms[uniform].loc, 1, GL_TRUE, &value.m[0][0]));
+}
+
+void shader_set_i32_array(Shader* shader, i32 uniform, const i32* values, u32 cnt) {
+	if (!shader_changed(shader, uniform, values, sizeof(i32) * cnt)) return;
+	GLCall(glProgramUniform1iv(shader->id, shader->uniforms[uniform].loc, cnt, values));
+}
+
+// Programs have a handful of blocks, a scan is enough
+i32 shader_uniform_block(const Shader* shader, const char* name) {
+	for (u32 i = 0; i < shader->block_cnt; i++) {
+		if (strcmp(shader->blocks[i].name, name) == 0) return i;
+	}
+	return -1;
+}
+
+void shader_bind_uniform_block(Shader* shader, i32 block, u32 binding) {
+	if (block == -1 || shader->blocks[block].binding == binding) return;
+	GLCall(glUniformBlockBinding(shader->id, block, binding));
+	shader->blocks[block].binding = binding;
+	upload_cnt++;
 }
 
-void shader_delete(Shader id) {
-	GLCall(glDeleteProgram(id));
+u32 shader_upload_cnt() {
+	return upload_cnt;
 }
 
 Result_u32 shader_compile(Shader_Type type, const char* shader_src) {
@@ -5,8 +5,78 @@
 #include "core/log.h"
 #include "core/defines.h"
 #include "core/result.h"
+#include "core/hashmap.h"
+#include "math/vec.h"
+#include "math/mat.h"
+
+/*
+ * Shader
+ *
+ * Active uniforms are read once when the program is linked, into a table
+ * hashed by name. Arrays are listed under their name without `[0]`.
+ * shader_uniform gives the position of a uniform in the table, and the
+ * setters take that position and upload with glProgramUniform*, so the
+ * program does not have to be in use.
+ *
+ * The last value of every uniform up to SHADER_UNIFORM_CACHE_SIZE words is
+ * kept, setting the same value again makes no GL call. Uniforms have to be
+ * set only through the setters for that to hold. Copies of a Shader share
+ * the table.
+ *
+ * Uniforms inside uniform blocks have no location and are not in the table,
+ * they are filled through a buffer bound to the block's binding point.
+ * Active blocks are read at link time into a second table,
+ * shader_uniform_block finds one by name and shader_bind_uniform_block
+ * points it at a binding, again without a GL call if it already is.
+ */
+
+#define SHADER_MAX_UNIFORM_NAME   64
+#define SHADER_UNIFORM_CACHE_SIZE 32
+
+
+/*
+ * @brief Active uniform of a program
+ * @mem name  = Name, without `[0]` for arrays
+ * @mem loc   = Location
+ * @mem type  = GL type
+ * @mem size  = No of array elements, 1 if not an array
+ * @mem set   = True once `value` holds the uploaded value
+ * @mem value = Last uploaded value
+ */
+
+typedef struct {
+	char name[SHADER_MAX_UNIFORM_NAME];
+	i32 loc;
+	u32 type;
+	i32 size;
+	b32 set;
+	u32 value[SHADER_UNIFORM_CACHE_SIZE];
+} Shader_Uniform;
+
+
+
+/*
+ * @brief Active uniform block of a program
+ * @mem name    = Name of the block
+ * @mem size    = Bytes the buffer bound to it needs
+ * @mem binding = Binding point the block reads from
+ */
+
+typedef struct {
+	char name[SHADER_MAX_UNIFORM_NAME];
+	i32 size;
+	u32 binding;
+} Shader_Block;
+
+typedef struct {
+	u32 id;
+	Shader_Uniform* uniforms;
+	u32 uniform_cnt;
+	Hashmap(u64, u32) lookup;
+	Shader_Block* blocks;
+	u32 block_cnt;
+} Shader;
 
-typedef u32 Shader;
 typedef enum {
 	VERTEX_SHADER = GL_VERTEX_SHADER,
 	FRAGMENT_SHADER = GL_FRAGMENT_SHADER
@@ -15,7 +85,61 @@ typedef enum {
 RESULT(Shader, Shader);
 
 Result_Shader shader_new(const char* v_src, const char* f_src);
-void shader_delete(Shader id);
+void shader_delete(Shader shader);
 Result_u32 shader_compile(Shader_Type type, const char* shader_src);
 
+
+/*
+ * @brief Function to find a uniform
+ * @param shader = Pointer to the shader
+ * @param name   = Name of the uniform, arrays without `[0]`
+ * @return Returns the position of the uniform, -1 if the program has no such active uniform
+ */
+
+i32 shader_uniform(const Shader* shader, const char* name);
+
+
+/*
+ * @brief Functions to set a uniform, doing nothing if the value did not change
+ * @param shader  = Pointer to the shader
+ * @param uniform = Position from shader_uniform, -1 is ignored
+ * @param value   = New value
+ * @info Matrices are uploaded transposed, same as ocamera_calc_mvp expects
+ */
+
+void shader_set_i32(Shader* shader, i32 uniform, i32 value);
+void shader_set_f32(Shader* shader, i32 uniform, f32 value);
+void shader_set_v2(Shader* shader, i32 uniform, v2 value);
+void shader_set_v4(Shader* shader, i32 uniform, v4 value);
+void shader_set_m4(Shader* shader, i32 uniform, m4 value);
+void shader_set_i32_array(Shader* shader, i32 uniform, const i32* values, u32 cnt);
+
+
+/*
+ * @brief Function to find a uniform block
+ * @param shader = Pointer to the shader
+ * @param name   = Name of the block
+ * @return Returns the block index, -1 if the program has no such active block
+ */
+
+i32 shader_uniform_block(const Shader* shader, const char* name);
+
+
+/*
+ * @brief Function to make a uniform block read from a binding point, doing nothing if it already does
+ * @param shader  = Pointer to the shader
+ * @param block   = Index from shader_uniform_block, -1 is ignored
+ * @param binding = Binding point, the buffer is bound with glBindBufferBase(GL_UNIFORM_BUFFER, binding, ...)
+ */
+
+void shader_bind_uniform_block(Shader* shader, i32 block, u32 binding);
+
+
+/*
+ * @brief Function to get the no of uniform uploads and block bindings made so far
+ * @return Returns the count
+ */
+
+u32 shader_upload_cnt();
+
 #endif // __SHADER_H__
@@ -3,6 +3,9 @@
 #include "GL/glew.h"
 #include "core/log.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 Result_Texture texture_from_file(const char* filepath, b32 flip) {
 	stbi_set_flip_vertically_on_load(flip);
 
@@ -12,20 +15,19 @@ Result_Texture texture_from_file(const char* filepath, b32 flip) {
 		return ERR(Texture, "Failed to load texture file");
 	}
 
-	// Binding the texture
+	// Created without binding, the units texture_slot tracks are left alone
 	u32 id;
-	GLCall(glGenTextures(1, &id));
-	GLCall(glBindTexture(GL_TEXTURE_2D, id));
+	GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &id));
 
 	// Setting up some basic modes to display texture
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 
 	// Sending the pixel data to opengl
-	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	GLCall(glTextureStorage2D(id, 1, GL_RGBA8, w, h));
+	GLCall(glTextureSubImage2D(id, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data));
 
 	if (data) {
 		stbi_image_free(data);
@@ -38,32 +40,117 @@ Result_Texture texture_from_file(const char* filepath, b32 flip) {
 
 Result_Texture texture_from_data(u32 width, u32 height, u32* data) {
 	u32 id;
-	GLCall(glGenTextures(1, &id));
-	GLCall(glBindTexture(GL_TEXTURE_2D, id));
+	GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &id));
 	
 	// Setting up some basic modes to display texture
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GLCall(glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 	
-	// Sending the pixel data to opengl
-	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	// Sending the pixel data to opengl, render targets come without any
+	GLCall(glTextureStorage2D(id, 1, GL_RGBA8, width, height));
+	if (data) {
+		GLCall(glTextureSubImage2D(id, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data));
+	}
 
 	return OK(Texture, (Texture) {
 		id, width, height
 	});
 }
 
-void texture_bind(Texture texture) {
-	GLCall(glBindTextureUnit(texture.id, texture.id));
+// Texture bound to every unit and when it was last used
+static u32 unit_ids[TEXTURE_SAMPLE_AMT];
+static u64 unit_uses[TEXTURE_SAMPLE_AMT];
+
+// No of open batches sampling every unit, shared by every renderer
+static u32 unit_holds[TEXTURE_SAMPLE_AMT];
+static u64 unit_clock;
+static u32 unit_cnt;
+static u32 delete_cnt;
+
+// delete_cnt right after every texture name was last deleted, lives as long as the process
+static u32* delete_stamps;
+static u32 delete_stamp_cap;
+
+void texture_bind(Texture texture, u32 unit) {
+	assert(unit < texture_unit_cnt(), "Texture unit %u is out of range.\n", unit);
+	GLCall(glBindTextureUnit(unit, texture.id));
+	unit_ids[unit] = texture.id;
+	unit_uses[unit] = ++unit_clock;
 }
 
-void texture_unbind(Texture texture) {
-	GLCall(glBindTextureUnit(texture.id, 0));
+void texture_unbind(u32 unit) {
+	texture_bind((Texture) { 0 }, unit);
 }
 
 void texture_delete(Texture texture) {
 	GLCall(glDeleteTextures(1, &texture.id));
+
+	// GL unbinds deleted textures and can hand their names out again
+	for (u32 i = 0; i < TEXTURE_SAMPLE_AMT; i++) {
+		if (unit_ids[i] == texture.id) unit_ids[i] = 0;
+	}
+	delete_cnt++;
+
+	if (texture.id >= delete_stamp_cap) {
+		u32 cap = delete_stamp_cap ? delete_stamp_cap : 64;
+		while (cap <= texture.id) cap *= 2;
+		delete_stamps = realloc(delete_stamps, sizeof(u32) * cap);
+		assert(delete_stamps, "Failed to grow texture delete stamps to %u names.\n", cap);
+		memset(delete_stamps + delete_stamp_cap, 0, sizeof(u32) * (cap - delete_stamp_cap));
+		delete_stamp_cap = cap;
+	}
+	delete_stamps[texture.id] = delete_cnt;
+}
+
+u32 texture_unit_cnt() {
+	if (unit_cnt == 0) {
+		i32 max;
+		GLCall(glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max));
+		unit_cnt = max < TEXTURE_SAMPLE_AMT ? max : TEXTURE_SAMPLE_AMT;
+	}
+	return unit_cnt;
+}
+
+i32 texture_slot(Texture_Slots* slots, u32 id) {
+	u32 cnt = texture_unit_cnt();
+	i32 lru = -1;
+	for (u32 i = 0; i < cnt; i++) {
+		if (unit_ids[i] == id) {
+			if (!(slots->used & (1u << i))) {
+				slots->used |= 1u << i;
+				unit_holds[i]++;
+			}
+			unit_uses[i] = ++unit_clock;
+			return i;
+		}
+
+		// Units held by any open batch, this one or another renderer's, keep their texture
+		if (unit_holds[i] == 0 && (lru == -1 || unit_uses[i] < unit_uses[lru])) {
+			lru = i;
+		}
+	}
+	if (lru == -1) return -1;
+
+	texture_bind((Texture) { .id = id }, lru);
+	slots->used |= 1u << lru;
+	unit_holds[lru]++;
+	slots->binds++;
+	return lru;
+}
+
+void texture_slots_release(Texture_Slots* slots) {
+	for (u32 i = 0; i < TEXTURE_SAMPLE_AMT; i++) {
+		if (slots->used & (1u << i)) unit_holds[i]--;
+	}
+	*slots = (Texture_Slots) { 0 };
+}
+
+u32 texture_delete_cnt() {
+	return delete_cnt;
+}
+
+u32 texture_delete_stamp(u32 id) {
+	return id < delete_stamp_cap ? delete_stamps[id] : 0;
 }
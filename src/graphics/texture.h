@@ -3,6 +3,7 @@
 
 #include "core/defines.h"
 #include "core/result.h"
+#include "core/log.h"
 
 typedef struct {
 	u32 id, width, height;
@@ -10,12 +11,87 @@ typedef struct {
 
 RESULT(Texture, Texture);
 
+// Texture units the renderers expose to their shaders
+#define TEXTURE_SAMPLE_AMT 32
+
+/*
+ * Texture slots
+ *
+ * Shaders sample textures[unit], units go from 0 to texture_unit_cnt() - 1.
+ * The texture bound to every unit is remembered across batches and frames,
+ * so a texture already in a unit is not bound again. A batch marks the
+ * units it samples in a Texture_Slots, and a texture new to the batch takes
+ * the least recently used unit no open batch samples, so renderers with
+ * batches open at the same time never take each other's units. When every
+ * unit is taken the batch has to be drawn and its slots released.
+ */
+
+STATIC_ASSERT(TEXTURE_SAMPLE_AMT <= 32, "Texture_Slots keeps a bit per unit");
+
+
+/*
+ * @brief Units sampled by a batch
+ * @mem used  = Bit per unit sampled by the batch
+ * @mem binds = No of textures bound for the batch
+ */
+
+typedef struct {
+	u32 used;
+	u32 binds;
+} Texture_Slots;
+
 // TODO: Implement control over texture filters
 // Filters are hard coded for now
 Result_Texture texture_from_file(const char* filepath, b32 flip);
 Result_Texture texture_from_data(u32 width, u32 height, u32* data);
-void texture_bind(Texture texture);
-void texture_unbind(Texture texture);
+void texture_bind(Texture texture, u32 unit);
+void texture_unbind(u32 unit);
 void texture_delete(Texture texture);
 
+
+/*
+ * @brief Function to get the no of texture units shaders can sample
+ * @return Returns the smaller of the GL limit and TEXTURE_SAMPLE_AMT
+ */
+
+u32 texture_unit_cnt();
+
+
+/*
+ * @brief Function to get the unit of a texture for a batch, binding it if needed
+ * @param slots = Units of the batch
+ * @param id    = Texture to sample (Texture.id)
+ * @return Returns the unit, -1 if every unit is sampled by open batches
+ */
+
+i32 texture_slot(Texture_Slots* slots, u32 id);
+
+
+/*
+ * @brief Function to give back the units of a batch once it is drawn
+ * @param slots = Units of the batch, reset for the next one
+ */
+
+void texture_slots_release(Texture_Slots* slots);
+
+
+/*
+ * @brief Function to get the no of textures deleted so far
+ * @return Returns the count
+ * @info GL hands names of deleted textures out again, anything keyed by
+ *       texture name has to be dropped when the count changes
+ */
+
+u32 texture_delete_cnt();
+
+
+/*
+ * @brief Function to get when a texture name was last deleted
+ * @param id = Texture name (Texture.id)
+ * @return Returns texture_delete_cnt() right after the deletion, 0 if never deleted
+ * @info Something recorded at delete count n was deleted since if the stamp is above n
+ */
+
+u32 texture_delete_stamp(u32 id);
+
 #endif // __TEXTURE_H__
@@ -17,6 +17,19 @@ static b32 f32_eq(f32 a, f32 b) {
 	return fabs(a - b) < 0.01f;
 }
 
+// Clamped conversions to normalized integers for packed vertex data
+static u8 f32_to_unorm8(f32 x) {
+	if (x <= 0.0f) return 0;
+	if (x >= 1.0f) return 0xff;
+	return (u8) (x * 255.0f + 0.5f);
+}
+
+static u16 f32_to_unorm16(f32 x) {
+	if (x <= 0.0f) return 0;
+	if (x >= 1.0f) return 0xffff;
+	return (u16) (x * 65535.0f + 0.5f);
+}
+
 static v2 pixel_to_gl_coords(v2 pos, u32 WIN_WIDTH, u32 WIN_HEIGHT) {
 	return (v2) {
 		(2 * pos.x) / WIN_WIDTH - 1,
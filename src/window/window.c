@@ -24,6 +24,8 @@ Result_Window window_new(const char* title, u32 width, u32 height) {
 	if (glewInit() != GLEW_OK)
 		return ERR(Window, "Failed to initialize glew");
 
+	event_register_callbacks(glfw_window);
+
 	b32 should_close = glfwWindowShouldClose(glfw_window);
 
 	return OK(Window, (Window) {
@@ -43,4 +45,7 @@ void window_update(Window* window) {
 	window->should_close = glfwWindowShouldClose(window->glfw_window);
 	glfwSwapBuffers(window->glfw_window);
 	glfwPollEvents();
+
+	// Per frame scratch memory dies here
+	arena_end_frame(ctx->frame_arena);
 }